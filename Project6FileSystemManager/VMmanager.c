@@ -1,38 +1,177 @@
+#define _GNU_SOURCE
 #include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "VMmanager.h"
+#include "memGroup.h"
+#include "cacheSim.h"
 
-int fifo_queue[NUM_FRAMES];
-int fifo_front = 0;
-int fifo_rear = 0;
-int tlb_hits = 0;
-int tlb_misses = 0;
-int process_count = 0;
+// The shell's VMM, shared by memaccess and the live scheduler's PCBs
+Vmm vmm;
 
-Frame frames[NUM_FRAMES];
-Process processes[MAX_PROCESSES];
-TLBEntry tlb[TLB_SIZE];
-
-void enqueue_fifo(int frame_index) {
-    fifo_queue[fifo_rear] = frame_index;
-    fifo_rear = (fifo_rear + 1) % NUM_FRAMES;
+void enqueue_fifo(Vmm *vm, int frame_index) {
+    vm->fifo_next[frame_index] = -1;
+    vm->fifo_prev[frame_index] = vm->fifo_tail;
+    if (vm->fifo_tail != -1) vm->fifo_next[vm->fifo_tail] = frame_index;
+    else vm->fifo_head = frame_index;
+    vm->fifo_tail = frame_index;
 }
 
-int dequeue_fifo() {
-    int frame_index = fifo_queue[fifo_front];
-    fifo_front = (fifo_front + 1) % NUM_FRAMES;
+int dequeue_fifo(Vmm *vm) {
+    int frame_index = vm->fifo_head;
+    if (frame_index != -1) remove_fifo(vm, frame_index);
     return frame_index;
 }
 
-void initialize() {
+void remove_fifo(Vmm *vm, int frame_index) {
+    int prev = vm->fifo_prev[frame_index], next = vm->fifo_next[frame_index];
+    if (prev != -1) vm->fifo_next[prev] = next;
+    else vm->fifo_head = next;
+    if (next != -1) vm->fifo_prev[next] = prev;
+    else vm->fifo_tail = prev;
+    vm->fifo_next[frame_index] = vm->fifo_prev[frame_index] = -1;
+}
+
+static unsigned pid_hash(const Vmm *vm, int pid) {
+    return ((unsigned)pid * 2654435761u) & (vm->pid_buckets - 1);
+}
+
+static void pid_map_insert(Vmm *vm, int pid, int slot) {
+    unsigned i = pid_hash(vm, pid);
+    while (vm->pid_keys[i] != 0) i = (i + 1) & (vm->pid_buckets - 1);
+    vm->pid_keys[i] = pid;
+    vm->pid_slots[i] = slot;
+}
+
+static int pid_map_find(const Vmm *vm, int pid) {
+    if (pid <= 0 || vm->pid_buckets == 0) return -1;
+    for (unsigned i = pid_hash(vm, pid); vm->pid_keys[i] != 0; i = (i + 1) & (vm->pid_buckets - 1)) {
+        if (vm->pid_keys[i] == pid) return vm->pid_slots[i];
+    }
+    return -1;
+}
+
+// Backward-shift deletion keeps probe chains short without tombstones
+static void pid_map_remove(Vmm *vm, int pid) {
+    unsigned mask = vm->pid_buckets - 1, i = pid_hash(vm, pid);
+    while (vm->pid_keys[i] != pid) {
+        if (vm->pid_keys[i] == 0) return;
+        i = (i + 1) & mask;
+    }
+    unsigned j = i;
+    while (1) {
+        j = (j + 1) & mask;
+        if (vm->pid_keys[j] == 0) break;
+        unsigned home = pid_hash(vm, vm->pid_keys[j]);
+        // Move j back into the hole only if its home bucket is not inside (i, j]
+        if ((j > i && (home <= i || home > j)) || (j < i && (home <= i && home > j))) {
+            vm->pid_keys[i] = vm->pid_keys[j];
+            vm->pid_slots[i] = vm->pid_slots[j];
+            i = j;
+        }
+    }
+    vm->pid_keys[i] = 0;
+}
+
+// Everything is allocated before anything is published, so a failure
+// leaves the table as it was
+static int grow_process_table(Vmm *vm) {
+    int new_capacity = vm->process_capacity ? vm->process_capacity * 2 : INITIAL_PROCESS_SLOTS;
+    Process **new_table = realloc(vm->processes, new_capacity * sizeof(Process *));
+    if (new_table) vm->processes = new_table;
+    int *new_free = realloc(vm->free_slots, new_capacity * sizeof(int));
+    if (new_free) vm->free_slots = new_free;
+    int new_buckets = 1;
+    while (new_buckets < new_capacity * 2) new_buckets <<= 1;
+    int *new_keys = calloc(new_buckets, sizeof(int));
+    int *new_vals = malloc(new_buckets * sizeof(int));
+    if (!new_table || !new_free || !new_keys || !new_vals) {
+        // A larger array that did get allocated is kept; it is only spare room
+        free(new_keys);
+        free(new_vals);
+        return -1;
+    }
+
+    int *old_keys = vm->pid_keys, *old_vals = vm->pid_slots, old_buckets = vm->pid_buckets;
+    vm->pid_keys = new_keys;
+    vm->pid_slots = new_vals;
+    vm->pid_buckets = new_buckets;
+    for (int i = 0; i < old_buckets; i++) {
+        if (old_keys[i] != 0) pid_map_insert(vm, old_keys[i], old_vals[i]);
+    }
+    free(old_keys);
+    free(old_vals);
+    // Push new slots highest first so the lowest index is reused first
+    for (int i = new_capacity - 1; i >= vm->process_capacity; i--) {
+        vm->processes[i] = NULL;
+        vm->free_slots[vm->free_slot_count++] = i;
+    }
+    vm->process_capacity = new_capacity;
+    return 0;
+}
+
+void vm_lock(Vmm *vm) {
+    pthread_mutex_lock(&vm->lock);
+}
+
+void vm_unlock(Vmm *vm) {
+    pthread_mutex_unlock(&vm->lock);
+}
+
+// Empty frames, replacement order and TLB
+static void reset_frames(Vmm *vm) {
+    vm->tlb_asid = 0;
     for (int i = 0; i < NUM_FRAMES; i++) {
-        frames[i] = (Frame){i, 0, -1, -1};
+        vm->frames[i] = (Frame){i, 0, -1, -1};
+        vm->fifo_next[i] = vm->fifo_prev[i] = -1;
+    }
+    vm->free_frame_top = 0;
+    for (int i = NUM_FRAMES - 1; i >= 0; i--) {
+        vm->free_frame_stack[vm->free_frame_top++] = i;
     }
     for (int i = 0; i < TLB_SIZE; i++) {
-        tlb[i].valid = 0;
-        tlb[i].use_counter = 0;
+        vm->tlb[i].valid = 0;
+        vm->tlb[i].use_counter = 0;
     }
-    fifo_front = fifo_rear = 0;
+    vm->fifo_head = vm->fifo_tail = -1;
+}
+
+// An empty VMM whose address spaces are charged to the given group tree
+void vmm_init(Vmm *vm, struct MemGroup *root_group) {
+    pthread_mutexattr_t attr;
+    memset(vm, 0, sizeof(Vmm));
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&vm->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+    reset_frames(vm);
+    vm->next_vm_pid = 1;
+    vm->root_group = root_group;
+    vm->tlb_mode = TLB_FLUSH;
+}
+
+// Frees every address space still in the VMM along with its tables
+void vmm_destroy(Vmm *vm) {
+    for (int i = 0; i < vm->process_capacity; i++) free(vm->processes[i]);
+    free(vm->processes);
+    free(vm->free_slots);
+    free(vm->pid_keys);
+    free(vm->pid_slots);
+    pthread_mutex_destroy(&vm->lock);
+    memset(vm, 0, sizeof(Vmm));
+}
+
+void initialize() {
+    mem_group_init();
+    vmm_init(&vmm, root_mem_group);
+    vmm.feeds_cache = 1;
+    cache_init();
 }
 
 void initialize_page_table(Process *process) {
@@ -41,141 +180,689 @@ void initialize_page_table(Process *process) {
     }
 }
 
-int create_process() {
-    if (process_count >= MAX_PROCESSES) return -1;
-    Process *process = &processes[process_count];
-    process->process_id = process_count + 1;
+int create_process(Vmm *vm) {
+    vm_lock(vm);
+    if (vm->free_slot_count == 0 && grow_process_table(vm) < 0) {
+        vm_unlock(vm);
+        return -1;
+    }
+    Process *process = malloc(sizeof(Process));
+    if (!process) {
+        vm_unlock(vm);
+        return -1;
+    }
+    int slot = vm->free_slots[--vm->free_slot_count];
+    process->process_id = vm->next_vm_pid++;
+    process->attached = 1;
+    process->group = vm->root_group;
     initialize_page_table(process);
-    process_count++;
+    vm->processes[slot] = process;
+    pid_map_insert(vm, process->process_id, slot);
+    vm->process_count++;
+    vm_unlock(vm);
     return process->process_id;
 }
 
-int allocate_frame() {
-    for (int i = 0; i < NUM_FRAMES; i++) {
-        if (!frames[i].occupied) {
-            frames[i].occupied = 1;
-            enqueue_fifo(i);
-            return i;
-        }
+// The table can be regrown or replaced by another thread, so hold vm_lock()
+// for as long as the returned pointer is in use
+Process *find_process(Vmm *vm, int vm_pid) {
+    int slot = pid_map_find(vm, vm_pid);
+    return slot < 0 ? NULL : vm->processes[slot];
+}
+
+// First frame in replacement order owned by the given subtree, optionally
+// restricted to owners whose groups sit above their soft limit
+static int find_victim(Vmm *vm, MemGroup *within, int soft_only) {
+    for (int f = vm->fifo_head; f != -1; f = vm->fifo_next[f]) {
+        Process *owner = find_process(vm, vm->frames[f].process_id);
+        MemGroup *group = owner ? owner->group : NULL;
+        if (within && !mem_group_is_ancestor(within, group)) continue;
+        if (soft_only && !mem_group_over_soft_limit(group)) continue;
+        return f;
     }
-    int victim = dequeue_fifo();
-    for (int i = 0; i < process_count; i++) {
-        Process *p = &processes[i];
-        for (int j = 0; j < NUM_PAGES; j++) {
-            if (p->page_table[j].frame_number == victim) {
-                p->page_table[j].valid = 0;
-                p->page_table[j].frame_number = -1;
-            }
-        }
+    return -1;
+}
+
+// The frame records its owner, so only that one page table entry is touched
+static void evict_frame(Vmm *vm, int victim, int self_reclaim) {
+    remove_fifo(vm, victim);
+    Process *owner = find_process(vm, vm->frames[victim].process_id);
+    if (owner) {
+        owner->page_table[vm->frames[victim].page_number].valid = 0;
+        owner->page_table[vm->frames[victim].page_number].frame_number = -1;
+        mem_group_charge(owner->group, -1);
+        mem_group_record_eviction(owner->group, self_reclaim);
+    }
+    tlb_invalidate_frame(vm, victim);
+    vm->frames[victim] = (Frame){victim, 0, -1, -1};
+}
+
+// A group at its hard limit always pays for its own fault. Otherwise free
+// frames go first, then groups over their soft limit (the faulting group
+// before anyone else), and only then the global FIFO order.
+int allocate_frame(Vmm *vm, Process *process) {
+    MemGroup *group = process->group;
+    MemGroup *limited = mem_group_over_hard_limit(group);
+    int victim = -1;
+
+    if (limited && (victim = find_victim(vm, limited, 0)) != -1) {
+        evict_frame(vm, victim, 1);
+    } else if (vm->free_frame_top > 0) {
+        victim = vm->free_frame_stack[--vm->free_frame_top];
+    } else {
+        int self = 0;
+        if (mem_group_over_soft_limit(group)) self = (victim = find_victim(vm, group, 0)) != -1;
+        if (victim == -1) victim = find_victim(vm, NULL, 1);
+        if (victim == -1) victim = vm->fifo_head;
+        evict_frame(vm, victim, self);
     }
-    enqueue_fifo(victim);
+    vm->frames[victim].occupied = 1;
+    enqueue_fifo(vm, victim);
+    mem_group_charge(group, 1);
     return victim;
 }
 
-void simulate_disk_io() {
-    sleep(1);
+// Moves a process's resident frames to another group and trims the new
+// group back under its hard limit
+void set_process_group(Vmm *vm, Process *process, MemGroup *group) {
+    vm_lock(vm);
+    int resident = 0;
+    for (int i = 0; i < NUM_PAGES; i++) {
+        if (process->page_table[i].valid) resident++;
+    }
+    mem_group_charge(process->group, -resident);
+    process->group = group;
+    mem_group_charge(group, resident);
+
+    MemGroup *limited;
+    while ((limited = mem_group_over_hard_limit(group)) && limited->usage > limited->hard_limit) {
+        int victim = find_victim(vm, limited, 0);
+        if (victim == -1) break;
+        evict_frame(vm, victim, 1);
+        vm->free_frame_stack[vm->free_frame_top++] = victim;
+    }
+    vm_unlock(vm);
 }
 
 void log_page_fault(int process_id, int page_number, const char *type) {
     printf("Page Fault (%s): Process %d, Page %d\n", type, process_id, page_number);
 }
 
-int tlb_lookup(int page_number, int *frame_number) {
+// Runs when an address space is about to be used
+void tlb_switch(Vmm *vm, int asid) {
+    if (asid == vm->tlb_asid) return;
+    vm->address_space_switches++;
+    if (vm->tlb_mode == TLB_FLUSH) {
+        for (int i = 0; i < TLB_SIZE; i++) vm->tlb[i].valid = 0;
+        vm->tlb_flushes++;
+    }
+    vm->tlb_asid = asid;
+}
+
+// Entries left over from the other mode are dropped
+void tlb_set_mode(Vmm *vm, TlbMode mode) {
+    vm_lock(vm);
+    for (int i = 0; i < TLB_SIZE; i++) vm->tlb[i].valid = 0;
+    vm->tlb_mode = mode;
+    vm_unlock(vm);
+}
+
+int tlb_lookup(Vmm *vm, int asid, int page_number, int *frame_number) {
     for (int i = 0; i < TLB_SIZE; i++) {
-        if (tlb[i].valid && tlb[i].page_number == page_number) {
-            *frame_number = tlb[i].frame_number;
-            tlb[i].use_counter++;
-            tlb_hits++;
+        TLBEntry *e = &vm->tlb[i];
+        if (e->valid && e->asid == asid && e->page_number == page_number) {
+            *frame_number = e->frame_number;
+            e->use_counter = ++vm->tlb_clock;
+            vm->tlb_hits++;
             return 1;
         }
     }
-    tlb_misses++;
+    vm->tlb_misses++;
     return 0;
 }
 
-void tlb_add_entry(int page_number, int frame_number) {
-    int lru_index = 0, min_use = tlb[0].use_counter;
+void tlb_add_entry(Vmm *vm, int asid, int page_number, int frame_number) {
+    int lru_index = 0, min_use = vm->tlb[0].use_counter;
     for (int i = 1; i < TLB_SIZE; i++) {
-        if (!tlb[i].valid) {
+        if (!vm->tlb[i].valid) {
             lru_index = i;
             break;
         }
-        if (tlb[i].use_counter < min_use) {
-            min_use = tlb[i].use_counter;
+        if (vm->tlb[i].use_counter < min_use) {
+            min_use = vm->tlb[i].use_counter;
             lru_index = i;
         }
     }
-    tlb[lru_index] = (TLBEntry){page_number, frame_number, 1, 1};
+    vm->tlb[lru_index] = (TLBEntry){page_number, frame_number, 1, ++vm->tlb_clock, asid};
 }
 
-void load_page(Process *process, int page_number, int is_hard_fault) {
-    int frame_number = allocate_frame();
+void tlb_invalidate_frame(Vmm *vm, int frame_number) {
+    for (int i = 0; i < TLB_SIZE; i++) {
+        if (vm->tlb[i].valid && vm->tlb[i].frame_number == frame_number) vm->tlb[i].valid = 0;
+    }
+}
+
+static void map_page(Vmm *vm, Process *process, int page_number) {
+    int frame_number = allocate_frame(vm, process);
     process->page_table[page_number].frame_number = frame_number;
     process->page_table[page_number].valid = 1;
-    frames[frame_number] = (Frame){frame_number, 1, process->process_id, page_number};
-    if (is_hard_fault) simulate_disk_io();
-    tlb_add_entry(page_number, frame_number);
+    vm->frames[frame_number] = (Frame){frame_number, 1, process->process_id, page_number};
+    tlb_add_entry(vm, process->process_id, page_number, frame_number);
+}
+
+// A fault from the shell is served on the spot; scheduled PCBs wait for
+// theirs through vm_touch() and vm_resolve_fault() instead
+void load_page(Vmm *vm, Process *process, int page_number, int is_hard_fault) {
+    map_page(vm, process, page_number);
     log_page_fault(process->process_id, page_number, is_hard_fault ? "Hard" : "Soft");
 }
 
-void access_memory(Process *process, int page_number, int offset, char mode) {
+void access_memory(Vmm *vm, Process *process, int page_number, int offset, char mode) {
     int frame_number;
-    if (tlb_lookup(page_number, &frame_number)) {
+    if (page_number < 0 || page_number >= NUM_PAGES) {
+        printf("Access violation: Process %d, Page %d out of range\n", process->process_id, page_number);
+        return;
+    }
+    vm_lock(vm);
+    tlb_switch(vm, process->process_id);
+    if (tlb_lookup(vm, process->process_id, page_number, &frame_number)) {
         printf("TLB HIT: Frame %d for Process %d, Page %d\n", frame_number, process->process_id, page_number);
+        mem_group_record_access(process->group, 1, 0);
     } else {
-        if (!process->page_table[page_number].valid) {
-            load_page(process, page_number, 1); // hard fault
+        int fault = !process->page_table[page_number].valid;
+        if (fault) {
+            load_page(vm, process, page_number, 1); // hard fault
         }
         frame_number = process->page_table[page_number].frame_number;
+        mem_group_record_access(process->group, 0, fault);
     }
     if ((mode == 'r' && !process->page_table[page_number].read_permission) ||
         (mode == 'w' && !process->page_table[page_number].write_permission)) {
         printf("Access violation: Process %d, Page %d, Offset %d, Mode %c\n",
                process->process_id, page_number, offset, mode);
+        vm_unlock(vm);
         return;
     }
+    if (vm->feeds_cache) cache_access((uint64_t)frame_number * PAGE_SIZE + offset);
+    vm_unlock(vm);
     printf("Accessed memory at Frame %d, Offset %d for Process %d, Mode %c\n",
            frame_number, offset, process->process_id, mode);
 }
 
-void free_frames(Process *process) {
+// One access by a scheduled PCB, without printing. A hard fault leaves the
+// page unmapped: the caller blocks the PCB and calls vm_resolve_fault()
+// once the disk read would have finished. Takes the vm pid rather than
+// the Process so the lookup happens under the lock.
+VmAccessResult vm_touch(Vmm *vm, int vm_pid, int page_number, char mode) {
+    int frame_number;
+    VmAccessResult result = VM_TLB_HIT;
+    vm_lock(vm);
+    Process *process = find_process(vm, vm_pid);
+    if (!process) {
+        vm_unlock(vm);
+        return VM_NO_PROCESS;
+    }
+    vm->touches++;
+    tlb_switch(vm, process->process_id);
+    if (!tlb_lookup(vm, process->process_id, page_number, &frame_number)) {
+        if (!process->page_table[page_number].valid) {
+            mem_group_record_access(process->group, 0, 1);
+            vm->touch_faults++;
+            vm_unlock(vm);
+            return VM_HARD_FAULT;
+        }
+        frame_number = process->page_table[page_number].frame_number;
+        tlb_add_entry(vm, process->process_id, page_number, frame_number);
+        result = VM_TLB_MISS;
+    }
+    mem_group_record_access(process->group, result == VM_TLB_HIT, 0);
+    vm->touch_hits += result == VM_TLB_HIT;
+    if (mode == 'w') process->page_table[page_number].modified = 1;
+    if (vm->feeds_cache) cache_access((uint64_t)frame_number * PAGE_SIZE);
+    vm_unlock(vm);
+    return result;
+}
+
+void vm_resolve_fault(Vmm *vm, int vm_pid, int page_number) {
+    vm_lock(vm);
+    Process *process = find_process(vm, vm_pid);
+    // Somebody else's fault may have brought it in meanwhile
+    if (process && !process->page_table[page_number].valid) {
+        tlb_switch(vm, process->process_id);
+        map_page(vm, process, page_number);
+    }
+    vm_unlock(vm);
+}
+
+void free_frames(Vmm *vm, Process *process) {
     for (int i = 0; i < NUM_PAGES; i++) {
         if (process->page_table[i].valid) {
             int f = process->page_table[i].frame_number;
-            frames[f] = (Frame){f, 0, -1, -1};
+            vm->frames[f] = (Frame){f, 0, -1, -1};
+            remove_fifo(vm, f);
+            tlb_invalidate_frame(vm, f);
+            vm->free_frame_stack[vm->free_frame_top++] = f;
+            mem_group_charge(process->group, -1);
             process->page_table[i].valid = 0;
         }
     }
 }
 
-void print_tlb_state() {
+void print_tlb_state(Vmm *vm) {
     printf("\nTLB State:\n");
     for (int i = 0; i < TLB_SIZE; i++) {
-        if (tlb[i].valid) {
+        if (vm->tlb[i].valid) {
             printf("Index %d: Page %d -> Frame %d (Use: %d)\n",
-                   i, tlb[i].page_number, tlb[i].frame_number, tlb[i].use_counter);
+                   i, vm->tlb[i].page_number, vm->tlb[i].frame_number, vm->tlb[i].use_counter);
         }
     }
-    printf("TLB Hits: %d, Misses: %d\n\n", tlb_hits, tlb_misses);
+    printf("TLB Hits: %d, Misses: %d\n\n", vm->tlb_hits, vm->tlb_misses);
 }
 
-void print_memory_state() {
+void print_memory_state(Vmm *vm) {
+    vm_lock(vm);
     printf("\nMemory State:\n");
     for (int i = 0; i < NUM_FRAMES; i++) {
-        if (frames[i].occupied)
+        if (vm->frames[i].occupied)
             printf("Frame %d: Process %d, Page %d\n",
-                   i, frames[i].process_id, frames[i].page_number);
+                   i, vm->frames[i].process_id, vm->frames[i].page_number);
         else
             printf("Frame %d: Free\n", i);
     }
-    print_tlb_state();
+    print_tlb_state(vm);
+    vm_unlock(vm);
 }
 
-void free_process(int vm_pid) {
-    if (vm_pid <= 0 || vm_pid > process_count) {
+void free_process(Vmm *vm, int vm_pid) {
+    vm_lock(vm);
+    int slot = pid_map_find(vm, vm_pid);
+    if (slot < 0) {
+        vm_unlock(vm);
         printf("Invalid VM process ID: %d\n", vm_pid);
         return;
     }
-    Process *process = &processes[vm_pid - 1];
-    free_frames(process);
+    Process *process = vm->processes[slot];
+    free_frames(vm, process);
+    free(process);
+    vm->processes[slot] = NULL;
+    pid_map_remove(vm, vm_pid);
+    vm->free_slots[vm->free_slot_count++] = slot;
+    vm->process_count--;
+    vm_unlock(vm);
+}
+
+// Hands a process restored from a snapshot to a command or PCB. Fails if
+// there is no such process or something already uses it.
+int vm_attach_process(Vmm *vm, int vm_pid) {
+    vm_lock(vm);
+    Process *process = find_process(vm, vm_pid);
+    int rc = process && !process->attached ? 0 : -1;
+    if (rc == 0) process->attached = 1;
+    vm_unlock(vm);
+    return rc;
+}
+
+void print_vm_processes(Vmm *vm) {
+    vm_lock(vm);
+    printf("\nVM Processes:\n");
+    printf("%-6s %-12s %8s %s\n", "VMPID", "GROUP", "RESIDENT", "STATE");
+    for (int slot = 0; slot < vm->process_capacity; slot++) {
+        Process *p = vm->processes[slot];
+        if (!p) continue;
+        int resident = 0;
+        for (int i = 0; i < NUM_PAGES; i++) resident += p->page_table[i].valid;
+        printf("%-6d %-12s %8d %s\n", p->process_id, p->group ? p->group->name : "-", resident,
+               p->attached ? "attached" : "restored");
+    }
+    printf("\n");
+    vm_unlock(vm);
+}
+
+// Snapshot format: a fixed header, the frame/TLB/replacement arrays as-is,
+// the memory groups, then each live process with only its non-default page
+// table entries. Everything is little-endian host order; snapshots are meant
+// for warm starts on the same build, not as an interchange format.
+#define VM_SNAPSHOT_MAGIC 0x4e534d56u   // "VMSN"
+#define VM_SNAPSHOT_VERSION 2     // 2: TLB entries carry an address space ID
+
+typedef struct {
+    uint32_t magic, version;
+    uint32_t page_size, num_pages, num_frames, tlb_size;
+    uint32_t process_count, group_count;
+    int32_t next_vm_pid, tlb_hits, tlb_misses;
+    int32_t fifo_head, fifo_tail, free_frame_top;
+} SnapshotHeader;
+
+typedef struct {
+    char name[MEM_GROUP_NAME_LEN];
+    int32_t parent, hard_limit, soft_limit, usage;
+    int64_t accesses, tlb_hits, faults, evictions, self_reclaims;
+} SnapshotGroup;
+
+typedef struct {
+    int32_t process_id, group, entries;
+} SnapshotProcess;
+
+typedef struct {
+    int16_t page, frame;
+    uint8_t flags;  // valid | modified << 1 | read << 2 | write << 3
+} __attribute__((packed)) SnapshotPage;
+
+static int pte_is_default(const PageTableEntry *e) {
+    return !e->valid && !e->modified && e->read_permission && e->write_permission;
+}
+
+static int save_snapshot(Vmm *vm, const char *filename) {
+    FILE *file = fopen(filename, "wb");
+    if (!file) {
+        perror("Snapshot save error");
+        return -1;
+    }
+    SnapshotHeader header = {VM_SNAPSHOT_MAGIC, VM_SNAPSHOT_VERSION, PAGE_SIZE, NUM_PAGES, NUM_FRAMES,
+                             TLB_SIZE, vm->process_count, mem_group_count, vm->next_vm_pid, vm->tlb_hits, vm->tlb_misses,
+                             vm->fifo_head, vm->fifo_tail, vm->free_frame_top};
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(vm->frames, sizeof(Frame), NUM_FRAMES, file);
+    fwrite(vm->fifo_next, sizeof(int), NUM_FRAMES, file);
+    fwrite(vm->fifo_prev, sizeof(int), NUM_FRAMES, file);
+    fwrite(vm->free_frame_stack, sizeof(int), NUM_FRAMES, file);
+    fwrite(vm->tlb, sizeof(TLBEntry), TLB_SIZE, file);
+
+    for (int i = 0; i < mem_group_count; i++) {
+        MemGroup *g = &mem_groups[i];
+        SnapshotGroup rec = {{0}, g->parent ? g->parent->id : -1, g->hard_limit, g->soft_limit, g->usage,
+                             g->accesses, g->tlb_hits, g->faults, g->evictions, g->self_reclaims};
+        memcpy(rec.name, g->name, MEM_GROUP_NAME_LEN);
+        fwrite(&rec, sizeof(rec), 1, file);
+    }
+
+    for (int slot = 0; slot < vm->process_capacity; slot++) {
+        Process *p = vm->processes[slot];
+        if (!p) continue;
+        SnapshotProcess rec = {p->process_id, p->group ? p->group->id : 0, 0};
+        for (int i = 0; i < NUM_PAGES; i++) rec.entries += !pte_is_default(&p->page_table[i]);
+        fwrite(&rec, sizeof(rec), 1, file);
+        for (int i = 0; i < NUM_PAGES; i++) {
+            PageTableEntry *e = &p->page_table[i];
+            if (pte_is_default(e)) continue;
+            SnapshotPage page = {i, e->frame_number, (uint8_t)(e->valid | e->modified << 1 |
+                                 e->read_permission << 2 | e->write_permission << 3)};
+            fwrite(&page, sizeof(page), 1, file);
+        }
+    }
+
+    int failed = ferror(file);
+    if (fclose(file) != 0 || failed) {
+        perror("Snapshot save error");
+        return -1;
+    }
+    printf("[VMM] Saved snapshot of %d processes to %s\n", vm->process_count, filename);
+    return 0;
+}
+
+static int snap_read(const char **cursor, const char *end, void *dst, size_t size) {
+    if ((size_t)(end - *cursor) < size) return -1;
+    memcpy(dst, *cursor, size);
+    *cursor += size;
+    return 0;
+}
+
+static int pid_compare(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// Every index in the snapshot is known to be in range by now; this checks
+// that the structures agree with each other. A FIFO cycle, a frame owned
+// twice or a stale usage count would otherwise hang or skew the VMM long
+// after the load.
+static int snapshot_consistent(const SnapshotHeader *header, const Frame *frames, const int *next,
+                               const int *prev, const int *stack, const TLBEntry *tlb,
+                               const char *cursor, const char *end) {
+    int occupied = 0, listed = 0, claimed = 0;
+    int in_fifo[NUM_FRAMES] = {0}, on_stack[NUM_FRAMES] = {0};
+    for (int i = 0; i < NUM_FRAMES; i++) occupied += frames[i].occupied;
+
+    // One acyclic chain from head to tail, linked both ways, over exactly
+    // the occupied frames
+    if ((header->fifo_head == -1) != (header->fifo_tail == -1)) return 0;
+    for (int f = header->fifo_head, last = -1; f != -1; last = f, f = next[f]) {
+        if (in_fifo[f] || !frames[f].occupied || prev[f] != last) return 0;
+        if (next[f] == -1 && f != header->fifo_tail) return 0;
+        in_fifo[f] = 1;
+        listed++;
+    }
+    if (listed != occupied) return 0;
+    for (int i = 0; i < NUM_FRAMES; i++) {
+        if (!in_fifo[i] && (next[i] != -1 || prev[i] != -1)) return 0;
+    }
+
+    // Every free frame is on the stack, once
+    if (header->free_frame_top != NUM_FRAMES - occupied) return 0;
+    for (int i = 0; i < header->free_frame_top; i++) {
+        if (frames[stack[i]].occupied || on_stack[stack[i]]++) return 0;
+    }
+
+    for (int i = 0; i < TLB_SIZE; i++) {
+        const TLBEntry *e = &tlb[i];
+        const Frame *f = &frames[e->frame_number];
+        if (e->valid && (!f->occupied || f->process_id != e->asid || f->page_number != e->page_number)) return 0;
+    }
+
+    // Only the root has no parent, and parents come before their children
+    int parent[MAX_MEM_GROUPS], usage[MAX_MEM_GROUPS], resident[MAX_MEM_GROUPS] = {0};
+    for (uint32_t i = 0; i < header->group_count; i++) {
+        SnapshotGroup rec = {{0}};
+        snap_read(&cursor, end, &rec, sizeof(rec));
+        if (i == 0 ? rec.parent != -1 : rec.parent < 0 || (uint32_t)rec.parent >= i) return 0;
+        if (rec.hard_limit < 0 || rec.soft_limit < 0) return 0;
+        parent[i] = rec.parent;
+        usage[i] = rec.usage;
+    }
+
+    // Each valid page sits in a frame that names it as the owner, so no
+    // frame is claimed twice once pids and pages are unique
+    int *pids = header->process_count ? malloc(header->process_count * sizeof(int)) : NULL;
+    int ok = header->process_count == 0 || pids;
+    for (uint32_t i = 0; ok && i < header->process_count; i++) {
+        SnapshotProcess rec = {0};
+        int seen[NUM_PAGES] = {0};
+        snap_read(&cursor, end, &rec, sizeof(rec));
+        pids[i] = rec.process_id;
+        for (int j = 0; j < rec.entries; j++) {
+            SnapshotPage page = {0};
+            snap_read(&cursor, end, &page, sizeof(page));
+            if (seen[page.page]++) ok = 0;
+            if (!(page.flags & 1)) continue;
+            const Frame *f = &frames[page.frame];
+            if (!f->occupied || f->process_id != rec.process_id || f->page_number != page.page) ok = 0;
+            claimed++;
+            for (int g = rec.group; g != -1; g = parent[g]) resident[g]++;
+        }
+    }
+    if (ok && header->process_count > 1) {
+        qsort(pids, header->process_count, sizeof(int), pid_compare);
+        for (uint32_t i = 1; ok && i < header->process_count; i++) ok = pids[i] != pids[i - 1];
+    }
+    free(pids);
+    if (!ok || claimed != occupied) return 0;
+    for (uint32_t i = 0; i < header->group_count; i++) {
+        if (usage[i] != resident[i]) return 0;
+    }
+    return 1;
+}
+
+// Rebuilds the VMM from a snapshot mapped read-only into memory. The current
+// state is only replaced once the whole file has been validated.
+static int load_snapshot(Vmm *vm, const char *filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        perror("Snapshot load error");
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(SnapshotHeader)) {
+        fprintf(stderr, "Snapshot load error: %s is truncated\n", filename);
+        close(fd);
+        return -1;
+    }
+    const char *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("Snapshot load error");
+        return -1;
+    }
+    // A command or PCB still holds the vm pid of each attached process, and
+    // a restored process could reuse it
+    int attached = 0;
+    for (int slot = 0; slot < vm->process_capacity; slot++) attached += vm->processes[slot] && vm->processes[slot]->attached;
+    if (attached) {
+        fprintf(stderr, "Snapshot load error: %d VM processes are in use, end them first\n", attached);
+        munmap((void *)base, st.st_size);
+        return -1;
+    }
+    const char *cursor = base, *end = base + st.st_size;
+
+    SnapshotHeader header;
+    snap_read(&cursor, end, &header, sizeof(header));
+    if (header.magic != VM_SNAPSHOT_MAGIC || header.version != VM_SNAPSHOT_VERSION ||
+        header.page_size != PAGE_SIZE || header.num_pages != NUM_PAGES ||
+        header.num_frames != NUM_FRAMES || header.tlb_size != TLB_SIZE ||
+        header.group_count == 0 || header.group_count > MAX_MEM_GROUPS) {
+        fprintf(stderr, "Snapshot load error: %s does not match this VMM layout\n", filename);
+        munmap((void *)base, st.st_size);
+        return -1;
+    }
+
+    // Parse and validate the whole file before touching live state; every
+    // frame and page index in it is range checked before anything indexes
+    // with it, then snapshot_consistent() checks the structures agree
+    Frame new_frames[NUM_FRAMES];
+    int new_next[NUM_FRAMES], new_prev[NUM_FRAMES], new_stack[NUM_FRAMES];
+    TLBEntry new_tlb[TLB_SIZE];
+    int valid = snap_read(&cursor, end, new_frames, sizeof(new_frames)) == 0 &&
+                snap_read(&cursor, end, new_next, sizeof(new_next)) == 0 &&
+                snap_read(&cursor, end, new_prev, sizeof(new_prev)) == 0 &&
+                snap_read(&cursor, end, new_stack, sizeof(new_stack)) == 0 &&
+                snap_read(&cursor, end, new_tlb, sizeof(new_tlb)) == 0 &&
+                header.fifo_head >= -1 && header.fifo_head < NUM_FRAMES &&
+                header.fifo_tail >= -1 && header.fifo_tail < NUM_FRAMES &&
+                header.free_frame_top >= 0 && header.free_frame_top <= NUM_FRAMES &&
+                header.next_vm_pid > 0;
+    for (int i = 0; valid && i < NUM_FRAMES; i++) {
+        Frame *f = &new_frames[i];
+        valid = f->frame_number == i && new_next[i] >= -1 && new_next[i] < NUM_FRAMES &&
+                new_prev[i] >= -1 && new_prev[i] < NUM_FRAMES &&
+                (f->occupied ? f->occupied == 1 && f->process_id > 0 && f->page_number >= 0 &&
+                               f->page_number < NUM_PAGES
+                             : f->process_id == -1 && f->page_number == -1);
+    }
+    for (int i = 0; valid && i < header.free_frame_top; i++) {
+        valid = new_stack[i] >= 0 && new_stack[i] < NUM_FRAMES;
+    }
+    for (int i = 0; valid && i < TLB_SIZE; i++) {
+        valid = !new_tlb[i].valid || (new_tlb[i].page_number >= 0 && new_tlb[i].page_number < NUM_PAGES &&
+                                      new_tlb[i].frame_number >= 0 && new_tlb[i].frame_number < NUM_FRAMES);
+    }
+    const char *groups = cursor;
+    if (valid) valid = (size_t)(end - cursor) >= sizeof(SnapshotGroup) * header.group_count;
+    if (valid) cursor += sizeof(SnapshotGroup) * header.group_count;
+    for (uint32_t i = 0; valid && i < header.process_count; i++) {
+        SnapshotProcess rec;
+        valid = snap_read(&cursor, end, &rec, sizeof(rec)) == 0 && rec.process_id > 0 &&
+                rec.process_id < header.next_vm_pid && rec.entries >= 0 && rec.entries <= NUM_PAGES &&
+                (uint32_t)rec.group < header.group_count;
+        for (int j = 0; valid && j < rec.entries; j++) {
+            SnapshotPage page;
+            valid = snap_read(&cursor, end, &page, sizeof(page)) == 0 && page.page >= 0 &&
+                    page.page < NUM_PAGES && page.frame >= -1 && page.frame < NUM_FRAMES &&
+                    (!(page.flags & 1) || page.frame >= 0);
+        }
+    }
+    if (valid) {
+        valid = snapshot_consistent(&header, new_frames, new_next, new_prev, new_stack, new_tlb, groups, end);
+    }
+    if (!valid) {
+        fprintf(stderr, "Snapshot load error: %s is corrupt\n", filename);
+        munmap((void *)base, st.st_size);
+        return -1;
+    }
+
+    for (int slot = 0; slot < vm->process_capacity; slot++) {
+        if (vm->processes[slot]) free_process(vm, vm->processes[slot]->process_id);
+    }
+
+    memcpy(vm->frames, new_frames, sizeof(vm->frames));
+    memcpy(vm->fifo_next, new_next, sizeof(vm->fifo_next));
+    memcpy(vm->fifo_prev, new_prev, sizeof(vm->fifo_prev));
+    memcpy(vm->free_frame_stack, new_stack, sizeof(vm->free_frame_stack));
+    memcpy(vm->tlb, new_tlb, sizeof(vm->tlb));
+    vm->tlb_asid = 0;
+    vm->fifo_head = header.fifo_head;
+    vm->fifo_tail = header.fifo_tail;
+    vm->free_frame_top = header.free_frame_top;
+    vm->tlb_hits = header.tlb_hits;
+    vm->tlb_misses = header.tlb_misses;
+    cursor = groups;
+
+    mem_group_count = header.group_count;
+    for (int i = 0; i < mem_group_count; i++) {
+        SnapshotGroup rec = {{0}};
+        snap_read(&cursor, end, &rec, sizeof(rec));
+        MemGroup *g = &mem_groups[i];
+        memcpy(g->name, rec.name, MEM_GROUP_NAME_LEN);
+        g->name[MEM_GROUP_NAME_LEN - 1] = '\0';
+        g->id = i;
+        g->parent = rec.parent >= 0 ? &mem_groups[rec.parent] : NULL;
+        g->hard_limit = rec.hard_limit;
+        g->soft_limit = rec.soft_limit;
+        g->usage = rec.usage;
+        g->accesses = rec.accesses;
+        g->tlb_hits = rec.tlb_hits;
+        g->faults = rec.faults;
+        g->evictions = rec.evictions;
+        g->self_reclaims = rec.self_reclaims;
+    }
+    root_mem_group = &mem_groups[0];
+
+    for (uint32_t i = 0; i < header.process_count; i++) {
+        SnapshotProcess rec = {0};
+        snap_read(&cursor, end, &rec, sizeof(rec));
+        if (vm->free_slot_count == 0 && grow_process_table(vm) < 0) break;
+        Process *p = malloc(sizeof(Process));
+        if (!p) break;
+        int slot = vm->free_slots[--vm->free_slot_count];
+        p->process_id = rec.process_id;
+        p->attached = 0;
+        p->group = &mem_groups[rec.group];
+        initialize_page_table(p);
+        for (int j = 0; j < rec.entries; j++) {
+            SnapshotPage page = {0};
+            snap_read(&cursor, end, &page, sizeof(page));
+            p->page_table[page.page] = (PageTableEntry){page.frame, page.flags & 1, (page.flags >> 1) & 1,
+                                                        (page.flags >> 2) & 1, (page.flags >> 3) & 1};
+        }
+        vm->processes[slot] = p;
+        pid_map_insert(vm, p->process_id, slot);
+        vm->process_count++;
+    }
+    vm->next_vm_pid = header.next_vm_pid;
+
+    munmap((void *)base, st.st_size);
+    printf("[VMM] Restored snapshot of %d processes from %s\n", vm->process_count, filename);
+    return 0;
+}
+
+int save_vm_snapshot(const char *filename) {
+    vm_lock(&vmm);
+    int rc = save_snapshot(&vmm, filename);
+    vm_unlock(&vmm);
+    return rc;
+}
+
+int load_vm_snapshot(const char *filename) {
+    vm_lock(&vmm);
+    int rc = load_snapshot(&vmm, filename);
+    vm_unlock(&vmm);
+    return rc;
 }
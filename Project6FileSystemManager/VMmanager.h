@@ -1,18 +1,20 @@
 #ifndef VMMANAGER_H
 #define VMMANAGER_H
 
+#include <pthread.h>
+
 #define PAGE_SIZE 4096
 #define NUM_PAGES 50
 #define NUM_FRAMES 25
-#define MAX_PROCESSES 20
+#define INITIAL_PROCESS_SLOTS 20
 #define TLB_SIZE 8
 
-extern int tlb_hits;
-extern int tlb_misses;
-extern int process_count;
-extern int fifo_queue[];
-extern int fifo_front;
-extern int fifo_rear;
+// TLB_FLUSH empties the TLB whenever another address space runs, like a
+// CPU without address space IDs; TLB_TAGGED keeps each entry under its
+// process ID so entries survive the switch
+typedef enum { TLB_FLUSH, TLB_TAGGED } TlbMode;
+
+typedef enum { VM_TLB_HIT, VM_TLB_MISS, VM_HARD_FAULT, VM_NO_PROCESS } VmAccessResult;
 
 typedef struct {
     int frame_number;
@@ -22,8 +24,12 @@ typedef struct {
     int write_permission;
 } PageTableEntry;
 
+struct MemGroup;
+
 typedef struct {
     int process_id;
+    int attached;               // created for a command or PCB, not restored from a snapshot
+    struct MemGroup *group;     // frames are charged here, see memGroup.h
     PageTableEntry page_table[NUM_PAGES];
 } Process;
 
@@ -39,27 +45,79 @@ typedef struct {
     int frame_number;
     int valid;
     int use_counter; // for LRU
+    int asid;        // owning process ID
 } TLBEntry;
 
-extern Frame frames[NUM_FRAMES];
-extern Process processes[MAX_PROCESSES];
-extern TLBEntry tlb[TLB_SIZE];
+// One virtual memory manager: frames, TLB, replacement order and the
+// address spaces using them. The shell and the live scheduler share vmm;
+// each simulation runs on its own, so neither ever waits for the other.
+typedef struct Vmm {
+    pthread_mutex_t lock;       // recursive, since the entry points below nest
+    Frame frames[NUM_FRAMES];
+    TLBEntry tlb[TLB_SIZE];
+
+    // Page replacement order, kept as a doubly linked list over frame indices
+    // so a frame can leave the queue in O(1) when its owner exits
+    int fifo_head, fifo_tail;
+    int fifo_next[NUM_FRAMES], fifo_prev[NUM_FRAMES];
+
+    // Free frames are handed out from a stack instead of scanning frames[]
+    int free_frame_stack[NUM_FRAMES];
+    int free_frame_top;
 
-void enqueue_fifo(int frame_index);
-int dequeue_fifo();
+    // Process table: slots are recycled through a free list and looked up by
+    // pid through an open-addressing hash, so the table stays bounded under churn
+    Process **processes;
+    int process_capacity, process_count;
+    int *free_slots, free_slot_count;
+    int *pid_keys;              // 0 marks an empty bucket
+    int *pid_slots;
+    int pid_buckets;            // always a power of two
+    int next_vm_pid;
+    struct MemGroup *root_group;    // new address spaces are charged here
+
+    TlbMode tlb_mode;
+    int tlb_asid;               // address space the TLB was last used for
+    int tlb_clock;              // stamps use_counter, so the smallest is least recent
+    int tlb_hits, tlb_misses;
+    long tlb_flushes, address_space_switches;
+    long touches, touch_hits, touch_faults;     // by scheduled PCBs through vm_touch()
+    int feeds_cache;            // accesses also run through the cache model
+} Vmm;
+
+extern Vmm vmm;
+
+void enqueue_fifo(Vmm *vm, int frame_index);
+int dequeue_fifo(Vmm *vm);
+void remove_fifo(Vmm *vm, int frame_index);
 void initialize();
+void vmm_init(Vmm *vm, struct MemGroup *root_group);
+void vmm_destroy(Vmm *vm);
 void initialize_page_table(Process *process);
-int create_process();
-int allocate_frame();
-void simulate_disk_io();
+int create_process(Vmm *vm);
+Process *find_process(Vmm *vm, int vm_pid);
+int allocate_frame(Vmm *vm, Process*);
+void set_process_group(Vmm *vm, Process*, struct MemGroup*);
+void vm_lock(Vmm *vm);
+void vm_unlock(Vmm *vm);
 void log_page_fault(int, int, const char*);
-int tlb_lookup(int, int*);
-void tlb_add_entry(int, int);
-void load_page(Process*, int, int);
-void free_frames(Process *process);
-void print_tlb_state();
-void access_memory(Process*, int, int, char);
-void free_process(int vm_pid);
-void print_memory_state();
-
-#endif
\ No newline at end of file
+void tlb_switch(Vmm *vm, int asid);
+void tlb_set_mode(Vmm *vm, TlbMode mode);
+int tlb_lookup(Vmm *vm, int, int, int*);
+void tlb_add_entry(Vmm *vm, int, int, int);
+void tlb_invalidate_frame(Vmm *vm, int frame_number);
+void load_page(Vmm *vm, Process*, int, int);
+void free_frames(Vmm *vm, Process *process);
+void print_tlb_state(Vmm *vm);
+void access_memory(Vmm *vm, Process*, int, int, char);
+VmAccessResult vm_touch(Vmm *vm, int vm_pid, int, char);
+void vm_resolve_fault(Vmm *vm, int vm_pid, int);
+void free_process(Vmm *vm, int vm_pid);
+void print_memory_state(Vmm *vm);
+int vm_attach_process(Vmm *vm, int vm_pid);
+void print_vm_processes(Vmm *vm);
+// Snapshots cover the shell's VMM and memory groups
+int save_vm_snapshot(const char *filename);
+int load_vm_snapshot(const char *filename);
+
+#endif
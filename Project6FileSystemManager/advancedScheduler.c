@@ -1,297 +1,1273 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <pthread.h>
 #include <unistd.h>
 #include <string.h>
 #include <limits.h>
+#include <time.h>
+#include <sched.h>
+#include <poll.h>
+#include <sys/timerfd.h>
 #include "advancedScheduler.h"
+#include "metrics.h"
+#include "trace.h"
+#include "realSched.h"
+#include "vmSched.h"
+#include "banker.h"
+
+#define REFILL_BATCH 8
+#define BALANCE_INTERVAL 16     // dispatches between load-balance passes
+#define IO_DEFAULT_CHANCE 5     // 1 in n ticks blocks for I/O unless the job says otherwise
 
 // Global instances
-Queue ready_queue = {NULL, NULL, PTHREAD_MUTEX_INITIALIZER};
-Queue wait_queue  = {NULL, NULL, PTHREAD_MUTEX_INITIALIZER};
-TimeManager tm = { .current_quantum = 2, .time_used = 0, .lock = PTHREAD_MUTEX_INITIALIZER };
+EventCount sched_state = EVENT_COUNT_INITIALIZER;
+Queue ready_queue = { .lock = PTHREAD_MUTEX_INITIALIZER, .ordered = 1, .policy = POLICY_PRIORITY,
+                      .changed = EVENT_COUNT_INITIALIZER, .observer = &sched_state };
+Queue wait_queue  = { .lock = PTHREAD_MUTEX_INITIALIZER, .ordered = 0,
+                      .changed = EVENT_COUNT_INITIALIZER, .observer = &sched_state };
+TimeManager tm = { .timer_fd = -1 };
+atomic_int sched_slice_ms = 0;
+CpuSet cpu_set = { &ready_queue, NULL, 0 };
 const char *state_str[] = { "NEW", "READY", "RUNNING", "WAITING", "TERMINATED" };
-int next_pid = 1;
+atomic_int next_pid = 1;
+
+// Event counts
+void event_init(EventCount *ec) {
+    pthread_mutex_init(&ec->lock, NULL);
+    pthread_cond_init(&ec->cond, NULL);
+    atomic_init(&ec->generation, 0);
+    atomic_init(&ec->waiters, 0);
+}
+
+unsigned long event_prepare(EventCount *ec) {
+    return atomic_load(&ec->generation);
+}
+
+// Sleeps until notified after event_prepare() returned gen, or until the
+// absolute CLOCK_REALTIME deadline if one is given
+void event_wait(EventCount *ec, unsigned long gen, const struct timespec *deadline) {
+    pthread_mutex_lock(&ec->lock);
+    atomic_fetch_add(&ec->waiters, 1);
+    int rc = 0;
+    while (atomic_load(&ec->generation) == gen && rc == 0) {
+        if (deadline) rc = pthread_cond_timedwait(&ec->cond, &ec->lock, deadline);
+        else pthread_cond_wait(&ec->cond, &ec->lock);
+    }
+    atomic_fetch_sub(&ec->waiters, 1);
+    pthread_mutex_unlock(&ec->lock);
+}
+
+void event_notify(EventCount *ec) {
+    atomic_fetch_add(&ec->generation, 1);
+    if (atomic_load(&ec->waiters) == 0) return;
+    pthread_mutex_lock(&ec->lock);
+    pthread_cond_broadcast(&ec->cond);
+    pthread_mutex_unlock(&ec->lock);
+}
 
 // Timer management
-void setup_timer_interrupt(int quantum) {
-    pthread_mutex_lock(&tm.lock);
-    tm.current_quantum = quantum;
-    tm.time_used = 0;
-    pthread_mutex_unlock(&tm.lock);
+static long long monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static struct timespec ns_to_timespec(long long ns) {
+    struct timespec ts = { ns / 1000000000LL, ns % 1000000000LL };
+    return ts;
+}
+
+// A policy quantum of n lasts n units: sched_slice_ms each, or a whole
+// tick when that is 0
+long long quantum_unit_ns() {
+    int ms = atomic_load(&sched_slice_ms);
+    return ms > 0 ? ms * 1000000LL : SCHED_TICK_NS;
+}
+
+void set_slice_ms(int ms) {
+    atomic_store(&sched_slice_ms, ms > 0 ? ms : 0);
+}
+
+// Called by the dispatcher that owns t, so the fd is per thread
+void timer_manager_init(TimeManager *t) {
+    t->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (t->timer_fd < 0) perror("timerfd_create, quanta will be polled");
+    atomic_init(&t->expired, 0);
+    t->expiries = 0;
+    t->max_late_ns = 0;
+}
+
+void setup_timer_interrupt(TimeManager *t, int quantum) {
+    t->quantum_ns = (quantum > 0 ? quantum : 1) * quantum_unit_ns();
+    t->deadline_ns = monotonic_ns() + t->quantum_ns;
+    atomic_store(&t->expired, 0);
+    if (t->timer_fd >= 0) {
+        // Absolute, so time spent getting here is not added to the quantum
+        struct itimerspec its = { .it_value = ns_to_timespec(t->deadline_ns) };
+        timerfd_settime(t->timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+    }
+}
+
+void cancel_timer_interrupt(TimeManager *t) {
+    if (t->timer_fd < 0) return;
+    struct itimerspec off = { 0 };
+    timerfd_settime(t->timer_fd, 0, &off, NULL);
+}
+
+// Lets the running PCB run for up to max_ns, returning early when its
+// quantum expires. Returns the nanoseconds that really passed.
+long long timer_run(TimeManager *t, long long max_ns) {
+    long long start = monotonic_ns();
+    if (t->timer_fd >= 0) {
+        struct pollfd pfd = { .fd = t->timer_fd, .events = POLLIN };
+        struct timespec timeout = ns_to_timespec(max_ns);
+        if (ppoll(&pfd, 1, &timeout, NULL) > 0) {
+            uint64_t fired;
+            if (read(t->timer_fd, &fired, sizeof(fired)) < 0) perror("timerfd read");
+        }
+    } else {
+        long long left = t->deadline_ns - start;
+        struct timespec ts = ns_to_timespec(left > 0 && left < max_ns ? left : max_ns);
+        if (left > 0) nanosleep(&ts, NULL);
+    }
+    long long now = monotonic_ns();
+    if (now >= t->deadline_ns && !atomic_load(&t->expired)) {
+        atomic_store(&t->expired, 1);
+        t->expiries++;
+        if (now - t->deadline_ns > t->max_late_ns) t->max_late_ns = now - t->deadline_ns;
+    }
+    return now - start;
 }
 
 void handle_timer_interrupt() {
-    pthread_mutex_lock(&tm.lock);
-    tm.time_used++;
-    pthread_mutex_unlock(&tm.lock);
+    atomic_fetch_add(&tm.ticks, 1);
 }
 
-bool should_preempt() {
-    pthread_mutex_lock(&tm.lock);
-    bool preempt = tm.time_used >= tm.current_quantum;
-    pthread_mutex_unlock(&tm.lock);
-    return preempt;
+long current_tick() {
+    return atomic_load(&tm.ticks);
+}
+
+bool should_preempt(TimeManager *t) {
+    return atomic_load(&t->expired);
+}
+
+void print_quantum_stats() {
+    int ms = atomic_load(&sched_slice_ms);
+    if (ms > 0) printf("[Quantum] One quantum unit is %d ms (a tick of work is %d ms)\n", ms, SCHED_TICK_MS);
+    else printf("[Quantum] One quantum unit is a whole tick (%d ms)\n", SCHED_TICK_MS);
+    if (!cpu_set.cpus) return;
+    printf("CPU  TIMER     EXPIRIES  MAX LATE(us)\n");
+    for (int i = 0; i < cpu_set.num_cpus; i++) {
+        TimeManager *t = &cpu_set.cpus[i].tm;
+        printf("%3d  %-8s %9ld %13.1f\n", i, t->timer_fd >= 0 ? "timerfd" : "sleep", t->expiries,
+               t->max_late_ns / 1000.0);
+    }
+}
+
+static long queue_now(Queue *q) {
+    return q->clock ? q->clock() : current_tick();
+}
+
+static const SchedPolicy *queue_ops(Queue *q) {
+    return q->ordered ? &sched_policies[q->policy] : &sched_policies[POLICY_FCFS];
+}
+
+// Insert and remove with q->lock already held
+static int queue_insert_locked(Queue *q, PCB *p) {
+    p->seq = q->next_seq++;
+    p->age_stamp = queue_now(q);
+    return queue_ops(q)->enqueue(q, p);
+}
+
+// Puts back a PCB that was removed only to be looked at, keeping its place
+// in ordered policies and charging it nothing
+static void queue_restore_locked(Queue *q, PCB *p) {
+    p->exec_start = p->cpu_time_used;
+    if (queue_ops(q)->enqueue(q, p) < 0) perror("enqueue");
+}
+
+// Re-keys a queued PCB in O(log n)
+static void change_priority_locked(Queue *q, PCB *p, int priority) {
+    const SchedPolicy *ops = queue_ops(q);
+    int queued = ops->remove && ops->remove(q, p);
+    p->priority = priority;
+    if (queued) queue_restore_locked(q, p);
+}
+
+// Priority aging: every age_interval ticks a PCB spends queued it gains a
+// level. The aging list is in queueing order, so only PCBs that are due get
+// looked at; a PCB put back by dequeue_allowed() keeps its stamp and its
+// boost, and may be aged up to an interval late. Done lazily before a pick,
+// the only time priorities matter. The boost is dropped by dispatched().
+static void queue_age_locked(Queue *q) {
+    long now = queue_now(q);
+    PCB *p;
+    while ((p = q->age_head) && now - p->age_stamp >= q->age_interval) {
+        p->age_stamp = now;
+        // Re-keying also moves it to the end of the aging list
+        change_priority_locked(q, p, p->priority > 0 ? p->priority - 1 : 0);
+        q->agings++;
+    }
+}
+
+static PCB *queue_remove_locked(Queue *q) {
+    if (q->count == 0) return NULL;
+    if (q->ordered && q->policy == POLICY_PRIORITY && q->age_interval > 0) queue_age_locked(q);
+    PCB *p = queue_ops(q)->pick_next(q);
+    if (p) p->exec_start = p->cpu_time_used;
+    return p;
+}
+
+// A PCB handed out to run goes back to its own priority. Not done on every
+// removal, since affinity skips and requeues put PCBs straight back.
+static PCB *dispatched(PCB *p) {
+    if (p) p->priority = p->base_priority;
+    return p;
+}
+
+// Lock-free mode
+static int queue_fifo(Queue *q) {
+    return !q->ordered || q->policy == POLICY_FCFS;
+}
+
+// Moves ring arrivals into the policy structure, oldest first
+static void queue_drain_locked(Queue *q) {
+    PCB *p;
+    if (!q->inbox) return;
+    while ((p = ring_pop(q->inbox))) {
+        if (queue_insert_locked(q, p) < 0) perror("enqueue");
+    }
+}
+
+// For anything that looks at the queue's contents
+static void queue_lock(Queue *q) {
+    pthread_mutex_lock(&q->lock);
+    queue_drain_locked(q);
+}
+
+static void queue_unlock(Queue *q) {
+    if (q->inbox) atomic_store_explicit(&q->backlog, q->count, memory_order_release);
+    pthread_mutex_unlock(&q->lock);
+}
+
+// FIFO queues pop from the ring only while nothing older sits in the list.
+// A drain racing with the pop can let a newer PCB go first; that is the
+// price of not taking the lock.
+static PCB *queue_pop_fast(Queue *q) {
+    if (!q->inbox || !queue_fifo(q) || atomic_load_explicit(&q->backlog, memory_order_acquire) > 0) return NULL;
+    PCB *p = ring_pop(q->inbox);
+    if (p) p->exec_start = p->cpu_time_used;
+    return p;
+}
+
+// Call before any other thread uses the queue
+int queue_enable_lockfree(Queue *q) {
+    if (q->inbox) return 0;
+    q->inbox = ring_create();
+    if (!q->inbox) return -1;
+    atomic_init(&q->backlog, q->count);
+    return 0;
+}
+
+int queue_size(Queue *q) {
+    pthread_mutex_lock(&q->lock);
+    int count = q->count;
+    pthread_mutex_unlock(&q->lock);
+    return count + (q->inbox ? ring_size(q->inbox) : 0);
 }
 
 // Queue utilities
 void enqueue(Queue *q, PCB *p) {
+    // A full ring falls back to the lock, after draining so order is kept
+    if (!q->inbox || ring_push(q->inbox, p) < 0) {
+        queue_lock(q);
+        if (queue_insert_locked(q, p) < 0) perror("enqueue");
+        queue_unlock(q);
+    }
+    event_notify(&q->changed);
+    if (q->observer) event_notify(q->observer);
+}
+
+// Many PCBs for one lock round trip and one wakeup
+void enqueue_batch(Queue *q, PCB **pcbs, int n) {
+    if (n <= 0) return;
+    queue_lock(q);
+    for (int i = 0; i < n; i++) {
+        if (queue_insert_locked(q, pcbs[i]) < 0) perror("enqueue");
+    }
+    queue_unlock(q);
+    event_notify(&q->changed);
+    if (q->observer) event_notify(q->observer);
+}
+
+int queue_remove(Queue *q, PCB *p) {
+    queue_lock(q);
+    int removed = queue_ops(q)->remove && queue_ops(q)->remove(q, p);
+    queue_unlock(q);
+    return removed;
+}
+
+PCB* dequeue(Queue *q) {
+    PCB *p = queue_pop_fast(q);
+    if (p) return dispatched(p);
+    queue_lock(q);
+    p = queue_remove_locked(q);
+    queue_unlock(q);
+    return dispatched(p);
+}
+
+// Best PCB allowed on the given CPU; anything skipped keeps its place
+PCB *dequeue_allowed(Queue *q, int cpu_id) {
+    PCB *skipped = NULL, *p;
+    queue_lock(q);
+    while ((p = queue_remove_locked(q)) && !((p->affinity >> cpu_id) & 1)) {
+        p->next = skipped;
+        skipped = p;
+    }
+    while (skipped) {
+        PCB *next = skipped->next;
+        queue_restore_locked(q, skipped);
+        skipped = next;
+    }
+    queue_unlock(q);
+    return dispatched(p);
+}
+
+// Policy hooks around a dispatch
+int queue_quantum(Queue *q, PCB *p) {
     pthread_mutex_lock(&q->lock);
-    p->next = NULL;
-    if (q->tail) q->tail->next = p;
-    else q->head = p;
-    q->tail = p;
+    int quantum = queue_ops(q)->quantum(q, p);
     pthread_mutex_unlock(&q->lock);
+    return quantum;
 }
 
-PCB* dequeue(Queue *q) {
+int queue_on_tick(Queue *q, PCB *p) {
+    int preempt = 0;
     pthread_mutex_lock(&q->lock);
-    if (!q->head) {
-        pthread_mutex_unlock(&q->lock);
-        return NULL;
+    if (queue_ops(q)->on_tick) {
+        // Arrivals still in the ring count for preemption too
+        queue_drain_locked(q);
+        preempt = queue_ops(q)->on_tick(q, p);
     }
+    queue_unlock(q);
+    return preempt;
+}
+
+// Whether a PCB becoming ready can cut a running burst short
+int queue_preempts_on_arrival(Queue *q) {
+    return queue_ops(q)->on_tick != NULL;
+}
+
+void queue_on_preempt(Queue *q, PCB *p) {
+    pthread_mutex_lock(&q->lock);
+    if (queue_ops(q)->on_preempt) queue_ops(q)->on_preempt(q, p);
+    pthread_mutex_unlock(&q->lock);
+}
 
-    PCB *prev = NULL, *curr = q->head;
-    PCB *best_node = curr, *best_prev = NULL;
-    int best_priority = curr->priority, best_time_limit = curr->time_limit;
+void queue_on_block(Queue *q, PCB *p) {
+    pthread_mutex_lock(&q->lock);
+    if (queue_ops(q)->on_block) queue_ops(q)->on_block(q, p);
+    pthread_mutex_unlock(&q->lock);
+}
 
-    while (curr) {
-        if (curr->priority < best_priority ||
-           (curr->priority == best_priority && curr->time_limit < best_time_limit)) {
-            best_priority = curr->priority;
-            best_time_limit = curr->time_limit;
-            best_node = curr;
-            best_prev = prev;
+void queue_on_wake(Queue *q, PCB *p) {
+    pthread_mutex_lock(&q->lock);
+    if (queue_ops(q)->on_wake) queue_ops(q)->on_wake(q, p);
+    pthread_mutex_unlock(&q->lock);
+}
+
+// Arrival-time admission and deadline tracking. Returns -1 if the policy
+// turns the PCB away; the caller still owns it then.
+int queue_admit(Queue *q, PCB *p) {
+    int admitted = 0;
+    pthread_mutex_lock(&q->lock);
+    if (!p->rt_task) {
+        if (queue_ops(q)->admit && !queue_ops(q)->admit(q, p)) {
+            q->edf.rejected++;
+            admitted = -1;
+        } else if (edf_register(&q->edf, p) < 0) {
+            admitted = -1;
         }
-        prev = curr;
-        curr = curr->next;
     }
+    pthread_mutex_unlock(&q->lock);
+    return admitted;
+}
+
+// Called when a PCB finishes. Returns 1 if it was recycled as the next
+// instance of a periodic task instead of being done.
+int queue_on_exit(Queue *q, PCB *p) {
+    pthread_mutex_lock(&q->lock);
+    if (queue_ops(q)->on_exit) queue_ops(q)->on_exit(q, p);
+    int again = edf_complete(&q->edf, p, queue_now(q));
+    pthread_mutex_unlock(&q->lock);
+    return again;
+}
 
-    if (best_node == q->head) {
-        q->head = best_node->next;
-        if (q->tail == best_node) q->tail = NULL;
-    } else if (best_prev) {
-        best_prev->next = best_node->next;
-        if (q->tail == best_node) q->tail = best_prev;
+// Moves everything queued under the old policy into the new one
+static void requeue_locked(Queue *q, SchedPolicyType policy) {
+    PCB *drained = NULL, *last = NULL, *p;
+    // Fair share would hold back groups that are out of quota
+    q->fair.draining = 1;
+    while ((p = queue_remove_locked(q))) {
+        if (last) last->next = p;
+        else drained = p;
+        last = p;
     }
+    q->fair.draining = 0;
+    q->policy = policy;
+    while (drained) {
+        p = drained;
+        drained = p->next;
+        queue_insert_locked(q, p);
+    }
+}
+
+void set_sched_policy(Queue *q, SchedPolicyType policy) {
+    queue_lock(q);
+    if (policy == POLICY_MLFQ && q->mlfq.levels == 0) mlfq_init(&q->mlfq, 3, NULL, 50);
+    if (policy == POLICY_CFS && q->cfs.target_latency == 0) cfs_init(&q->cfs, 6, 1);
+    if (policy == POLICY_O1 && !q->o1.initialized) {
+        o1_init(&q->o1, O1_DEFAULT_AGE_INTERVAL, O1_DEFAULT_STARVATION_LIMIT);
+        q->o1.last_aging = queue_now(q);
+    }
+    if (policy == POLICY_FAIR && !q->fair.initialized) {
+        fair_init(&q->fair, q->cfs.target_latency ? q->cfs.target_latency : 6,
+                  q->cfs.min_granularity ? q->cfs.min_granularity : 1);
+    }
+    requeue_locked(q, policy);
+    queue_unlock(q);
+}
 
-    best_node->next = NULL;
+void set_policy_slice(Queue *q, int slice) {
+    pthread_mutex_lock(&q->lock);
+    q->slice = slice;
     pthread_mutex_unlock(&q->lock);
-    return best_node;
+}
+
+void configure_mlfq(Queue *q, int levels, const int *quanta, int boost_interval) {
+    queue_lock(q);
+    SchedPolicyType policy = q->policy;
+    requeue_locked(q, POLICY_FCFS);
+    mlfq_init(&q->mlfq, levels, quanta, boost_interval);
+    q->mlfq.last_boost = queue_now(q);
+    requeue_locked(q, policy);
+    queue_unlock(q);
+}
+
+void configure_cfs(Queue *q, int target_latency, int min_granularity) {
+    queue_lock(q);
+    SchedPolicyType policy = q->policy;
+    requeue_locked(q, POLICY_FCFS);
+    cfs_init(&q->cfs, target_latency, min_granularity);
+    requeue_locked(q, policy);
+    queue_unlock(q);
+}
+
+void configure_aging(Queue *q, int age_interval) {
+    queue_lock(q);
+    q->age_interval = age_interval > 0 ? age_interval : 0;
+    queue_unlock(q);
+}
+
+void print_aging(Queue *q) {
+    queue_lock(q);
+    if (q->age_interval > 0) {
+        printf("[Aging] Priority policy: one level per %d ticks queued, %ld steps so far\n", q->age_interval,
+               q->agings);
+    } else {
+        printf("[Aging] Off, %ld steps so far\n", q->agings);
+    }
+    queue_unlock(q);
+}
+
+void queue_release(Queue *q) {
+    free(q->heap);
+    free(q->fenwick);
+    ring_destroy(q->inbox);
+    q->heap = NULL;
+    q->fenwick = NULL;
+    q->inbox = NULL;
+    q->capacity = q->fenwick_capacity = 0;
+}
+
+void configure_o1(Queue *q, int age_interval, int starvation_limit) {
+    queue_lock(q);
+    SchedPolicyType policy = q->policy;
+    requeue_locked(q, POLICY_FCFS);
+    o1_init(&q->o1, age_interval, starvation_limit);
+    q->o1.last_aging = queue_now(q);
+    requeue_locked(q, policy);
+    queue_unlock(q);
+}
+
+void print_o1_stats(Queue *q) {
+    queue_lock(q);
+    if (!q->o1.initialized) o1_init(&q->o1, O1_DEFAULT_AGE_INTERVAL, O1_DEFAULT_STARVATION_LIMIT);
+    o1_print(&q->o1, queue_now(q));
+    queue_unlock(q);
+}
+
+// Earliest tick at which a quota refill makes more work runnable, or
+// LONG_MAX. Anything driving the queue while CPUs idle must look again then.
+long queue_next_refill(Queue *q) {
+    pthread_mutex_lock(&q->lock);
+    long next = q->ordered && q->policy == POLICY_FAIR ? fair_next_refill(&q->fair, queue_now(q)) : LONG_MAX;
+    pthread_mutex_unlock(&q->lock);
+    return next;
+}
+
+void print_fair_share(Queue *q) {
+    queue_lock(q);
+    if (!q->fair.initialized) fair_init(&q->fair, 6, 1);
+    print_fair_stats(&q->fair, queue_now(q));
+    queue_unlock(q);
+}
+
+void print_cfs_stats(Queue *q) {
+    double jain, lag;
+    pthread_mutex_lock(&q->lock);
+    cfs_fairness(&q->cfs, queue_now(q), &jain, &lag);
+    printf("[CFS] Runnable: %d, Total weight: %ld, Min vruntime: %.2f\n",
+           q->cfs.nr_running, q->cfs.total_weight, (double)q->cfs.min_vruntime / CFS_VRUNTIME_SCALE);
+    printf("[CFS] Target latency: %d, Min granularity: %d\n", q->cfs.target_latency, q->cfs.min_granularity);
+    printf("[CFS] Jain fairness index: %.4f, Max vruntime lag: %.2f ticks\n", jain, lag);
+    pthread_mutex_unlock(&q->lock);
+}
+
+// PCBs and children arrays come from object pools, so process churn does
+// not reach malloc. Children arrays double from CHILD_MIN_CAPACITY; sizes
+// past the largest class fall back to malloc.
+#define CHILD_MIN_CAPACITY 4
+#define CHILD_CLASSES 5         // 4, 8, 16, 32 and 64 children
+
+static ObjPool *pcb_pool;
+static pthread_mutex_t family_lock = PTHREAD_MUTEX_INITIALIZER;   // every parent/children link
+static ObjPool *child_pools[CHILD_CLASSES];
+static pthread_once_t pcb_pools_once = PTHREAD_ONCE_INIT;
+
+static void pcb_pools_init() {
+    pcb_pool = pool_create("pcb", sizeof(PCB));
+    for (int c = 0; c < CHILD_CLASSES; c++) {
+        char name[OBJ_POOL_NAME_LEN];
+        snprintf(name, sizeof(name), "children-%d", CHILD_MIN_CAPACITY << c);
+        child_pools[c] = pool_create(name, (CHILD_MIN_CAPACITY << c) * sizeof(PCB *));
+    }
+}
+
+static ObjPool *child_pool_for(int capacity) {
+    int c = __builtin_ctz(capacity / CHILD_MIN_CAPACITY);
+    return c < CHILD_CLASSES ? child_pools[c] : NULL;
+}
+
+static PCB **child_array_alloc(int capacity) {
+    ObjPool *pool = child_pool_for(capacity);
+    return pool ? pool_alloc(pool) : malloc(capacity * sizeof(PCB *));
+}
+
+static void child_array_free(PCB **children, int capacity) {
+    if (!children) return;
+    ObjPool *pool = child_pool_for(capacity);
+    if (pool) pool_free(pool, children);
+    else free(children);
+}
+
+int pcb_add_child(PCB *parent, PCB *child) {
+    pthread_mutex_lock(&family_lock);
+    if (parent->child_count == parent->child_capacity) {
+        int capacity = parent->child_capacity ? 2 * parent->child_capacity : CHILD_MIN_CAPACITY;
+        PCB **grown = child_array_alloc(capacity);
+        if (!grown) {
+            pthread_mutex_unlock(&family_lock);
+            return -1;
+        }
+        if (parent->child_count) memcpy(grown, parent->children, parent->child_count * sizeof(PCB *));
+        child_array_free(parent->children, parent->child_capacity);
+        parent->children = grown;
+        parent->child_capacity = capacity;
+    }
+    child->child_index = parent->child_count;
+    parent->children[parent->child_count++] = child;
+    child->parent = parent;
+    pthread_mutex_unlock(&family_lock);
+    return 0;
+}
+
+// O(1): the last child moves into the hole, so a group leader with many
+// thousands of members does not make every exit scan them
+static void remove_child_locked(PCB *parent, PCB *child) {
+    int i = child->child_index;
+    if (i < 0 || i >= parent->child_count || parent->children[i] != child) return;
+    PCB *moved = parent->children[--parent->child_count];
+    parent->children[i] = moved;
+    moved->child_index = i;
+    child->parent = NULL;
+    child->child_index = -1;
+}
+
+void pcb_remove_child(PCB *parent, PCB *child) {
+    pthread_mutex_lock(&family_lock);
+    remove_child_locked(parent, child);
+    pthread_mutex_unlock(&family_lock);
+}
+
+// Detaches the PCB from its family and recycles it and its children array
+void pcb_free(PCB *p) {
+    if (!p) return;
+    pthread_mutex_lock(&family_lock);
+    if (p->parent) remove_child_locked(p->parent, p);
+    for (int i = 0; i < p->child_count; i++) p->children[i]->parent = NULL;
+    pthread_mutex_unlock(&family_lock);
+    child_array_free(p->children, p->child_capacity);
+    if (p->script_owned) free(p->script);
+    vm_sched_release(p);
+    if (p->bank_client) bank_release_all(p->bank_client->bank, p);
+    free(p->claim);
+    pool_free(pcb_pool, p);
 }
 
 // Process creation
 PCB *sched_create_process(int priority, int time_limit) {
-    PCB *p = malloc(sizeof(PCB));
-    p->pid = next_pid++;
+    return pcb_create(atomic_fetch_add(&next_pid, 1), priority, time_limit);
+}
+
+// With the pid chosen by the caller, so a simulation can number its own
+// jobs without using up the shell's pids
+PCB *pcb_create(int pid, int priority, int time_limit) {
+    pthread_once(&pcb_pools_once, pcb_pools_init);
+    PCB *p = pool_alloc(pcb_pool);
+    p->pid = pid;
     p->state = READY;
     p->priority = priority;
+    p->base_priority = priority;
     p->cpu_time_used = 0;
+    p->cpu_time_ns = 0;
     p->time_limit = time_limit;
     p->io_requested = 0;
+    p->prev = NULL;
+    timer_init(&p->timer, NULL, p);
     p->parent = NULL;
     p->children = NULL;
     p->child_count = 0;
+    p->child_capacity = 0;
+    p->child_index = -1;
+    p->fair_group = -1;
     p->next = NULL;
+    p->heap_index = -1;
+    p->seq = 0;
+    p->age_next = p->age_prev = NULL;
+    p->age_stamp = 0;
+    p->mlfq_level = 0;
+    p->mlfq_epoch = 0;
+    p->o1_array = -1;
+    p->o1_level = 0;
+    p->o1_aging = 0;
+    p->o1_expired = 0;
+    p->affinity = AFFINITY_ALL;
+    p->last_cpu = -1;
+    p->arrival_time = current_tick();
+    p->ready_since = p->arrival_time;
+    p->wait_time = 0;
+    p->vruntime = 0;
+    p->exec_start = 0;
+    p->rb_left = p->rb_right = p->rb_parent = NULL;
+    p->rb_red = 0;
+    p->tickets = 100;
+    p->pass = 0;
+    p->deadline = LONG_MAX;
+    p->rel_deadline = 0;
+    p->period = 0;
+    p->instances = 0;
+    p->rt_task = NULL;
+    p->io_device = 0;
+    p->io_size_kb = 0;
+    p->io_chance = 0;
+    p->mem_pages = 0;
+    p->mem_pattern = MEM_NONE;
+    p->vm_pid = 0;
+    p->vmm = NULL;
+    p->mem_cursor = 0;
+    p->mem_seed = (unsigned int)p->pid * 2654435761u;
+    p->fault_page = -1;
+    p->claim = NULL;
+    p->claim_count = 0;
+    p->bank_client = NULL;
+    p->script = NULL;
+    p->script_owned = 0;
+    p->os_pid = 0;
+    p->os_cpu_ms = 0;
+    metrics_arrive(p);
     return p;
 }
 
-// Scheduler
+// CPU set management
+int cpu_set_init(CpuSet *set, Queue *global, int num_cpus) {
+    if (num_cpus < 1) num_cpus = 1;
+    if (num_cpus > MAX_CPUS) num_cpus = MAX_CPUS;
+    CPU *cpus = calloc(num_cpus, sizeof(CPU));
+    if (!cpus) return -1;
+    for (int i = 0; i < num_cpus; i++) {
+        cpus[i].id = i;
+        cpus[i].set = set;
+        cpus[i].seed = (unsigned int)time(NULL) ^ (i * 2654435761u);
+        deque_init(&cpus[i].local);
+        cpus[i].tm.timer_fd = -1;
+    }
+    set->global = global;
+    set->cpus = cpus;
+    set->num_cpus = num_cpus;
+    return 0;
+}
+
+static int allowed_on(PCB *p, CPU *cpu) {
+    return (p->affinity >> cpu->id) & 1;
+}
+
+// PCBs parked on a local deque are out of sight of the policy: a better
+// arrival would wait behind them and on_tick would never see them preempt.
+// That only does not matter where order is arrival order.
+static int queue_batchable(Queue *q) {
+    return !q->ordered || q->policy == POLICY_FCFS || q->policy == POLICY_RR;
+}
+
+// Pulls a fair share (at most REFILL_BATCH) of the best global PCBs this CPU
+// may run, or only the best one unless the queue is batchable. The best one
+// is returned; the rest go on the local deque so that the owner pops them
+// best-first and thieves take the worst ones.
+static PCB *cpu_refill(CPU *cpu) {
+    Queue *q = cpu->set->global;
+    PCB *batch[REFILL_BATCH], *skipped[2 * REFILL_BATCH];
+    int taken = 0, skipped_count = 0;
+
+    // Lock-free FIFO: no batch to amortize a lock over, just take one
+    PCB *p = queue_pop_fast(q);
+    if (p && allowed_on(p, cpu)) {
+        cpu->refills++;
+        return p;
+    }
+
+    pthread_mutex_lock(&q->lock);
+    // A PCB from the ring this CPU may not run was the oldest, so it goes first
+    if (p) queue_restore_locked(q, p);
+    queue_drain_locked(q);
+    int want = queue_batchable(q) ? q->count / cpu->set->num_cpus + 1 : 1;
+    if (want > REFILL_BATCH) want = REFILL_BATCH;
+    while (taken < want && skipped_count < 2 * REFILL_BATCH) {
+        p = queue_remove_locked(q);
+        if (!p) break;
+        if (allowed_on(p, cpu)) batch[taken++] = p;
+        else skipped[skipped_count++] = p;
+    }
+    for (int i = 0; i < skipped_count; i++) queue_restore_locked(q, skipped[i]);
+    queue_unlock(q);
+
+    if (taken == 0) return NULL;
+    cpu->refills++;
+    for (int i = taken - 1; i >= 1; i--) {
+        if (deque_push(&cpu->local, batch[i]) < 0) enqueue(q, batch[i]);
+    }
+    // Idle peers may steal from the batch
+    if (taken > 1) event_notify(&q->changed);
+    return batch[0];
+}
+
+static CPU *busiest_peer(CPU *cpu) {
+    CPU *best = NULL;
+    long best_size = 0;
+    for (int i = 0; i < cpu->set->num_cpus; i++) {
+        CPU *peer = &cpu->set->cpus[i];
+        long size = deque_size(&peer->local);
+        if (peer != cpu && size > best_size) {
+            best = peer;
+            best_size = size;
+        }
+    }
+    return best;
+}
+
+// Takes one PCB from the busiest peer. A PCB this CPU may not run goes back
+// to the global queue, where a CPU it is allowed on will pick it up.
+static PCB *cpu_steal(CPU *cpu) {
+    CPU *victim = busiest_peer(cpu);
+    if (!victim) return NULL;
+    PCB *p = deque_steal(&victim->local);
+    if (!p) return NULL;
+    if (!allowed_on(p, cpu)) {
+        enqueue(cpu->set->global, p);
+        return NULL;
+    }
+    cpu->steals++;
+    return p;
+}
+
+// Periodic balancing: move half the difference from the busiest peer
+static void cpu_balance(CPU *cpu) {
+    CPU *victim = busiest_peer(cpu);
+    if (!victim) return;
+    long excess = (deque_size(&victim->local) - deque_size(&cpu->local)) / 2;
+    while (excess-- > 0) {
+        PCB *p = cpu_steal(cpu);
+        if (!p) break;
+        if (deque_push(&cpu->local, p) < 0) {
+            enqueue(cpu->set->global, p);
+            break;
+        }
+    }
+}
+
+PCB *cpu_next_pcb(CPU *cpu) {
+    if (++cpu->dispatches % BALANCE_INTERVAL == 0) cpu_balance(cpu);
+    PCB *p;
+    // Batched under an earlier FIFO policy: back into the policy's order
+    if (!queue_batchable(cpu->set->global) && deque_size(&cpu->local) > 0) {
+        while ((p = deque_pop(&cpu->local))) enqueue(cpu->set->global, p);
+    }
+    p = deque_pop(&cpu->local);
+    if (!p) p = cpu_refill(cpu);
+    if (!p) p = cpu_steal(cpu);
+    if (p) {
+        dispatched(p);
+        p->last_cpu = cpu->id;
+        if (cpu->set->global->observer) event_notify(cpu->set->global->observer);
+    } else {
+        cpu->dispatches--;
+    }
+    return p;
+}
+
+int ready_count() {
+    int count = queue_size(cpu_set.global);
+    for (int i = 0; i < cpu_set.num_cpus; i++) count += deque_size(&cpu_set.cpus[i].local);
+    return count;
+}
+
+// Called by the I/O device when a PCB's request completes
+void wake_from_io(PCB *p) {
+    if (!queue_remove(&wait_queue, p)) return;
+    printf("[IO] Completing I/O for PID %d\n", p->pid);
+    metrics_transition(p, READY);
+    trace_record(TRACE_WAKE, -1, p);
+    p->io_requested = 0;
+    queue_on_wake(&ready_queue, p);
+    enqueue(&ready_queue, p);
+}
+
+// Page fault timer callback: the page is read in, so map it and wake the PCB
+static void page_arrived(Timer *timer, void *arg) {
+    PCB *p = arg;
+    if (!queue_remove(&wait_queue, p)) return;
+    vm_sched_fault_done(p);
+    metrics_transition(p, READY);
+    trace_record(TRACE_WAKE, -1, p);
+    queue_on_wake(&ready_queue, p);
+    enqueue(&ready_queue, p);
+}
+
+// Banker callbacks, run with the bank locked so a wakeup cannot overtake
+// the block it ends
+static void bank_block(PCB *p, void *ctx) {
+    metrics_transition(p, WAITING);
+    trace_record(TRACE_BLOCK, p->last_cpu, p);
+    queue_on_block(&ready_queue, p);
+    enqueue(&wait_queue, p);
+}
+
+static void bank_wake(PCB *p, void *ctx) {
+    if (!queue_remove(&wait_queue, p)) return;
+    metrics_transition(p, READY);
+    trace_record(TRACE_WAKE, -1, p);
+    queue_on_wake(&ready_queue, p);
+    enqueue(&ready_queue, p);
+}
+
+// Arrival timer callback, run on the timer wheel's thread
+static void pcb_arrive(Timer *timer, void *arg) {
+    PCB *p = arg;
+    if (queue_admit(&ready_queue, p) < 0) {
+        printf("[Batch] Rejected PID %d on arrival: would overload the CPUs\n", p->pid);
+        pcb_free(p);
+        return;
+    }
+    metrics_arrive(p);
+    trace_record(TRACE_ARRIVE, -1, p);
+    enqueue(&ready_queue, p);
+}
+
+// Bulk arrival for the job loader. Admission only has something to check
+// for PCBs with a deadline, so those still arrive one at a time.
+void arrive_batch(PCB **pcbs, int n) {
+    int kept = 0;
+    for (int i = 0; i < n; i++) {
+        PCB *p = pcbs[i];
+        if (p->rel_deadline > 0) {
+            pcb_arrive(&p->timer, p);
+            continue;
+        }
+        metrics_arrive(p);
+        trace_record(TRACE_ARRIVE, -1, p);
+        pcbs[kept++] = p;
+    }
+    enqueue_batch(&ready_queue, pcbs, kept);
+}
+
+// Enqueues now or arms the PCB's timer for its arrival tick
+void schedule_arrival(PCB *p) {
+    long delay = (p->arrival_time - current_tick()) * SCHED_TICK_MS;
+    timer_init(&p->timer, pcb_arrive, p);
+    if (delay > 0) timer_arm(&timer_wheel, &p->timer, delay);
+    else pcb_arrive(&p->timer, p);
+}
+
+// A burst pattern blocks at its script points, anything else at random
+static int wants_io(PCB *p, unsigned int *seed) {
+    TraceScript *script = p->script;
+    if (script) {
+        if (script->next >= script->count || p->cpu_time_used != script->at_used[script->next]) return 0;
+        script->next++;
+        return 1;
+    }
+    if (p->io_chance < 0) return 0;
+    return rand_r(seed) % (p->io_chance ? p->io_chance : IO_DEFAULT_CHANCE) == 0;
+}
+
+// Scheduler: one dispatcher per simulated CPU
 void *scheduler_loop(void *arg) {
+    CPU *cpu = arg;
+    Queue *q = cpu->set->global;
+    int idle_printed = 0;
+    timer_manager_init(&cpu->tm);
+
     while (1) {
-        PCB *p = dequeue(&ready_queue);
-        static int idle_printed = 0;
+        // Taken before looking, so an enqueue racing with the look still wakes us
+        unsigned long gen = event_prepare(&q->changed);
+        PCB *p = cpu_next_pcb(cpu);
         if (!p) {
             // Only print idle once unless something changes
             if (!idle_printed) {
-                fprintf(stderr, "[Scheduler] No ready processes. Idling...\nmy_shell v\n");
+                fprintf(stderr, "[CPU %d] No ready processes. Idling...\nmy_shell v\n", cpu->id);
                 idle_printed = 1;
             }
-            sleep(1);
+            event_wait(&q->changed, gen, NULL);
             continue;
         }
         idle_printed = 0;
 
-        // Reset idle flag
-        fprintf(stderr, "[Scheduler] Scheduling PID %d\n", p->pid);
-        setup_timer_interrupt(5);
-        p->state = RUNNING;
+        fprintf(stderr, "[CPU %d] Scheduling PID %d\n", cpu->id, p->pid);
+        setup_timer_interrupt(&cpu->tm, queue_quantum(q, p));
+        metrics_transition(p, RUNNING);
+        trace_record(TRACE_DISPATCH, cpu->id, p);
+        if (p->os_pid) real_sched_resume(p, cpu->id);
 
-        for (int i = 0; i < p->time_limit; i++) {
-            if (p->state != RUNNING) break;
+        // Runs up to the next whole tick of work at a time; tick-based
+        // policy hooks and I/O only look at the PCB on those boundaries
+        while (p->state == RUNNING) {
+            int used = p->cpu_time_used, exited = 0;
+            long long tick_left = SCHED_TICK_NS - p->cpu_time_ns % SCHED_TICK_NS;
+            if (p->os_pid) {
+                exited = !real_sched_run(p, &cpu->tm, tick_left);
+            } else {
+                p->cpu_time_ns += timer_run(&cpu->tm, tick_left);
+                p->cpu_time_used = p->cpu_time_ns / SCHED_TICK_NS;
+            }
+            int ticked = p->cpu_time_used != used;
+            if (ticked) fprintf(stderr, "[CPU %d] PID %d running... (used: %d)\n", cpu->id, p->pid, p->cpu_time_used);
 
-            fprintf(stderr, "[CPU] PID %d running... (used: %d)\n", p->pid, p->cpu_time_used);
-            sleep(1);
-            p->cpu_time_used++;
+            if (exited || p->cpu_time_used >= p->time_limit) {
+                fprintf(stderr, "[CPU %d] PID %d completed execution.\n", cpu->id, p->pid);
+                metrics_transition(p, TERMINATED);
+                metrics_complete(p);
+                trace_record(TRACE_EXIT, cpu->id, p);
+                if (p->bank_client) bank_release_all(&bank, p);
+                if (queue_on_exit(q, p)) {
+                    fprintf(stderr, "[CPU %d] PID %d next instance at tick %ld\n", cpu->id, p->pid, p->arrival_time);
+                    schedule_arrival(p);
+                } else {
+                    pcb_free(p);
+                }
+                goto next;
+            }
 
-            if (rand() % 5 == 0 && !p->io_requested) {
-                fprintf(stderr, "[CPU] PID %d requesting I/O\n", p->pid);
-                p->state = WAITING;
-                p->io_requested = 1;
+            if (ticked && vm_sched_run_tick(&vmm, p)) {
+                fprintf(stderr, "[CPU %d] PID %d page fault on page %d, blocking\n", cpu->id, p->pid, p->fault_page);
+                metrics_transition(p, WAITING);
+                trace_record(TRACE_BLOCK, cpu->id, p);
+                queue_on_block(q, p);
                 enqueue(&wait_queue, p);
+                timer_init(&p->timer, page_arrived, p);
+                timer_arm(&timer_wheel, &p->timer, paging_disk_reserve(&vmm, &paging_disk, current_tick()) * SCHED_TICK_MS);
                 goto next;
             }
 
-            if (should_preempt()) {
-                fprintf(stderr, "[Preempt] PID %d quantum expired, moving back to ready queue\n", p->pid);
-                p->state = READY;
-                enqueue(&ready_queue, p);
+            // Once blocked the PCB is the bank's: it may already be running elsewhere
+            if (ticked && bank_wants(p) && bank_step(&bank, p) == BANK_BLOCKED) {
+                fprintf(stderr, "[CPU %d] PID %d waits for resources\n", cpu->id, p->pid);
                 goto next;
             }
 
-            if (p->cpu_time_used >= p->time_limit) {
-                fprintf(stderr, "[CPU] PID %d completed execution.\n", p->pid);
-                p->state = TERMINATED;
-                free(p);
+            if (ticked && !p->io_requested && wants_io(p, &cpu->seed)) {
+                fprintf(stderr, "[CPU %d] PID %d requesting I/O\n", cpu->id, p->pid);
+                metrics_transition(p, WAITING);
+                trace_record(TRACE_BLOCK, cpu->id, p);
+                p->io_requested = 1;
+                queue_on_block(q, p);
+                enqueue(&wait_queue, p);
+                io_submit(p, rand_r(&cpu->seed));
                 goto next;
             }
-        }
 
-        next:
-            continue;
-    }
-    return NULL;
-}
-
-
-// I/O simulation
-void *io_simulator(void *arg) {
-    while (1) {
-        sleep(3);
-        pthread_mutex_lock(&wait_queue.lock);
-        PCB *prev = NULL, *curr = wait_queue.head;
-
-        while (curr) {
-            PCB *next = curr->next;
-            if (curr->io_requested) {
-                printf("[IO] Completing I/O for PID %d\n", curr->pid);
-                curr->state = READY;
-                curr->io_requested = 0;
-
-                if (prev) prev->next = curr->next;
-                else wait_queue.head = curr->next;
-                if (wait_queue.tail == curr) wait_queue.tail = prev;
-
-                curr->next = NULL;
-                enqueue(&ready_queue, curr);
-            } else {
-                prev = curr;
+            if (should_preempt(&cpu->tm) || (ticked && queue_on_tick(q, p))) {
+                fprintf(stderr, "[Preempt] PID %d quantum expired on CPU %d, moving back to ready queue\n",
+                        p->pid, cpu->id);
+                metrics_transition(p, READY);
+                trace_record(TRACE_PREEMPT, cpu->id, p);
+                queue_on_preempt(q, p);
+                if (p->os_pid) real_sched_preempt(p);
+                enqueue(q, p);
+                goto next;
             }
-            curr = next;
         }
-        pthread_mutex_unlock(&wait_queue.lock);
+
+        next:
+            cancel_timer_interrupt(&cpu->tm);
     }
     return NULL;
 }
 
-// Performance monitoring
+// Performance monitoring: wakes on queue changes and dispatches only, and
+// prints at most every MONITOR_MIN_INTERVAL_MS so bursts are coalesced
 void *performance_monitor(void *arg) {
     int last_ready = -1, last_waiting = -1;
 
     while (1) {
-        sleep(1); // Lower frequency or change to event-driven if needed
-        int ready = 0, waiting = 0;
+        unsigned long gen = event_prepare(&sched_state);
+        int ready = ready_count();
 
-        pthread_mutex_lock(&ready_queue.lock);
-        for (PCB *p = ready_queue.head; p; p = p->next) ready++;
-        pthread_mutex_unlock(&ready_queue.lock);
-
-        pthread_mutex_lock(&wait_queue.lock);
-        for (PCB *p = wait_queue.head; p; p = p->next) waiting++;
-        pthread_mutex_unlock(&wait_queue.lock);
+        int waiting = queue_size(&wait_queue);
 
         if (ready != last_ready || waiting != last_waiting) {
-            printf("[Monitor] Ready: %d, Waiting: %d\n", ready, waiting);
+            printf("[Monitor] Ready: %d, Waiting: %d, Completed: %ld\n", ready, waiting,
+                   atomic_load(&sched_metrics.completed));
             if (!ready && !waiting) { printf("my_shell v\n"); fflush(stdout); }
             last_ready = ready;
             last_waiting = waiting;
+            usleep(MONITOR_MIN_INTERVAL_MS * 1000);
         }
+        event_wait(&sched_state, gen, NULL);
     }
     return NULL;
 }
 
-// Timer thread
+// Timer thread: serves the wheel, with the scheduler tick as a periodic
+// timer re-armed from its own expiry so it does not drift
+static Timer tick_timer;
+
+static void scheduler_tick(Timer *timer, void *arg) {
+    handle_timer_interrupt();
+    // Idle CPUs sleep until an enqueue, so a quota refill has to wake them
+    if (atomic_load(&ready_queue.fair.waiting_refill)) event_notify(&ready_queue.changed);
+    timer_arm_at(&timer_wheel, timer, timer->expires + SCHED_TICK_MS);
+}
+
 void *timer_thread_fn(void *arg) {
-    while (1) {
-        sleep(1);
-        handle_timer_interrupt();
+    timer_init(&tick_timer, scheduler_tick, NULL);
+    timer_arm(&timer_wheel, &tick_timer, SCHED_TICK_MS);
+    return timer_service(&timer_wheel);
+}
+
+// "POLICY <name> [slice]" header line of a batch file
+int apply_batch_policy(Queue *q, char *rest) {
+    char name[32];
+    int slice = 0;
+    if (sscanf(rest, "%31s %d", name, &slice) < 1) return -1;
+    int policy = sched_policy_lookup(name);
+    if (policy < 0) {
+        fprintf(stderr, "[Batch] Unknown policy '%s'\n", name);
+        return -1;
     }
-    return NULL;
+    if (slice > 0) set_policy_slice(q, slice);
+    set_sched_policy(q, policy);
+    printf("[Batch] Scheduling policy: %s\n", name);
+    return 0;
 }
 
-// Batch file loader
-void load_batch_file(const char *filename) {
-    FILE *file = fopen(filename, "r");
-    if (!file) {
-        perror("Batch file error");
-        exit(EXIT_FAILURE);
+// Process display
+static void print_pcb(PCB *curr, bool detailed) {
+    if (detailed)
+        printf("%3d %6s %8d %4d %5d %2d %3d\n",
+               curr->pid, state_str[curr->state], curr->priority,
+               curr->cpu_time_used, curr->time_limit, curr->io_requested, curr->child_count);
+    else
+        printf("%3d %6s %8d\n", curr->pid, state_str[curr->state], curr->priority);
+}
+
+static void print_pcb_brief(PCB *p, void *ctx) {
+    (void)ctx;
+    print_pcb(p, false);
+}
+
+static void print_pcb_detailed(PCB *p, void *ctx) {
+    (void)ctx;
+    print_pcb(p, true);
+}
+
+void display_procs(bool detailed) {
+    queue_lock(&ready_queue);
+    printf("[procs] Ready Queue:\n");
+    printf(detailed ? "PID STATE PRIORITY USED LIMIT IO CHILDREN\n" : "PID STATE PRIORITY\n");
+    if (ready_queue.policy == POLICY_MLFQ) {
+        for (int level = 0; level < ready_queue.mlfq.levels; level++) {
+            if (ready_queue.mlfq.head[level]) printf("-- level %d --\n", level);
+            for (PCB *curr = ready_queue.mlfq.head[level]; curr; curr = curr->next) print_pcb(curr, detailed);
+        }
+    } else {
+        queue_ops(&ready_queue)->for_each(&ready_queue, detailed ? print_pcb_detailed : print_pcb_brief, NULL);
+    }
+    queue_unlock(&ready_queue);
+
+    for (int i = 0; i < cpu_set.num_cpus; i++) {
+        CPU *cpu = &cpu_set.cpus[i];
+        printf("[procs] CPU %d: %ld local, %ld dispatches, %ld refills, %ld steals\n",
+               cpu->id, deque_size(&cpu->local), cpu->dispatches, cpu->refills, cpu->steals);
     }
 
-    char line[128];
-    while (fgets(line, sizeof(line), file)) {
-        if (line[0] == '#' || strlen(line) < 2) continue;
+    queue_lock(&wait_queue);
+    printf("[procs] Wait Queue:\n");
+    for (PCB *curr = wait_queue.head; curr; curr = curr->next) print_pcb(curr, detailed);
+    queue_unlock(&wait_queue);
+}
 
-        if (strncmp(line, "SLEEP", 5) == 0) {
-            int seconds = atoi(&line[6]);
-            printf("[Batch] Sleeping for %d seconds before next process\n", seconds);
-            sleep(seconds);
+// Dispatch throughput benchmark: zero-work PCBs on a private queue, so the
+// numbers reflect queue, refill and stealing overhead only
+#define BENCH_SLICES 4
+static atomic_long bench_remaining;
+
+static void *bench_dispatcher(void *arg) {
+    CPU *cpu = arg;
+    while (atomic_load(&bench_remaining) > 0) {
+        PCB *p = cpu_next_pcb(cpu);
+        if (!p) {
+            sched_yield();
             continue;
         }
+        if (++p->cpu_time_used >= p->time_limit) {
+            pcb_free(p);
+            atomic_fetch_sub(&bench_remaining, 1);
+        } else {
+            enqueue(cpu->set->global, p);
+        }
+    }
+    return NULL;
+}
 
-        int priority, time_limit;
-        if (sscanf(line, "%d %d", &priority, &time_limit) == 2) {
-            PCB *p = sched_create_process(priority, time_limit);
-            enqueue(&ready_queue, p);
-            printf("[Batch] Loaded PID %d with priority %d and time limit %d\n",
-                   p->pid, priority, time_limit);
+void run_dispatch_benchmark(int max_cpus, int jobs) {
+    if (max_cpus > MAX_CPUS) max_cpus = MAX_CPUS;
+    printf("CPUS  DISPATCHES  SECONDS   DISPATCH/S    STEALS\n");
+    for (int n = 1; n <= max_cpus; n = (n < max_cpus && n * 2 > max_cpus) ? max_cpus : n * 2) {
+        // Round robin, so refills batch and idle CPUs have something to steal
+        Queue q = { .ordered = 1, .policy = POLICY_RR };
+        pthread_mutex_init(&q.lock, NULL);
+        event_init(&q.changed);
+        CpuSet set;
+        if (cpu_set_init(&set, &q, n) < 0) {
+            perror("benchmark");
+            return;
         }
+        // Numbered privately so a benchmark does not use up shell pids
+        for (int i = 0; i < jobs; i++) enqueue(&q, pcb_create(i + 1, i % 4, BENCH_SLICES));
+        atomic_store(&bench_remaining, jobs);
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < n; i++) pthread_create(&set.cpus[i].thread, NULL, bench_dispatcher, &set.cpus[i]);
+        for (int i = 0; i < n; i++) pthread_join(set.cpus[i].thread, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        long dispatches = 0, steals = 0;
+        for (int i = 0; i < n; i++) {
+            dispatches += set.cpus[i].dispatches;
+            steals += set.cpus[i].steals;
+        }
+        double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        printf("%4d %11ld %8.3f %12.0f %9ld\n", n, dispatches, seconds, dispatches / seconds, steals);
+
+        free(set.cpus);
+        queue_release(&q);
+        pthread_mutex_destroy(&q.lock);
+        if (n == max_cpus) break;
     }
+}
 
-    fclose(file);
+// Queue contention benchmark: every thread loops dequeue + enqueue on one
+// shared FCFS queue, with the mutex and then with the lock-free ring
+#define QBENCH_PCBS 256
+static atomic_long qbench_remaining;
+
+static void *qbench_worker(void *arg) {
+    Queue *q = arg;
+    while (atomic_fetch_sub_explicit(&qbench_remaining, 1, memory_order_relaxed) > 0) {
+        PCB *p = dequeue(q);
+        if (p) enqueue(q, p);
+    }
+    return NULL;
 }
 
-// Process display
-void display_procs(bool detailed) {
-    pthread_mutex_lock(&ready_queue.lock);
-    PCB *curr = ready_queue.head;
-    printf("[procs] Ready Queue:\n");
-    printf(detailed ? "PID STATE PRIORITY USED LIMIT IO CHILDREN\n" : "PID STATE PRIORITY\n");
-    while (curr) {
-        if (detailed)
-            printf("%3d %6s %8d %4d %5d %2d %3d\n",
-                   curr->pid, state_str[curr->state], curr->priority,
-                   curr->cpu_time_used, curr->time_limit, curr->io_requested, curr->child_count);
-        else
-            printf("%3d %6s %8d\n", curr->pid, state_str[curr->state], curr->priority);
-        curr = curr->next;
-    }
-    pthread_mutex_unlock(&ready_queue.lock);
-
-    pthread_mutex_lock(&wait_queue.lock);
-    curr = wait_queue.head;
-    printf("[procs] Wait Queue:\n");
-    while (curr) {
-        if (detailed)
-            printf("%3d %6s %8d %4d %5d %2d %3d\n",
-                   curr->pid, state_str[curr->state], curr->priority,
-                   curr->cpu_time_used, curr->time_limit, curr->io_requested, curr->child_count);
-        else
-            printf("%3d %6s %8d\n", curr->pid, state_str[curr->state], curr->priority);
-        curr = curr->next;
+static double qbench_run(int threads, long ops, int lockfree) {
+    Queue q = { .ordered = 1, .policy = POLICY_FCFS };
+    pthread_mutex_init(&q.lock, NULL);
+    event_init(&q.changed);
+    if (lockfree && queue_enable_lockfree(&q) < 0) {
+        perror("qbench");
+        return 0;
+    }
+    for (int i = 0; i < QBENCH_PCBS; i++) enqueue(&q, pcb_create(i + 1, 0, 1));
+    atomic_store(&qbench_remaining, ops);
+
+    pthread_t tids[MAX_CPUS];
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < threads; i++) pthread_create(&tids[i], NULL, qbench_worker, &q);
+    for (int i = 0; i < threads; i++) pthread_join(tids[i], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    PCB *p;
+    while ((p = dequeue(&q))) pcb_free(p);
+    queue_release(&q);
+    pthread_mutex_destroy(&q.lock);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    return ops / seconds;
+}
+
+void run_queue_benchmark(int max_threads, int ops) {
+    if (max_threads > MAX_CPUS) max_threads = MAX_CPUS;
+    printf("THREADS  MUTEX OPS/S  LOCKFREE OPS/S  SPEEDUP\n");
+    for (int n = 1; n <= max_threads; n = (n < max_threads && n * 2 > max_threads) ? max_threads : n * 2) {
+        double locked = qbench_run(n, ops, 0);
+        double lockfree = qbench_run(n, ops, 1);
+        printf("%7d %12.0f %15.0f %8.2f\n", n, locked, lockfree, locked > 0 ? lockfree / locked : 0.0);
+        if (n == max_threads) break;
     }
-    pthread_mutex_unlock(&wait_queue.lock);
 }
 
 // Thread launcher
-void start_scheduler_threads() {
-    pthread_t io_thread;
+void start_scheduler_threads(int num_cpus) {
     pthread_t timer_thread;
-    pthread_t scheduler_thread;
     pthread_t monitor_thread;
 
-    pthread_create(&io_thread, NULL, io_simulator, NULL);
+    timer_wheel_init(&timer_wheel);
+    metrics_reset();
+    io_init();
+    if (cpu_set_init(&cpu_set, &ready_queue, num_cpus) < 0) {
+        perror("Scheduler start error");
+        exit(EXIT_FAILURE);
+    }
+    ready_queue.edf.capacity = cpu_set.num_cpus;
+    bank.on_block = bank_block;
+    bank.on_wake = bank_wake;
+
     pthread_create(&timer_thread, NULL, timer_thread_fn, NULL);
-    pthread_create(&scheduler_thread, NULL, scheduler_loop, NULL);
+    for (int i = 0; i < cpu_set.num_cpus; i++) {
+        pthread_create(&cpu_set.cpus[i].thread, NULL, scheduler_loop, &cpu_set.cpus[i]);
+    }
     pthread_create(&monitor_thread, NULL, performance_monitor, NULL);
 }
-
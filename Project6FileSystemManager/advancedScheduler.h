@@ -2,24 +2,112 @@
 #define ADVANCEDSCHEDULER_H
 
 #include <stdbool.h>
+#include "mlfq.h"
+#include "cfs.h"
+#include "schedPolicy.h"
+#include "edf.h"
+#include "timerWheel.h"
+#include "workDeque.h"
+#include "ioDevices.h"
+#include "mpmcRing.h"
+#include "objPool.h"
+#include "fairShare.h"
+#include "o1Sched.h"
+
+#define MAX_CPUS 64
+#define DEFAULT_NUM_CPUS 2
+#define AFFINITY_ALL (~0UL)
+#define SCHED_TICK_MS 1000          // one unit of time_limit
+#define SCHED_TICK_NS ((long long)SCHED_TICK_MS * 1000000)
+#define MONITOR_MIN_INTERVAL_MS 100
 
 extern const char *state_str[];
 typedef enum { NEW, READY, RUNNING, WAITING, TERMINATED } ProcessState;
 
+// Blocking wakeups without lost signals: a waiter reads the generation,
+// rechecks its condition, then sleeps until the generation moves. Notifying
+// is one atomic increment unless somebody is actually asleep.
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    atomic_ulong generation;
+    atomic_int waiters;
+} EventCount;
+
+#define EVENT_COUNT_INITIALIZER { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0 }
+
+// Memory access pattern a job line asks for with mem=<pages>:<pattern>
+typedef enum { MEM_NONE, MEM_SEQUENTIAL, MEM_RANDOM, MEM_LOCALITY } MemPattern;
+
 typedef struct PCB {
     int pid;
     ProcessState state;
     int priority;
-    int cpu_time_used;
+    int base_priority;          // priority goes back to this when aging ends
+    int cpu_time_used;          // whole ticks of cpu_time_ns
+    long long cpu_time_ns;
     int time_limit;
     int io_requested;
+    Timer timer;                // pending arrival
+    int io_device;              // index into io_devices
+    int io_size_kb;             // per request, 0 for IO_DEFAULT_SIZE_KB
+    int io_chance;              // 1 in n ticks blocks for I/O, 0 default, -1 never
+    int mem_pages;              // working set from the job file
+    MemPattern mem_pattern;
+    int vm_pid;                 // VMM address space, 0 until first used, see vmSched.h
+    struct Vmm *vmm;            // the VMM vm_pid lives in
+    int mem_cursor;             // next page under MEM_SEQUENTIAL
+    unsigned int mem_seed;
+    int fault_page;             // page being read in while WAITING, -1 if none
+    int *claim;                 // banker's max claim per resource type, owned
+    int claim_count;
+    struct BankClient *bank_client; // registered claims and holdings, see banker.h
 
     struct PCB *parent;
-    struct PCB **children;
+    struct PCB **children;      // from the child array pools, see pcb_add_child
     int child_count;
+    int child_capacity;
+    int child_index;            // slot in parent->children
+    int fair_group;             // share group this PCB leads, -1 if none
 
     pthread_t thread;
     struct PCB *next;
+    struct PCB *prev;           // FIFO queues and MLFQ levels only
+    int heap_index;         // position in an ordered queue's heap, -1 if not queued
+    unsigned long seq;      // enqueue order, breaks priority ties FIFO
+    struct PCB *age_next, *age_prev;    // priority policy's aging list
+    long age_stamp;             // when last queued or aged
+    int mlfq_level;
+    unsigned long mlfq_epoch;
+    int o1_array;               // O(1) array holding it, -1 if none, see o1Sched.h
+    int o1_level;               // level when pushed
+    unsigned long o1_aging;     // aging steps at push
+    int o1_expired;             // used its slice, goes to the expired array
+    unsigned long affinity;     // bit n set if the PCB may run on CPU n
+    int last_cpu;
+    long arrival_time;          // in ticks of whichever clock runs the PCB
+    long vruntime;              // CFS virtual runtime, see cfs.h
+    int exec_start;             // cpu_time_used when last picked
+    int tickets;                // lottery and stride share
+    long pass;                  // stride position
+    struct PCB *rb_left, *rb_right, *rb_parent;
+    int rb_red;
+    long deadline;              // absolute, LONG_MAX if not real-time
+    int rel_deadline;
+    int period;
+    int instances;              // releases of a periodic task
+    struct EdfTask *rt_task;
+    long ready_since;
+    long wait_time;
+    long t_arrival;             // metrics timestamps in timer wheel ms, see metrics.h
+    long t_first_run;           // -1 until first dispatched
+    long t_last_change;
+    long state_ms[5];           // time in each ProcessState this instance
+    int transitions;
+    struct TraceScript *script; // I/O points from a trace replay or a burst pattern, else NULL
+    int script_owned;           // script is freed with the PCB
+    int os_pid;                 // host child under realsched, 0 if simulated
+    long os_cpu_ms;             // its utime + stime, see realSched.h
 
     char **args;
     char *input_file;
@@ -27,46 +115,205 @@ typedef struct PCB {
     int background;
 } PCB;
 
-typedef struct {
+// Unordered queues (wait_queue) are a FIFO list. Ordered queues (ready_queue)
+// hand every operation to sched_policies[policy], which keeps its PCBs in the
+// structure it needs: the FIFO list, the heap array (also the lottery slots),
+// the MLFQ level lists or the CFS vruntime tree.
+//
+// In lock-free mode enqueue() pushes onto an MPMC ring without the lock, and
+// whoever next takes the lock to look at the queue drains the ring into the
+// policy structure. FIFO queues also dequeue straight from the ring while
+// the locked list is empty, so neither side touches the mutex.
+typedef struct Queue {
     PCB *head;
     PCB *tail;
     pthread_mutex_t lock;
+    int ordered;
+    SchedPolicyType policy;
+    PCB **heap;
+    int count;
+    int capacity;
+    unsigned long next_seq;
+    MLFQ mlfq;
+    CFS cfs;
+    FairShare fair;
+    O1Sched o1;
+    long *fenwick;              // lottery ticket sums over heap slots
+    int fenwick_capacity;
+    long total_tickets;
+    long global_pass;           // stride
+    int slice;                  // quantum for rr, lottery and stride
+    int age_interval;           // priority policy: ticks queued per priority level gained, 0 = off
+    PCB *age_head, *age_tail;
+    long agings;
+    unsigned int seed;
+    EdfState edf;
+    EventCount changed;         // notified on every enqueue
+    EventCount *observer;       // also notified, for the monitor
+    long (*clock)(void);        // time source for the policy, NULL = timer ticks
+    MpmcRing *inbox;            // lock-free arrivals, NULL unless enabled
+    atomic_int backlog;         // count as of the last unlock, read without the lock
 } Queue;
 
+// Quantum accounting on a one-shot CLOCK_MONOTONIC timerfd. The dispatcher
+// waits on the fd while its PCB runs, so expiry cuts the wait short, and a
+// preemption check is a single atomic load.
 typedef struct {
-    int current_quantum;
-    int time_used;
-    pthread_mutex_t lock;
+    int timer_fd;           // -1 falls back to sleeping until the deadline
+    long long quantum_ns;
+    long long deadline_ns;  // CLOCK_MONOTONIC at which the quantum runs out
+    atomic_int expired;
+    atomic_long ticks;      // total timer interrupts since start, global tm only
+    long expiries;
+    long long max_late_ns;  // worst delay between a deadline and the dispatcher seeing it
 } TimeManager;
 
+// One simulated CPU. External producers (shell, loader, I/O thread) feed the
+// shared policy-ordered queue; each CPU pulls small batches into its own
+// deque, runs from there, and steals from the busiest peer when it runs dry.
+typedef struct CPU {
+    int id;
+    pthread_t thread;
+    WorkDeque local;
+    TimeManager tm;             // this CPU's quantum accounting
+    struct CpuSet *set;
+    unsigned int seed;
+    long dispatches;
+    long refills;
+    long steals;
+} CPU;
+
+typedef struct CpuSet {
+    Queue *global;
+    CPU *cpus;
+    int num_cpus;
+} CpuSet;
+
 extern Queue ready_queue;
 extern Queue wait_queue;
 extern TimeManager tm;
+extern atomic_int sched_slice_ms;
+extern CpuSet cpu_set;
+extern EventCount sched_state;
+
+void event_init(EventCount *);
+
+unsigned long event_prepare(EventCount *);
+
+void event_wait(EventCount *, unsigned long, const struct timespec *);
+
+void event_notify(EventCount *);
 
-void setup_timer_interrupt(int);
+void timer_manager_init(TimeManager *);
+
+void setup_timer_interrupt(TimeManager *, int);
+
+void cancel_timer_interrupt(TimeManager *);
+
+long long timer_run(TimeManager *, long long);
 
 void handle_timer_interrupt();
 
-bool should_preempt();
+bool should_preempt(TimeManager *);
+
+long long quantum_unit_ns();
+
+void set_slice_ms(int);
+
+void print_quantum_stats();
+
+int queue_enable_lockfree(Queue *);
+
+int queue_size(Queue *);
 
 void enqueue(Queue *, PCB *);
 
+int queue_remove(Queue *, PCB *);
+
 PCB* dequeue(Queue *);
 
+PCB *dequeue_allowed(Queue *, int);
+
+int queue_quantum(Queue *, PCB *);
+
+void queue_on_preempt(Queue *, PCB *);
+
+void queue_on_block(Queue *, PCB *);
+
+void queue_on_wake(Queue *, PCB *);
+
+void wake_from_io(PCB *);
+
+int queue_on_tick(Queue *, PCB *);
+
+int queue_preempts_on_arrival(Queue *);
+
+int queue_admit(Queue *, PCB *);
+
+int queue_on_exit(Queue *, PCB *);
+
+void queue_release(Queue *);
+
+void configure_aging(Queue *, int);
+
+void print_aging(Queue *);
+
+void set_sched_policy(Queue *, SchedPolicyType);
+
+void set_policy_slice(Queue *, int);
+
+void configure_mlfq(Queue *, int, const int *, int);
+
+void configure_cfs(Queue *, int, int);
+
+void print_cfs_stats(Queue *);
+
+void configure_o1(Queue *, int, int);
+
+void print_o1_stats(Queue *);
+
+long current_tick();
+
+long queue_next_refill(Queue *);
+
+void print_fair_share(Queue *);
+
 PCB *sched_create_process(int, int);
 
-void *scheduler_loop(void *);
+PCB *pcb_create(int pid, int priority, int time_limit);
+
+void pcb_free(PCB *);
 
-void *io_simulator(void *arg);
+int pcb_add_child(PCB *, PCB *);
+
+void pcb_remove_child(PCB *, PCB *);
+
+void *scheduler_loop(void *);
 
 void *performance_monitor(void *);
 
 void *timer_thread_fn(void *);
 
-void load_batch_file(const char *);
+int apply_batch_policy(Queue *, char *);
+
+void enqueue_batch(Queue *, PCB **, int);
+
+void schedule_arrival(PCB *);
+
+void arrive_batch(PCB **, int);
 
 void display_procs(bool);
 
-void start_scheduler_threads();
+int cpu_set_init(CpuSet *, Queue *, int);
+
+PCB *cpu_next_pcb(CPU *);
+
+int ready_count();
+
+void run_dispatch_benchmark(int, int);
+
+void run_queue_benchmark(int, int);
+
+void start_scheduler_threads(int);
 
 #endif
@@ -0,0 +1,738 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
+#include "advancedScheduler.h"
+#include "banker.h"
+
+Bank bank = { .lock = PTHREAD_MUTEX_INITIALIZER, .avoid = 1 };
+
+void bank_init(Bank *b, const int *total, int m) {
+    memset(b, 0, sizeof(Bank));
+    pthread_mutex_init(&b->lock, NULL);
+    b->avoid = 1;
+    bank_set_totals(b, total, m);
+}
+
+void bank_destroy(Bank *b) {
+    for (int j = 0; j < BANK_MAX_RESOURCES; j++) free(b->order[j]);
+    free(b->stack);
+    free(b->finished);
+    free(b->seq);
+    free(b->slack);
+    free(b->slack_add);
+    pthread_mutex_destroy(&b->lock);
+}
+
+// Avoidance needs a safe state to start from, so it only changes while
+// nobody holds or claims anything
+int bank_set_avoid(Bank *b, int avoid) {
+    pthread_mutex_lock(&b->lock);
+    int ok = b->clients == 0;
+    if (ok) b->avoid = avoid;
+    pthread_mutex_unlock(&b->lock);
+    return ok ? 0 : -1;
+}
+
+int bank_set_totals(Bank *b, const int *total, int m) {
+    if (m < 0 || m > BANK_MAX_RESOURCES) return -1;
+    pthread_mutex_lock(&b->lock);
+    if (b->clients) {
+        pthread_mutex_unlock(&b->lock);
+        return -1;
+    }
+    b->m = m;
+    for (int j = 0; j < m; j++) b->total[j] = b->available[j] = total[j] > 0 ? total[j] : 0;
+    // The slack trees are m trees of 2*seq_cap, so drop them and let the
+    // next seq_append() build them for the new m
+    free(b->seq);
+    free(b->slack);
+    free(b->slack_add);
+    b->seq = NULL;
+    b->slack = NULL;
+    b->slack_add = NULL;
+    b->seq_cap = b->seq_first = b->seq_end = 0;
+    pthread_mutex_unlock(&b->lock);
+    return 0;
+}
+
+static int need_of(const BankClient *c, int j) {
+    return c->max[j] - c->alloc[j];
+}
+
+// Sorted lists, with the lock held. A client's need only changes by small
+// steps, so it is moved by shifting its neighbours rather than re-sorted.
+static void sift(Bank *b, int j, BankClient *c) {
+    BankClient **o = b->order[j];
+    int i = c->pos[j], need = need_of(c, j);
+    while (i > 0 && need_of(o[i - 1], j) > need) {
+        o[i] = o[i - 1];
+        o[i]->pos[j] = i;
+        i--;
+    }
+    while (i + 1 < b->order_count[j] && need_of(o[i + 1], j) < need) {
+        o[i] = o[i + 1];
+        o[i]->pos[j] = i;
+        i++;
+    }
+    o[i] = c;
+    c->pos[j] = i;
+}
+
+static int list_insert(Bank *b, int j, BankClient *c) {
+    if (b->order_count[j] == b->order_capacity[j]) {
+        int capacity = b->order_capacity[j] ? b->order_capacity[j] * 2 : 16;
+        BankClient **o = realloc(b->order[j], capacity * sizeof(BankClient *));
+        if (!o) return -1;
+        b->order[j] = o;
+        b->order_capacity[j] = capacity;
+    }
+    c->pos[j] = b->order_count[j]++;
+    b->order[j][c->pos[j]] = c;
+    sift(b, j, c);
+    return 0;
+}
+
+static void list_remove(Bank *b, int j, BankClient *c) {
+    BankClient **o = b->order[j];
+    for (int i = c->pos[j] + 1; i < b->order_count[j]; i++) {
+        o[i - 1] = o[i];
+        o[i - 1]->pos[j] = i - 1;
+    }
+    b->order_count[j]--;
+}
+
+// Safe sequence
+// Each resource j has a min-tree over the sequence slots: a leaf holds
+// what a client would have left of j at its turn, work - need, and an
+// inner node the minimum below it plus an add pending for its whole
+// subtree. Empty slots hold SLACK_NONE.
+#define SLACK_NONE (INT_MAX / 2)
+
+static int *slack_tree(Bank *b, int j) {
+    return b->slack + (size_t)j * 2 * b->seq_cap;
+}
+
+static int *slack_adds(Bank *b, int j) {
+    return b->slack_add + (size_t)j * 2 * b->seq_cap;
+}
+
+static int min_int(int a, int b) {
+    return a < b ? a : b;
+}
+
+// Adds v to slots [0, end)
+static void tree_add(int *t, int *d, int node, int lo, int hi, int end, int v) {
+    if (end <= lo) return;
+    if (hi <= end) {
+        t[node] += v;
+        d[node] += v;
+        return;
+    }
+    int mid = (lo + hi) / 2;
+    tree_add(t, d, 2 * node, lo, mid, end, v);
+    tree_add(t, d, 2 * node + 1, mid, hi, end, v);
+    t[node] = min_int(t[2 * node], t[2 * node + 1]) + d[node];
+}
+
+// Minimum over slots [0, end)
+static int tree_min(const int *t, const int *d, int node, int lo, int hi, int end) {
+    if (end <= lo) return SLACK_NONE;
+    if (hi <= end) return t[node];
+    int mid = (lo + hi) / 2;
+    return min_int(tree_min(t, d, 2 * node, lo, mid, end), tree_min(t, d, 2 * node + 1, mid, hi, end)) + d[node];
+}
+
+static void slack_add_prefix(Bank *b, int j, int end, int v) {
+    tree_add(slack_tree(b, j), slack_adds(b, j), 1, 0, b->seq_cap, end, v);
+}
+
+static int slack_min_prefix(Bank *b, int j, int end) {
+    return tree_min(slack_tree(b, j), slack_adds(b, j), 1, 0, b->seq_cap, end);
+}
+
+// Sets a slot's slack, net of the adds pending above it
+static void slack_set(Bank *b, int j, int slot, int v) {
+    int *t = slack_tree(b, j), *d = slack_adds(b, j);
+    int leaf = b->seq_cap + slot, above = 0;
+    for (int k = leaf >> 1; k; k >>= 1) above += d[k];
+    t[leaf] = v == SLACK_NONE ? SLACK_NONE : v - above;
+    for (int k = leaf >> 1; k; k >>= 1) t[k] = min_int(t[2 * k], t[2 * k + 1]) + d[k];
+}
+
+// Lays out a valid order from scratch, leaving front free slots before it
+static int seq_build(Bank *b, BankClient **order, int count, int front) {
+    int cap = 64;
+    while (cap < count + front + count / 4 + 64) cap *= 2;
+    if (cap != b->seq_cap) {
+        BankClient **seq = malloc(cap * sizeof(BankClient *));
+        int *slack = malloc((size_t)b->m * 2 * cap * sizeof(int));
+        int *slack_add = malloc((size_t)b->m * 2 * cap * sizeof(int));
+        if (!seq || !slack || !slack_add) {
+            free(seq);
+            free(slack);
+            free(slack_add);
+            return -1;
+        }
+        free(b->seq);
+        free(b->slack);
+        free(b->slack_add);
+        b->seq = seq;
+        b->slack = slack;
+        b->slack_add = slack_add;
+        b->seq_cap = cap;
+    }
+    b->rebuilds++;
+    int start = front + (cap - count - front) / 4;
+    memset(b->seq, 0, cap * sizeof(BankClient *));
+    memset(b->slack_add, 0, (size_t)b->m * 2 * cap * sizeof(int));
+    for (int j = 0; j < b->m; j++) {
+        int *t = slack_tree(b, j), work = b->available[j];
+        for (int i = 0; i < cap; i++) t[cap + i] = SLACK_NONE;
+        for (int i = 0; i < count; i++) {
+            t[cap + start + i] = work - need_of(order[i], j);
+            work += order[i]->alloc[j];
+        }
+        for (int k = cap - 1; k > 0; k--) t[k] = min_int(t[2 * k], t[2 * k + 1]);
+    }
+    for (int i = 0; i < count; i++) {
+        b->seq[start + i] = order[i];
+        order[i]->seq_pos = start + i;
+    }
+    b->seq_first = start;
+    b->seq_end = start + count;
+    return 0;
+}
+
+// Same order, with the gaps left by departed clients closed up
+static int seq_compact(Bank *b, int front) {
+    int n = 0;
+    for (int i = b->seq_first; i < b->seq_end; i++) {
+        if (b->seq[i]) b->stack[n++] = b->seq[i];
+    }
+    return seq_build(b, b->stack, n, front + n / 8);
+}
+
+// Takes a client out, handing back what it holds to everyone before it
+static void seq_remove(Bank *b, BankClient *c) {
+    for (int j = 0; j < b->m; j++) {
+        if (c->alloc[j]) slack_add_prefix(b, j, c->seq_pos, c->alloc[j]);
+        slack_set(b, j, c->seq_pos, SLACK_NONE);
+    }
+    b->seq[c->seq_pos] = NULL;
+    c->seq_pos = -1;
+}
+
+// A new client holds nothing, so it can go last: by then every unit of
+// every resource is back
+static int seq_append(Bank *b, BankClient *c) {
+    if (b->seq_end == b->seq_cap && seq_compact(b, 0) < 0) return -1;
+    c->seq_pos = b->seq_end++;
+    b->seq[c->seq_pos] = c;
+    for (int j = 0; j < b->m; j++) slack_set(b, j, c->seq_pos, b->total[j] - c->max[j]);
+    return 0;
+}
+
+// Moves moved[0..n), in that order, to the front. They must be able to
+// finish one after another from what is available now. Everyone else
+// keeps their order and gains what the moved clients behind them hold.
+static int seq_promote(Bank *b, BankClient **moved, int n) {
+    int live = b->clients, log_cap = 1;
+    while ((1 << log_cap) < b->seq_cap) log_cap++;
+    if ((long)n * log_cap > live) {
+        // Cheaper to lay everything out again
+        for (int i = 0; i < n; i++) moved[i]->moving = 1;
+        int count = 0;
+        for (int i = 0; i < n; i++) b->stack[count++] = moved[i];
+        for (int i = b->seq_first; i < b->seq_end; i++) {
+            if (b->seq[i] && !b->seq[i]->moving) b->stack[count++] = b->seq[i];
+        }
+        for (int i = 0; i < n; i++) moved[i]->moving = 0;
+        return seq_build(b, b->stack, count, live / 8);
+    }
+    if (b->seq_first < n && seq_compact(b, n) < 0) return -1;
+    for (int i = 0; i < n; i++) seq_remove(b, moved[i]);
+    int work[BANK_MAX_RESOURCES], first = b->seq_first - n;
+    memcpy(work, b->available, b->m * sizeof(int));
+    for (int i = 0; i < n; i++) {
+        BankClient *c = moved[i];
+        c->seq_pos = first + i;
+        b->seq[c->seq_pos] = c;
+        for (int j = 0; j < b->m; j++) {
+            slack_set(b, j, c->seq_pos, work[j] - need_of(c, j));
+            work[j] += c->alloc[j];
+        }
+    }
+    b->seq_first = first;
+    return 0;
+}
+
+static void unregister(Bank *b, BankClient *c) {
+    if (c->seq_pos >= 0) seq_remove(b, c);
+    for (int j = 0; j < b->m; j++) {
+        if (c->max[j]) list_remove(b, j, c);
+    }
+    b->clients--;
+    c->pcb->bank_client = NULL;
+    free(c);
+}
+
+// A claim beyond a resource's total could never be met, so it is refused
+static BankClient *register_client(Bank *b, PCB *p) {
+    int m = b->m;
+    if (p->claim_count > m) return NULL;
+    for (int j = 0; j < p->claim_count; j++) {
+        if (p->claim[j] > b->total[j]) return NULL;
+    }
+    if (b->clients + 1 > b->stack_capacity) {
+        int capacity = b->stack_capacity ? b->stack_capacity * 2 : 64;
+        BankClient **stack = realloc(b->stack, capacity * sizeof(BankClient *));
+        if (stack) b->stack = stack;
+        BankClient **finished = realloc(b->finished, capacity * sizeof(BankClient *));
+        if (finished) b->finished = finished;
+        if (!stack || !finished) return NULL;
+        b->stack_capacity = capacity;
+    }
+    BankClient *c = calloc(1, sizeof(BankClient) + 4 * m * sizeof(int));
+    if (!c) return NULL;
+    c->bank = b;
+    c->pcb = p;
+    c->max = (int *)(c + 1);
+    c->alloc = c->max + m;
+    c->pos = c->alloc + m;
+    c->request = c->pos + m;
+    c->seq_pos = -1;
+    for (int j = 0; j < p->claim_count; j++) c->max[j] = p->claim[j] > 0 ? p->claim[j] : 0;
+    b->clients++;
+    p->bank_client = c;
+    for (int j = 0; j < m; j++) {
+        if (!c->max[j]) continue;
+        c->claimed_types++;
+        c->outstanding += c->max[j];
+        if (list_insert(b, j, c) < 0) {
+            // Leave only the lists it already joined for unregister()
+            for (int k = j; k < m; k++) c->max[k] = 0;
+            unregister(b, c);
+            return NULL;
+        }
+    }
+    if (b->avoid && seq_append(b, c) < 0) {
+        unregister(b, c);
+        return NULL;
+    }
+    return c;
+}
+
+// Safety check
+// Marks every client whose need for resource j now fits and queues those
+// that fit on every resource they claim
+static int advance(Bank *b, int j, const int *work, int *ptr, int top) {
+    BankClient **o = b->order[j];
+    while (ptr[j] < b->order_count[j] && need_of(o[ptr[j]], j) <= work[j]) {
+        BankClient *c = o[ptr[j]++];
+        b->visited++;
+        if (c->epoch != b->epoch) {
+            c->epoch = b->epoch;
+            c->satisfied = 0;
+        }
+        if (++c->satisfied == c->claimed_types) b->stack[top++] = c;
+    }
+    return top;
+}
+
+// Reduction from the current state, stopping once target could finish.
+// The clients finished on the way are left in b->finished, *n of them.
+static int reduce(Bank *b, BankClient *target, int *n) {
+    int work[BANK_MAX_RESOURCES], ptr[BANK_MAX_RESOURCES] = { 0 };
+    memcpy(work, b->available, b->m * sizeof(int));
+    b->epoch++;
+    int top = 0;
+    *n = 0;
+    for (int j = 0; j < b->m; j++) top = advance(b, j, work, ptr, top);
+    while (top > 0) {
+        BankClient *c = b->stack[--top];
+        if (c == target) return 1;
+        b->finished[(*n)++] = c;
+        for (int j = 0; j < b->m; j++) {
+            if (!c->alloc[j]) continue;
+            work[j] += c->alloc[j];
+            top = advance(b, j, work, ptr, top);
+        }
+    }
+    return 0;
+}
+
+static int can_finish_now(Bank *b, BankClient *c) {
+    for (int j = 0; j < b->m; j++) {
+        if (need_of(c, j) > b->available[j]) return 0;
+    }
+    return 1;
+}
+
+static void apply(Bank *b, BankClient *c, const int *request, int sign) {
+    for (int j = 0; j < b->m; j++) {
+        if (!request[j]) continue;
+        c->alloc[j] += sign * request[j];
+        c->outstanding -= sign * request[j];
+        b->available[j] -= sign * request[j];
+        sift(b, j, c);
+    }
+}
+
+typedef enum { GRANT_OK, GRANT_UNAVAILABLE, GRANT_UNSAFE, GRANT_INVALID } GrantOutcome;
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Whether the safe sequence still works after c was granted request
+static int seq_admits(Bank *b, BankClient *c, const int *request, int sign) {
+    int ok = 1;
+    for (int j = 0; j < b->m; j++) {
+        if (!request[j]) continue;
+        slack_add_prefix(b, j, c->seq_pos, -sign * request[j]);
+        if (sign > 0 && slack_min_prefix(b, j, c->seq_pos) < 0) ok = 0;
+    }
+    return ok;
+}
+
+// Relies on the state before the grant being safe, which avoidance keeps.
+// A refused request leaves in *waits_on the list it should wait in.
+static GrantOutcome try_grant(Bank *b, BankClient *c, const int *request, int *waits_on) {
+    for (int j = 0; j < b->m; j++) {
+        if (request[j] < 0 || request[j] > need_of(c, j)) return GRANT_INVALID;
+    }
+    for (int j = 0; j < b->m; j++) {
+        if (request[j] > b->available[j]) {
+            *waits_on = j;
+            return GRANT_UNAVAILABLE;
+        }
+    }
+    apply(b, c, request, 1);
+    if (!b->avoid) return GRANT_OK;
+    if (seq_admits(b, c, request, 1)) {
+        b->seq_grants++;
+        return GRANT_OK;
+    }
+    // The sequence's slack now matches the granted state, so moving
+    // clients to its front repairs it
+    if (can_finish_now(b, c)) {
+        if (seq_promote(b, &c, 1) < 0) goto fail;
+        b->fast_grants++;
+        return GRANT_OK;
+    }
+    long long start = now_ns();
+    int n, safe = reduce(b, c, &n);
+    b->check_ns += now_ns() - start;
+    if (safe) {
+        b->finished[n] = c;
+        if (seq_promote(b, b->finished, n + 1) < 0) goto fail;
+        b->checked_grants++;
+        return GRANT_OK;
+    }
+    seq_admits(b, c, request, -1);
+    apply(b, c, request, -1);
+    *waits_on = BANK_UNSAFE_LIST;
+    return GRANT_UNSAFE;
+fail:
+    seq_admits(b, c, request, -1);
+    apply(b, c, request, -1);
+    return GRANT_INVALID;
+}
+
+static void pending_append(Bank *b, BankClient *c, int list) {
+    c->waits_on = list;
+    c->next_pending = NULL;
+    if (b->pending_tail[list]) b->pending_tail[list]->next_pending = c;
+    else b->pending_head[list] = c;
+    b->pending_tail[list] = c;
+}
+
+static void pending_unlink(Bank *b, BankClient *c, BankClient *prev) {
+    int list = c->waits_on;
+    if (prev) prev->next_pending = c->next_pending;
+    else b->pending_head[list] = c->next_pending;
+    if (b->pending_tail[list] == c) b->pending_tail[list] = prev;
+}
+
+static void park(Bank *b, BankClient *c, const int *request, int waits_on) {
+    memcpy(c->request, request, b->m * sizeof(int));
+    c->blocked = 1;
+    pending_append(b, c, waits_on);
+    b->pending++;
+    if (b->on_block) b->on_block(c->pcb, b->ctx);
+}
+
+// Oldest first within a list. A request that is still short of the same
+// resource keeps its place; one now short of another moves to that list.
+static void retry_list(Bank *b, int list) {
+    BankClient *prev = NULL, *c = b->pending_head[list];
+    while (c && (list == BANK_UNSAFE_LIST || b->available[list] > 0)) {
+        BankClient *next = c->next_pending;
+        int waits_on = list;
+        GrantOutcome outcome = try_grant(b, c, c->request, &waits_on);
+        if (outcome == GRANT_OK) {
+            pending_unlink(b, c, prev);
+            b->pending--;
+            c->blocked = 0;
+            b->wakeups++;
+            if (b->on_wake) b->on_wake(c->pcb, b->ctx);
+        } else if (waits_on != list) {
+            pending_unlink(b, c, prev);
+            pending_append(b, c, waits_on);
+        } else {
+            prev = c;
+        }
+        c = next;
+    }
+}
+
+static void retry_pending(Bank *b, const int *released) {
+    for (int j = 0; j < b->m; j++) {
+        if (released[j]) retry_list(b, j);
+    }
+    if (b->avoid) retry_list(b, BANK_UNSAFE_LIST);
+}
+
+static void unpark(Bank *b, BankClient *c) {
+    BankClient *prev = NULL;
+    for (BankClient *x = b->pending_head[c->waits_on]; x; prev = x, x = x->next_pending) {
+        if (x != c) continue;
+        pending_unlink(b, c, prev);
+        b->pending--;
+        break;
+    }
+    c->blocked = 0;
+}
+
+static BankResult request_locked(Bank *b, PCB *p, const int *request) {
+    BankClient *c = p->bank_client;
+    if (!c && !(c = register_client(b, p))) return BANK_ERROR;
+    b->requests++;
+    int waits_on = 0;
+    switch (try_grant(b, c, request, &waits_on)) {
+    case GRANT_OK:
+        return BANK_GRANTED;
+    case GRANT_UNAVAILABLE:
+        b->unavailable++;
+        break;
+    case GRANT_UNSAFE:
+        b->unsafe++;
+        break;
+    default:
+        return BANK_ERROR;
+    }
+    park(b, c, request, waits_on);
+    return BANK_BLOCKED;
+}
+
+// Request vector over all m resources. A blocked request is granted later,
+// oldest first among those waiting on the same resource, and the PCB woken
+// through on_wake.
+BankResult bank_request(Bank *b, PCB *p, const int *request) {
+    pthread_mutex_lock(&b->lock);
+    BankResult result = request_locked(b, p, request);
+    pthread_mutex_unlock(&b->lock);
+    return result;
+}
+
+// Whether a job is still building up its claim; read without the lock by
+// the CPU running it, the only one that changes it
+int bank_wants(const PCB *p) {
+    return p->claim_count > 0 && (!p->bank_client || p->bank_client->outstanding > 0);
+}
+
+// One step of a job's claim: the next unit it does not hold yet, taking
+// its claimed resources in turn. BANK_NONE once it holds its whole claim.
+BankResult bank_step(Bank *b, PCB *p) {
+    if (p->claim_count <= 0) return BANK_NONE;
+    pthread_mutex_lock(&b->lock);
+    BankClient *c = p->bank_client;
+    if (!c && !(c = register_client(b, p))) {
+        // The claim can never be met, so the job runs without it
+        p->claim_count = 0;
+        pthread_mutex_unlock(&b->lock);
+        return BANK_ERROR;
+    }
+    int m = b->m, j = -1;
+    for (int k = 0; k < m; k++) {
+        int r = (c->next + k) % m;
+        if (need_of(c, r) > 0) {
+            j = r;
+            break;
+        }
+    }
+    BankResult result = BANK_NONE;
+    if (j >= 0) {
+        int request[BANK_MAX_RESOURCES] = { 0 };
+        request[j] = 1;
+        c->next = (j + 1) % m;
+        result = request_locked(b, p, request);
+    }
+    pthread_mutex_unlock(&b->lock);
+    return result;
+}
+
+// Everything goes back at exit, which is what lets waiting requests run
+void bank_release_all(Bank *b, PCB *p) {
+    pthread_mutex_lock(&b->lock);
+    BankClient *c = p->bank_client;
+    if (c) {
+        int released[BANK_MAX_RESOURCES];
+        if (c->blocked) unpark(b, c);
+        for (int j = 0; j < b->m; j++) {
+            released[j] = c->alloc[j];
+            b->available[j] += released[j];
+        }
+        unregister(b, c);
+        retry_pending(b, released);
+    }
+    pthread_mutex_unlock(&b->lock);
+}
+
+// Textbook O(n^2*m) check over every client, for the benchmark to compare
+int bank_is_safe_naive(Bank *b) {
+    pthread_mutex_lock(&b->lock);
+    int n = 0;
+    b->epoch++;
+    for (int j = 0; j < b->m; j++) {
+        for (int i = 0; i < b->order_count[j]; i++) {
+            BankClient *c = b->order[j][i];
+            if (c->epoch != b->epoch) {
+                c->epoch = b->epoch;
+                b->stack[n++] = c;
+            }
+        }
+    }
+    int work[BANK_MAX_RESOURCES];
+    memcpy(work, b->available, b->m * sizeof(int));
+    char *done = calloc(n ? n : 1, 1);
+    int finished = 0, progress = 1;
+    while (progress) {
+        progress = 0;
+        for (int i = 0; i < n; i++) {
+            if (done[i]) continue;
+            int fits = 1;
+            for (int j = 0; j < b->m && fits; j++) fits = need_of(b->stack[i], j) <= work[j];
+            if (!fits) continue;
+            for (int j = 0; j < b->m; j++) work[j] += b->stack[i]->alloc[j];
+            done[i] = 1;
+            finished++;
+            progress = 1;
+        }
+    }
+    free(done);
+    pthread_mutex_unlock(&b->lock);
+    return finished == n;
+}
+
+void print_bank(Bank *b) {
+    pthread_mutex_lock(&b->lock);
+    printf("[Bank] %d resource types, %d clients, %d blocked, deadlock avoidance %s\n", b->m, b->clients,
+           b->pending, b->avoid ? "on" : "off");
+    if (b->m) {
+        printf("RESOURCE  TOTAL  AVAILABLE  CLAIMANTS\n");
+        for (int j = 0; j < b->m; j++) {
+            printf("%8d %6d %10d %10d\n", j, b->total[j], b->available[j], b->order_count[j]);
+        }
+    }
+    long checks = b->checked_grants + b->unsafe;
+    printf("[Bank] Requests: %ld, Granted on the safe sequence: %ld, Granted at once: %ld, Granted after a check: %ld\n",
+           b->requests, b->seq_grants, b->fast_grants, b->checked_grants);
+    printf("[Bank] Blocked as unsafe: %ld, Blocked as unavailable: %ld, Woken: %ld\n", b->unsafe,
+           b->unavailable, b->wakeups);
+    printf("[Bank] Full checks: %ld, Avg list entries walked: %.1f, Avg time: %.3f ms, Sequence rebuilds: %ld\n",
+           checks, checks ? (double)b->visited / checks : 0.0, checks ? b->check_ns / 1e6 / checks : 0.0, b->rebuilds);
+    pthread_mutex_unlock(&b->lock);
+}
+
+// Benchmark: random claims and requests on a private bank, with the
+// textbook check timed on the same states for comparison
+#define BENCH_CLAIMED_TYPES 4
+#define BENCH_NAIVE_SAMPLES 20
+
+static void bench_claim(PCB *p, int m, unsigned int *seed) {
+    memset(p->claim, 0, m * sizeof(int));
+    for (int k = 0; k < BENCH_CLAIMED_TYPES && k < m; k++) p->claim[rand_r(seed) % m] = 1 + rand_r(seed) % 3;
+    p->claim_count = m;
+}
+
+static double seconds_since(const struct timespec *start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+void run_bank_benchmark(int clients, int m, int requests) {
+    if (m < 1 || m > BANK_MAX_RESOURCES || clients < 1) {
+        printf("Usage: bank bench [clients] [1-%d types] [requests]\n", BANK_MAX_RESOURCES);
+        return;
+    }
+    // About a third of the claims fit at once, so requests contend
+    int total[BANK_MAX_RESOURCES];
+    long expected = (long)clients * BENCH_CLAIMED_TYPES * 2 / m;
+    for (int j = 0; j < m; j++) total[j] = expected / 3 > 3 ? expected / 3 : 3;
+
+    Bank b;
+    bank_init(&b, total, m);
+    PCB **pcbs = malloc(clients * sizeof(PCB *));
+    int *claims = malloc((size_t)clients * m * sizeof(int));
+    if (!pcbs || !claims) {
+        perror("bank bench");
+        free(pcbs);
+        free(claims);
+        bank_destroy(&b);
+        return;
+    }
+    unsigned int seed = 12345;
+    for (int i = 0; i < clients; i++) {
+        pcbs[i] = pcb_create(i + 1, 0, 1);
+        pcbs[i]->claim = claims + (size_t)i * m;
+        bench_claim(pcbs[i], m, &seed);
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    long finished = 0, unsafe_states = 0;
+    for (int r = 0; r < requests; r++) {
+        PCB *p = pcbs[rand_r(&seed) % clients];
+        BankClient *c = p->bank_client;
+        if (c && c->blocked) continue;
+        if (bank_step(&b, p) == BANK_NONE && p->bank_client) {
+            // Holds its whole claim: finish, and come back with a new one
+            bank_release_all(&b, p);
+            bench_claim(p, m, &seed);
+            finished++;
+        }
+    }
+    double elapsed = seconds_since(&start);
+
+    // The textbook check on the final state, timed and cross-checked
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < BENCH_NAIVE_SAMPLES; i++) unsafe_states += !bank_is_safe_naive(&b);
+    double naive = seconds_since(&start) / BENCH_NAIVE_SAMPLES;
+
+    // Picks of a blocked client issue no request, so count the ones made
+    printf("[Bank] %d clients, %d resource types, %ld requests in %.3f s (%.0f/s), %ld jobs finished\n", clients,
+           m, b.requests, elapsed, elapsed > 0 ? b.requests / elapsed : 0.0, finished);
+    print_bank(&b);
+    printf("[Bank] Textbook O(n^2*m) check on the final state: %.3f ms each, state %s\n", naive * 1000,
+           unsafe_states ? "UNSAFE" : "safe");
+
+    for (int i = 0; i < clients; i++) {
+        if (pcbs[i]->bank_client) {
+            BankClient *c = pcbs[i]->bank_client;
+            if (c->blocked) unpark(&b, c);
+            unregister(&b, c);
+        }
+        pcbs[i]->claim = NULL;
+        pcb_free(pcbs[i]);
+    }
+    free(claims);
+    free(pcbs);
+    bank_destroy(&b);
+}
@@ -0,0 +1,94 @@
+#ifndef BANKER_H
+#define BANKER_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include "advancedScheduler.h"
+
+#define BANK_MAX_RESOURCES 64
+#define BANK_UNSAFE_LIST BANK_MAX_RESOURCES
+
+typedef enum { BANK_NONE, BANK_GRANTED, BANK_BLOCKED, BANK_ERROR } BankResult;
+
+struct Bank;
+
+// A PCB's claims and holdings. It is registered on its first request, sits
+// in the need-sorted list of every resource it claims, and leaves when it
+// releases everything.
+typedef struct BankClient {
+    struct Bank *bank;
+    PCB *pcb;
+    int claimed_types;          // resources with a nonzero claim
+    int outstanding;            // units claimed but not held yet
+    int next;                   // round-robin cursor for bank_step()
+    int blocked;
+    int waits_on;               // pending list it sits in, BANK_UNSAFE_LIST if unsafe
+    int seq_pos;                // slot in the safe sequence, -1 if not in it
+    int moving;
+    int satisfied;              // resources whose need fits, in the current check
+    unsigned long epoch;        // check that satisfied belongs to
+    struct BankClient *next_pending;
+    int *max, *alloc, *pos, *request;
+} BankClient;
+
+// Banker's algorithm over m resource types. With avoidance on, the bank
+// keeps a safe sequence of its clients and, per resource, a tree of the
+// slack each one would have at its turn. A grant only lowers the slack of
+// those before the requester, so it is safe if none of them goes negative,
+// O(m log n). When that fails, a requester that could finish at once moves
+// to the front of the sequence; otherwise a full check runs over per-resource
+// lists sorted by need, which walks each list once, O(n*m) rather than
+// O(n^2*m), and stops as soon as the requester could finish.
+typedef struct Bank {
+    pthread_mutex_t lock;
+    int m;
+    int total[BANK_MAX_RESOURCES];
+    int available[BANK_MAX_RESOURCES];
+    int avoid;                  // 0 grants whatever is available, deadlocks included
+    BankClient **order[BANK_MAX_RESOURCES];
+    int order_count[BANK_MAX_RESOURCES];
+    int order_capacity[BANK_MAX_RESOURCES];
+    BankClient **stack;         // safety check scratch, one per client
+    BankClient **finished;      // clients a full check finished, in order
+    int stack_capacity;
+    BankClient **seq;           // safe sequence, NULL where a client left
+    int seq_cap, seq_first, seq_end;
+    int *slack, *slack_add;     // m min-trees of 2*seq_cap nodes over seq
+
+    int clients;
+    unsigned long epoch;
+    // Blocked requests, by the resource they wait for, so a release only
+    // retries the ones it can help; unsafe ones wait on any release
+    BankClient *pending_head[BANK_MAX_RESOURCES + 1], *pending_tail[BANK_MAX_RESOURCES + 1];
+    int pending;
+    // Called with the lock held, so a wakeup cannot overtake its block
+    void (*on_block)(PCB *, void *);
+    void (*on_wake)(PCB *, void *);
+    void *ctx;
+    long requests;
+    long seq_grants;
+    long fast_grants;
+    long checked_grants;
+    long unsafe;
+    long unavailable;
+    long wakeups;
+    long visited;               // list entries walked by full checks
+    long check_ns;              // time spent in full checks
+    long rebuilds;              // sequence rebuilt or compacted
+} Bank;
+
+extern Bank bank;
+
+void bank_init(Bank *b, const int *total, int m);
+void bank_destroy(Bank *b);
+int bank_set_avoid(Bank *b, int avoid);
+int bank_set_totals(Bank *b, const int *total, int m);
+BankResult bank_request(Bank *b, PCB *p, const int *request);
+int bank_wants(const PCB *p);
+BankResult bank_step(Bank *b, PCB *p);
+void bank_release_all(Bank *b, PCB *p);
+int bank_is_safe_naive(Bank *b);
+void print_bank(Bank *b);
+void run_bank_benchmark(int clients, int m, int requests);
+
+#endif
@@ -0,0 +1,333 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cacheSim.h"
+
+// Each level stores line keys (line address + 1, so 0 can mean empty) in
+// per-set arrays ordered most to least recently used. Lookups check the MRU
+// slot first, which is the common case in trace replay.
+CacheHierarchy cache;
+
+// Scheduled PCBs reach cache_access() from the CPU threads while the shell
+// reconfigures or replays, so every entry point takes this; recursive
+// because they call each other
+static pthread_mutex_t cache_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+#define TRACE_LOCK_BATCH 4096   // replayed accesses per lock hold
+
+static const char *level_names[MAX_CACHE_LEVELS] = { "L1", "L2", "LLC" };
+
+static int log2_exact(int value) {
+    if (value <= 0 || (value & (value - 1))) return -1;
+    int shift = 0;
+    while ((1 << shift) < value) shift++;
+    return shift;
+}
+
+// Recomputes set geometry for one level and clears its contents
+static int build_level(CacheLevel *level, int line_size) {
+    int sets = level->size / (line_size * level->ways);
+    if (sets <= 0 || log2_exact(sets) < 0) return -1;
+    uint64_t *tags = calloc((size_t)sets * level->ways, sizeof(uint64_t));
+    if (!tags) return -1;
+    free(level->tags);
+    level->tags = tags;
+    level->sets = sets;
+    level->set_mask = sets - 1;
+    level->hits = level->misses = 0;
+    return 0;
+}
+
+void cache_init() {
+    pthread_mutex_lock(&cache_mutex);
+    for (int i = 0; i < MAX_CACHE_LEVELS; i++) free(cache.levels[i].tags);
+    memset(&cache, 0, sizeof(cache));
+    cache.line_size = 64;
+    cache.line_shift = 6;
+    cache.memory_latency = 200;
+    cache.inclusion = CACHE_INCLUSIVE;
+    cache.level_count = 3;
+    cache.levels[0] = (CacheLevel){ .size = 32 * 1024, .ways = 8, .latency = 4 };
+    cache.levels[1] = (CacheLevel){ .size = 256 * 1024, .ways = 8, .latency = 12 };
+    cache.levels[2] = (CacheLevel){ .size = 8 * 1024 * 1024, .ways = 16, .latency = 40 };
+    for (int i = 0; i < cache.level_count; i++) build_level(&cache.levels[i], cache.line_size);
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+// level is 1-based; configuring one past the last level adds it, and a size
+// of 0 drops that level and everything below it
+static int configure_level(int level, int size, int ways, int latency) {
+    if (level < 1 || level > MAX_CACHE_LEVELS || level > cache.level_count + 1) return -1;
+    if (size == 0) {
+        for (int i = level - 1; i < cache.level_count; i++) {
+            free(cache.levels[i].tags);
+            cache.levels[i].tags = NULL;
+        }
+        cache.level_count = level - 1;
+        cache_reset();
+        return 0;
+    }
+    if (ways <= 0 || ways > MAX_CACHE_WAYS || latency < 0) return -1;
+    CacheLevel candidate = { .size = size, .ways = ways, .latency = latency };
+    if (build_level(&candidate, cache.line_size) < 0) return -1;
+    free(cache.levels[level - 1].tags);
+    cache.levels[level - 1] = candidate;
+    if (level > cache.level_count) cache.level_count = level;
+    cache_reset();
+    return 0;
+}
+
+int cache_configure_level(int level, int size, int ways, int latency) {
+    pthread_mutex_lock(&cache_mutex);
+    int rc = configure_level(level, size, ways, latency);
+    pthread_mutex_unlock(&cache_mutex);
+    return rc;
+}
+
+int cache_set_line_size(int line_size) {
+    int shift = log2_exact(line_size);
+    if (shift < 0) return -1;
+    pthread_mutex_lock(&cache_mutex);
+    for (int i = 0; i < cache.level_count; i++) {
+        CacheLevel *l = &cache.levels[i];
+        int sets = l->size / (line_size * l->ways);
+        if (sets <= 0 || log2_exact(sets) < 0) {
+            pthread_mutex_unlock(&cache_mutex);
+            return -1;
+        }
+    }
+    cache.line_size = line_size;
+    cache.line_shift = shift;
+    for (int i = 0; i < cache.level_count; i++) build_level(&cache.levels[i], line_size);
+    cache_reset();
+    pthread_mutex_unlock(&cache_mutex);
+    return 0;
+}
+
+void cache_set_inclusion(CacheInclusion inclusion) {
+    pthread_mutex_lock(&cache_mutex);
+    cache.inclusion = inclusion;
+    cache_reset();
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+void cache_set_memory_latency(int cycles) {
+    pthread_mutex_lock(&cache_mutex);
+    cache.memory_latency = cycles;
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+void cache_reset() {
+    pthread_mutex_lock(&cache_mutex);
+    for (int i = 0; i < cache.level_count; i++) {
+        CacheLevel *l = &cache.levels[i];
+        memset(l->tags, 0, (size_t)l->sets * l->ways * sizeof(uint64_t));
+        l->hits = l->misses = 0;
+    }
+    cache.accesses = 0;
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+static inline uint64_t *set_of(CacheLevel *l, uint64_t key) {
+    return l->tags + ((key - 1) & l->set_mask) * l->ways;
+}
+
+// Returns 1 on hit and moves the line to the MRU slot
+static inline int level_lookup(CacheLevel *l, uint64_t key) {
+    uint64_t *set = set_of(l, key);
+    if (set[0] == key) return 1;
+    for (int w = 1; w < l->ways; w++) {
+        if (set[w] == key) {
+            memmove(set + 1, set, w * sizeof(uint64_t));
+            set[0] = key;
+            return 1;
+        }
+        if (set[w] == 0) break;
+    }
+    return 0;
+}
+
+// Inserts a line as MRU and returns the line it displaced, or 0
+static inline uint64_t level_insert(CacheLevel *l, uint64_t key) {
+    uint64_t *set = set_of(l, key);
+    uint64_t victim = set[l->ways - 1];
+    memmove(set + 1, set, (l->ways - 1) * sizeof(uint64_t));
+    set[0] = key;
+    return victim;
+}
+
+static inline void level_remove(CacheLevel *l, uint64_t key) {
+    uint64_t *set = set_of(l, key);
+    for (int w = 0; w < l->ways; w++) {
+        if (set[w] == key) {
+            memmove(set + w, set + w + 1, (l->ways - 1 - w) * sizeof(uint64_t));
+            set[l->ways - 1] = 0;
+            return;
+        }
+    }
+}
+
+// Places a line in level i; for exclusive caches the displaced line moves down
+// one level, for inclusive caches it is back-invalidated from the levels above
+static void fill_level(int i, uint64_t key) {
+    uint64_t victim = level_insert(&cache.levels[i], key);
+    if (!victim) return;
+    if (cache.inclusion == CACHE_EXCLUSIVE) {
+        if (i + 1 < cache.level_count) fill_level(i + 1, victim);
+    } else if (cache.inclusion == CACHE_INCLUSIVE) {
+        for (int j = 0; j < i; j++) level_remove(&cache.levels[j], victim);
+    }
+}
+
+// Returns the 0-based level that hit, or level_count when memory served it
+static int access_line(uint64_t physical_address) {
+    uint64_t key = (physical_address >> cache.line_shift) + 1;
+    int hit = cache.level_count;
+    cache.accesses++;
+
+    for (int i = 0; i < cache.level_count; i++) {
+        if (level_lookup(&cache.levels[i], key)) {
+            cache.levels[i].hits++;
+            hit = i;
+            break;
+        }
+        cache.levels[i].misses++;
+    }
+    if (hit == 0) return 0;
+
+    if (cache.inclusion == CACHE_EXCLUSIVE) {
+        if (hit < cache.level_count) level_remove(&cache.levels[hit], key);
+        fill_level(0, key);
+    } else {
+        // Fill from the outermost missing level inwards so inclusion holds
+        for (int i = hit - 1; i >= 0; i--) fill_level(i, key);
+    }
+    return hit;
+}
+
+int cache_access(uint64_t physical_address) {
+    pthread_mutex_lock(&cache_mutex);
+    int hit = access_line(physical_address);
+    pthread_mutex_unlock(&cache_mutex);
+    return hit;
+}
+
+double cache_amat() {
+    pthread_mutex_lock(&cache_mutex);
+    if (cache.accesses == 0) {
+        pthread_mutex_unlock(&cache_mutex);
+        return 0.0;
+    }
+    double cycles = 0;
+    long reaching = cache.accesses;
+    for (int i = 0; i < cache.level_count; i++) {
+        cycles += (double)reaching * cache.levels[i].latency;
+        reaching = cache.levels[i].misses;
+    }
+    cycles += (double)reaching * cache.memory_latency;
+    cycles /= cache.accesses;
+    pthread_mutex_unlock(&cache_mutex);
+    return cycles;
+}
+
+// Replays a trace of physical addresses, either raw little-endian uint64
+// values or one hex/decimal address per line. The file is mapped rather than
+// read so the parse loop only touches memory.
+int cache_run_trace(const char *filename, int binary) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        perror("Trace open error");
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
+        fprintf(stderr, "Trace %s is empty\n", filename);
+        close(fd);
+        return -1;
+    }
+    const char *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("Trace map error");
+        return -1;
+    }
+    madvise((void *)data, st.st_size, MADV_SEQUENTIAL);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    long count = 0;
+
+    // The lock is dropped every TRACE_LOCK_BATCH accesses so CPU threads
+    // are not held up for the whole replay
+    pthread_mutex_lock(&cache_mutex);
+    if (binary) {
+        const uint64_t *addrs = (const uint64_t *)data;
+        long n = st.st_size / sizeof(uint64_t);
+        for (long i = 0; i < n; i++) {
+            access_line(addrs[i]);
+            if ((i + 1) % TRACE_LOCK_BATCH == 0) {
+                pthread_mutex_unlock(&cache_mutex);
+                pthread_mutex_lock(&cache_mutex);
+            }
+        }
+        count = n;
+    } else {
+        const char *p = data, *limit = data + st.st_size;
+        while (p < limit) {
+            while (p < limit && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+            if (p >= limit) break;
+            if (*p == '#') {
+                while (p < limit && *p != '\n') p++;
+                continue;
+            }
+            uint64_t addr = 0;
+            if (p + 1 < limit && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+                for (p += 2; p < limit; p++) {
+                    char c = *p;
+                    if (c >= '0' && c <= '9') addr = addr << 4 | (c - '0');
+                    else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') addr = addr << 4 | ((c | 0x20) - 'a' + 10);
+                    else break;
+                }
+            } else {
+                for (; p < limit && *p >= '0' && *p <= '9'; p++) addr = addr * 10 + (*p - '0');
+            }
+            while (p < limit && *p != '\n') p++;
+            access_line(addr);
+            if (++count % TRACE_LOCK_BATCH == 0) {
+                pthread_mutex_unlock(&cache_mutex);
+                pthread_mutex_lock(&cache_mutex);
+            }
+        }
+    }
+    pthread_mutex_unlock(&cache_mutex);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    munmap((void *)data, st.st_size);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("[Cache] Replayed %ld accesses in %.3f s (%.1f M accesses/s)\n",
+           count, seconds, seconds > 0 ? count / seconds / 1e6 : 0.0);
+    return 0;
+}
+
+void print_cache_stats() {
+    static const char *inclusion_names[] = { "inclusive", "exclusive", "non-inclusive" };
+    pthread_mutex_lock(&cache_mutex);
+    printf("\nCache Hierarchy (%d-byte lines, %s):\n", cache.line_size, inclusion_names[cache.inclusion]);
+    printf("%-4s %10s %5s %6s %4s %12s %12s %8s\n", "LVL", "SIZE", "WAYS", "SETS", "LAT", "HITS", "MISSES", "HIT_RATE");
+    for (int i = 0; i < cache.level_count; i++) {
+        CacheLevel *l = &cache.levels[i];
+        long total = l->hits + l->misses;
+        printf("%-4s %10d %5d %6d %4d %12ld %12ld %7.2f%%\n", level_names[i], l->size, l->ways, l->sets,
+               l->latency, l->hits, l->misses, total ? 100.0 * l->hits / total : 0.0);
+    }
+    printf("Accesses: %ld, Memory latency: %d, AMAT: %.2f cycles\n\n",
+           cache.accesses, cache.memory_latency, cache_amat());
+    pthread_mutex_unlock(&cache_mutex);
+}
@@ -0,0 +1,45 @@
+#ifndef CACHESIM_H
+#define CACHESIM_H
+
+#include <stdint.h>
+
+#define MAX_CACHE_LEVELS 3
+#define MAX_CACHE_WAYS 32
+
+typedef enum { CACHE_INCLUSIVE, CACHE_EXCLUSIVE, CACHE_NINE } CacheInclusion;
+
+typedef struct {
+    int size;           // bytes
+    int ways;
+    int latency;        // cycles
+    int sets;
+    uint64_t set_mask;
+    uint64_t *tags;     // sets * ways line keys per set, MRU first, 0 = empty
+    long hits;
+    long misses;
+} CacheLevel;
+
+typedef struct {
+    CacheLevel levels[MAX_CACHE_LEVELS];
+    int level_count;
+    int line_size;
+    int line_shift;
+    int memory_latency;
+    CacheInclusion inclusion;
+    long accesses;
+} CacheHierarchy;
+
+extern CacheHierarchy cache;
+
+void cache_init();
+int cache_configure_level(int level, int size, int ways, int latency);
+int cache_set_line_size(int line_size);
+void cache_set_inclusion(CacheInclusion inclusion);
+void cache_set_memory_latency(int cycles);
+void cache_reset();
+int cache_access(uint64_t physical_address);
+int cache_run_trace(const char *filename, int binary);
+double cache_amat();
+void print_cache_stats();
+
+#endif
@@ -0,0 +1,312 @@
+#include <stdio.h>
+#include <pthread.h>
+#include "advancedScheduler.h"
+#include "cfs.h"
+
+// Linux's nice-to-weight table: each nice step is about 10% CPU
+static const int nice_to_weight[40] = {
+    88761, 71755, 56483, 46273, 36291, 29154, 23254, 18705, 14949, 11916,
+    9548,  7620,  6100,  4904,  3906,  3121,  2501,  1991,  1586,  1277,
+    1024,  820,   655,   526,   423,   335,   272,   215,   172,   137,
+    110,   87,    70,    56,    45,    36,    29,    23,    18,    15,
+};
+
+void cfs_init(CFS *c, int target_latency, int min_granularity) {
+    c->root = c->leftmost = NULL;
+    c->nr_running = 0;
+    c->total_weight = 0;
+    c->min_vruntime = 0;
+    c->target_latency = target_latency > 0 ? target_latency : 6;
+    c->min_granularity = min_granularity > 0 ? min_granularity : 1;
+}
+
+long cfs_weight(const PCB *p) {
+    int nice = p->priority < -20 ? -20 : p->priority > 19 ? 19 : p->priority;
+    return nice_to_weight[nice + 20];
+}
+
+static int cfs_before(const PCB *a, const PCB *b) {
+    if (a->vruntime != b->vruntime) return a->vruntime < b->vruntime;
+    return a->seq < b->seq;
+}
+
+static int is_red(const PCB *n) {
+    return n && n->rb_red;
+}
+
+static void rotate_left(CFS *c, PCB *x) {
+    PCB *y = x->rb_right;
+    x->rb_right = y->rb_left;
+    if (y->rb_left) y->rb_left->rb_parent = x;
+    y->rb_parent = x->rb_parent;
+    if (!x->rb_parent) c->root = y;
+    else if (x == x->rb_parent->rb_left) x->rb_parent->rb_left = y;
+    else x->rb_parent->rb_right = y;
+    y->rb_left = x;
+    x->rb_parent = y;
+}
+
+static void rotate_right(CFS *c, PCB *x) {
+    PCB *y = x->rb_left;
+    x->rb_left = y->rb_right;
+    if (y->rb_right) y->rb_right->rb_parent = x;
+    y->rb_parent = x->rb_parent;
+    if (!x->rb_parent) c->root = y;
+    else if (x == x->rb_parent->rb_right) x->rb_parent->rb_right = y;
+    else x->rb_parent->rb_left = y;
+    y->rb_right = x;
+    x->rb_parent = y;
+}
+
+static void insert_fixup(CFS *c, PCB *z) {
+    while (is_red(z->rb_parent)) {
+        PCB *parent = z->rb_parent, *grand = parent->rb_parent;
+        if (parent == grand->rb_left) {
+            PCB *uncle = grand->rb_right;
+            if (is_red(uncle)) {
+                parent->rb_red = uncle->rb_red = 0;
+                grand->rb_red = 1;
+                z = grand;
+                continue;
+            }
+            if (z == parent->rb_right) {
+                rotate_left(c, parent);
+                z = parent;
+                parent = z->rb_parent;
+            }
+            parent->rb_red = 0;
+            grand->rb_red = 1;
+            rotate_right(c, grand);
+        } else {
+            PCB *uncle = grand->rb_left;
+            if (is_red(uncle)) {
+                parent->rb_red = uncle->rb_red = 0;
+                grand->rb_red = 1;
+                z = grand;
+                continue;
+            }
+            if (z == parent->rb_left) {
+                rotate_right(c, parent);
+                z = parent;
+                parent = z->rb_parent;
+            }
+            parent->rb_red = 0;
+            grand->rb_red = 1;
+            rotate_left(c, grand);
+        }
+    }
+    c->root->rb_red = 0;
+}
+
+static void transplant(CFS *c, PCB *u, PCB *v) {
+    if (!u->rb_parent) c->root = v;
+    else if (u == u->rb_parent->rb_left) u->rb_parent->rb_left = v;
+    else u->rb_parent->rb_right = v;
+    if (v) v->rb_parent = u->rb_parent;
+}
+
+// x may be NULL, so its parent is tracked separately
+static void erase_fixup(CFS *c, PCB *x, PCB *parent) {
+    while (x != c->root && !is_red(x)) {
+        if (x == parent->rb_left) {
+            PCB *w = parent->rb_right;
+            if (is_red(w)) {
+                w->rb_red = 0;
+                parent->rb_red = 1;
+                rotate_left(c, parent);
+                w = parent->rb_right;
+            }
+            if (!is_red(w->rb_left) && !is_red(w->rb_right)) {
+                w->rb_red = 1;
+                x = parent;
+                parent = x->rb_parent;
+            } else {
+                if (!is_red(w->rb_right)) {
+                    w->rb_left->rb_red = 0;
+                    w->rb_red = 1;
+                    rotate_right(c, w);
+                    w = parent->rb_right;
+                }
+                w->rb_red = parent->rb_red;
+                parent->rb_red = 0;
+                if (w->rb_right) w->rb_right->rb_red = 0;
+                rotate_left(c, parent);
+                x = c->root;
+            }
+        } else {
+            PCB *w = parent->rb_left;
+            if (is_red(w)) {
+                w->rb_red = 0;
+                parent->rb_red = 1;
+                rotate_right(c, parent);
+                w = parent->rb_left;
+            }
+            if (!is_red(w->rb_left) && !is_red(w->rb_right)) {
+                w->rb_red = 1;
+                x = parent;
+                parent = x->rb_parent;
+            } else {
+                if (!is_red(w->rb_left)) {
+                    w->rb_right->rb_red = 0;
+                    w->rb_red = 1;
+                    rotate_left(c, w);
+                    w = parent->rb_left;
+                }
+                w->rb_red = parent->rb_red;
+                parent->rb_red = 0;
+                if (w->rb_left) w->rb_left->rb_red = 0;
+                rotate_right(c, parent);
+                x = c->root;
+            }
+        }
+    }
+    if (x) x->rb_red = 0;
+}
+
+static void update_min_vruntime(CFS *c) {
+    if (c->leftmost && c->leftmost->vruntime > c->min_vruntime) c->min_vruntime = c->leftmost->vruntime;
+}
+
+// Charges the CPU time used since the last pick, then inserts. A PCB that
+// has been away (new, or back from I/O) is placed no further back than
+// min_vruntime minus half a latency period, so sleepers get a small head
+// start without being able to bank unlimited credit.
+void cfs_enqueue(CFS *c, PCB *p) {
+    long weight = cfs_weight(p);
+    int ran = p->cpu_time_used - p->exec_start;
+    if (ran > 0) p->vruntime += (long)ran * CFS_NICE_0_WEIGHT * CFS_VRUNTIME_SCALE / weight;
+    p->exec_start = p->cpu_time_used;
+
+    long floor = c->min_vruntime - (long)c->target_latency * CFS_VRUNTIME_SCALE / 2;
+    if (p->vruntime < floor) p->vruntime = floor;
+
+    PCB *parent = NULL, **link = &c->root;
+    int leftmost = 1;
+    while (*link) {
+        parent = *link;
+        if (cfs_before(p, parent)) {
+            link = &parent->rb_left;
+        } else {
+            link = &parent->rb_right;
+            leftmost = 0;
+        }
+    }
+    p->rb_parent = parent;
+    p->rb_left = p->rb_right = NULL;
+    p->rb_red = 1;
+    *link = p;
+    if (leftmost) c->leftmost = p;
+    insert_fixup(c, p);
+
+    c->nr_running++;
+    c->total_weight += weight;
+    update_min_vruntime(c);
+}
+
+void cfs_remove(CFS *c, PCB *z) {
+    if (z == c->leftmost) {
+        // The leftmost node has no left child: its successor is the minimum
+        // of its right subtree, or else its parent
+        PCB *next = z->rb_right;
+        if (next) while (next->rb_left) next = next->rb_left;
+        else next = z->rb_parent;
+        c->leftmost = next;
+    }
+
+    PCB *x, *x_parent, *y = z;
+    int y_red = y->rb_red;
+    if (!z->rb_left) {
+        x = z->rb_right;
+        x_parent = z->rb_parent;
+        transplant(c, z, z->rb_right);
+    } else if (!z->rb_right) {
+        x = z->rb_left;
+        x_parent = z->rb_parent;
+        transplant(c, z, z->rb_left);
+    } else {
+        y = z->rb_right;
+        while (y->rb_left) y = y->rb_left;
+        y_red = y->rb_red;
+        x = y->rb_right;
+        if (y->rb_parent == z) {
+            x_parent = y;
+        } else {
+            x_parent = y->rb_parent;
+            transplant(c, y, y->rb_right);
+            y->rb_right = z->rb_right;
+            y->rb_right->rb_parent = y;
+        }
+        transplant(c, z, y);
+        y->rb_left = z->rb_left;
+        y->rb_left->rb_parent = y;
+        y->rb_red = z->rb_red;
+    }
+    if (!y_red) erase_fixup(c, x, x_parent);
+
+    z->rb_left = z->rb_right = z->rb_parent = NULL;
+    c->nr_running--;
+    c->total_weight -= cfs_weight(z);
+    update_min_vruntime(c);
+}
+
+PCB *cfs_pick_next(CFS *c) {
+    PCB *p = c->leftmost;
+    if (!p) return NULL;
+    cfs_remove(c, p);
+    p->exec_start = p->cpu_time_used;
+    return p;
+}
+
+// Slice proportional to weight within the latency period; with too many
+// runnable PCBs the period stretches so nobody drops below min_granularity
+int cfs_timeslice(const CFS *c, const PCB *p) {
+    long weight = cfs_weight(p);
+    long total = c->total_weight + weight;
+    long period = c->target_latency;
+    if ((long)(c->nr_running + 1) * c->min_granularity > period) {
+        period = (long)(c->nr_running + 1) * c->min_granularity;
+    }
+    long slice = period * weight / total;
+    return slice < c->min_granularity ? c->min_granularity : (int)slice;
+}
+
+static void walk(PCB *n, void (*fn)(PCB *, void *), void *ctx) {
+    while (n) {
+        walk(n->rb_left, fn, ctx);
+        PCB *right = n->rb_right;
+        fn(n, ctx);
+        n = right;
+    }
+}
+
+void cfs_for_each(const CFS *c, void (*fn)(PCB *, void *), void *ctx) {
+    walk(c->root, fn, ctx);
+}
+
+typedef struct {
+    long now;
+    double sum, sum_sq;
+    int n;
+    long min_v, max_v;
+} FairnessAcc;
+
+static void accumulate(PCB *p, void *ctx) {
+    FairnessAcc *acc = ctx;
+    long age = acc->now - p->arrival_time;
+    // Service rate normalised by weight; equal under perfect fairness
+    double x = age > 0 ? (double)p->cpu_time_used * CFS_NICE_0_WEIGHT / cfs_weight(p) / age : 0.0;
+    acc->sum += x;
+    acc->sum_sq += x * x;
+    if (acc->n == 0 || p->vruntime < acc->min_v) acc->min_v = p->vruntime;
+    if (acc->n == 0 || p->vruntime > acc->max_v) acc->max_v = p->vruntime;
+    acc->n++;
+}
+
+// Jain's index over weight-normalised service rates of runnable PCBs (1.0 is
+// perfectly fair) and the vruntime spread between them in ticks
+void cfs_fairness(const CFS *c, long now, double *jain_index, double *max_lag) {
+    FairnessAcc acc = { now, 0, 0, 0, 0, 0 };
+    cfs_for_each(c, accumulate, &acc);
+    *jain_index = acc.sum_sq > 0 ? acc.sum * acc.sum / (acc.n * acc.sum_sq) : 1.0;
+    *max_lag = (double)(acc.max_v - acc.min_v) / CFS_VRUNTIME_SCALE;
+}
@@ -0,0 +1,33 @@
+#ifndef CFS_H
+#define CFS_H
+
+#define CFS_NICE_0_WEIGHT 1024
+#define CFS_VRUNTIME_SCALE 1000     // vruntime is kept in 1/1000 weighted ticks
+
+struct PCB;
+
+// Completely fair scheduling. Runnable PCBs sit in a red-black tree ordered
+// by (vruntime, seq), with the leftmost node cached so picking the next PCB
+// is O(1) and insert/remove are O(log n). A PCB's priority is read as a nice
+// value (-20..19) and mapped to a load weight; vruntime advances by the CPU
+// time used scaled by NICE_0_WEIGHT / weight.
+typedef struct CFS {
+    struct PCB *root;
+    struct PCB *leftmost;
+    int nr_running;
+    long total_weight;
+    long min_vruntime;
+    int target_latency;     // ticks in which every runnable PCB should run once
+    int min_granularity;    // smallest slice handed out, in ticks
+} CFS;
+
+void cfs_init(CFS *c, int target_latency, int min_granularity);
+long cfs_weight(const struct PCB *p);
+void cfs_enqueue(CFS *c, struct PCB *p);
+struct PCB *cfs_pick_next(CFS *c);
+void cfs_remove(CFS *c, struct PCB *p);
+int cfs_timeslice(const CFS *c, const struct PCB *p);
+void cfs_fairness(const CFS *c, long now, double *jain_index, double *max_lag);
+void cfs_for_each(const CFS *c, void (*fn)(struct PCB *, void *), void *ctx);
+
+#endif
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <pthread.h>
+#include "advancedScheduler.h"
+#include "edf.h"
+#include "trace.h"
+
+static double density(const PCB *p) {
+    int window = p->rel_deadline;
+    if (p->period > 0 && p->period < window) window = p->period;
+    return (double)p->time_limit / window;
+}
+
+// Density test: the sum over admitted tasks of wcet / min(deadline, period)
+// may not exceed the CPUs available. Exact for implicit deadlines on one CPU,
+// a necessary condition for global EDF on several.
+int edf_admissible(const EdfState *e, const PCB *p) {
+    if (p->rel_deadline <= 0) return 1;
+    double capacity = e->capacity > 0 ? e->capacity : 1.0;
+    return e->utilization + density(p) <= capacity + 1e-9;
+}
+
+// Starts tracking a PCB's deadline from its arrival time. PCBs without a
+// relative deadline sort after every real-time one.
+int edf_register(EdfState *e, PCB *p) {
+    if (p->rel_deadline <= 0) {
+        p->deadline = LONG_MAX;
+        return 0;
+    }
+    EdfTask *t = calloc(1, sizeof(EdfTask));
+    if (!t) return -1;
+    t->pid = p->pid;
+    t->wcet = p->time_limit;
+    t->rel_deadline = p->rel_deadline;
+    t->period = p->period;
+    t->instances_left = p->period > 0 ? (p->instances > 0 ? p->instances : EDF_DEFAULT_INSTANCES) - 1 : 0;
+    t->density = density(p);
+    if (e->tail) e->tail->next = t;
+    else e->tasks = t;
+    e->tail = t;
+
+    e->utilization += t->density;
+    e->admitted++;
+    p->rt_task = t;
+    p->deadline = p->arrival_time + p->rel_deadline;
+    return 0;
+}
+
+static int lateness_bucket(long lateness) {
+    if (lateness <= 0) return 0;
+    int bucket = 64 - __builtin_clzl((unsigned long)lateness);
+    return bucket < EDF_HIST_BUCKETS ? bucket : EDF_HIST_BUCKETS - 1;
+}
+
+// Records a finished instance. Returns 1 when the PCB has been reset as the
+// task's next instance and should arrive again at p->arrival_time, 0 when
+// the task is done and the PCB can be freed.
+int edf_complete(EdfState *e, PCB *p, long now) {
+    EdfTask *t = p->rt_task;
+    if (!t) return 0;
+    long lateness = now - p->deadline;
+    t->hist[lateness_bucket(lateness)]++;
+    t->completed++;
+    e->completed++;
+    if (lateness > 0) {
+        t->misses++;
+        e->misses++;
+    }
+    if (t->completed == 1 || lateness > t->max_lateness) t->max_lateness = lateness;
+
+    if (t->instances_left > 0) {
+        t->instances_left--;
+        p->arrival_time += t->period;
+        p->deadline = p->arrival_time + t->rel_deadline;
+        p->ready_since = p->arrival_time;
+        p->cpu_time_used = 0;
+        p->cpu_time_ns = 0;
+        p->exec_start = 0;
+        p->wait_time = 0;
+        p->io_requested = 0;
+        if (p->script) p->script->next = 0;
+        p->mlfq_level = 0;
+        p->state = READY;
+        return 1;
+    }
+    t->done = 1;
+    e->utilization -= t->density;
+    if (e->utilization < 1e-9) e->utilization = 0;
+    return 0;
+}
+
+// Zeroes the counters and forgets finished tasks; tasks with live PCBs stay
+void edf_clear_stats(EdfState *e) {
+    EdfTask **link = &e->tasks;
+    e->tail = NULL;
+    while (*link) {
+        EdfTask *t = *link;
+        if (t->done) {
+            *link = t->next;
+            free(t);
+            continue;
+        }
+        t->completed = t->misses = t->max_lateness = 0;
+        for (int b = 0; b < EDF_HIST_BUCKETS; b++) t->hist[b] = 0;
+        e->tail = t;
+        link = &t->next;
+    }
+    e->admitted = e->rejected = e->completed = e->misses = 0;
+}
+
+// Frees every task, for when all their PCBs are gone too
+void edf_reset(EdfState *e) {
+    EdfTask *t = e->tasks;
+    while (t) {
+        EdfTask *next = t->next;
+        free(t);
+        t = next;
+    }
+    double capacity = e->capacity;
+    *e = (EdfState){ 0 };
+    e->capacity = capacity;
+}
+
+static void print_histogram(const long *hist) {
+    printf("  lateness <=0: %ld", hist[0]);
+    for (int b = 1; b < EDF_HIST_BUCKETS; b++) {
+        if (!hist[b]) continue;
+        long low = 1L << (b - 1);
+        if (b == EDF_HIST_BUCKETS - 1) printf(", %ld+: %ld", low, hist[b]);
+        else if (low == 1) printf(", 1: %ld", hist[b]);
+        else printf(", %ld-%ld: %ld", low, 2 * low - 1, hist[b]);
+    }
+    printf("\n");
+}
+
+void edf_print(const EdfState *e, int per_task) {
+    printf("[EDF] Admitted: %ld, Rejected: %ld, Utilization: %.3f of %.0f CPUs\n",
+           e->admitted, e->rejected, e->utilization, e->capacity > 0 ? e->capacity : 1.0);
+    printf("[EDF] Completed: %ld, Deadline misses: %ld (%.2f%%)\n",
+           e->completed, e->misses, e->completed ? 100.0 * e->misses / e->completed : 0.0);
+    long total[EDF_HIST_BUCKETS] = { 0 };
+    for (EdfTask *t = e->tasks; t; t = t->next) {
+        for (int b = 0; b < EDF_HIST_BUCKETS; b++) total[b] += t->hist[b];
+        if (!per_task) continue;
+        printf("[EDF] PID %d C=%d D=%d T=%d: %ld done, %ld missed, max lateness %ld\n",
+               t->pid, t->wcet, t->rel_deadline, t->period, t->completed, t->misses, t->max_lateness);
+        print_histogram(t->hist);
+    }
+    if (e->completed && !per_task) print_histogram(total);
+}
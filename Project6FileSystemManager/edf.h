@@ -0,0 +1,46 @@
+#ifndef EDF_H
+#define EDF_H
+
+#define EDF_HIST_BUCKETS 16     // lateness <= 0, 1, 2-3, 4-7, ... 2^14 and up
+#define EDF_DEFAULT_INSTANCES 10
+
+struct PCB;
+
+// One real-time task from a batch line. A periodic task releases its next
+// instance by recycling the PCB of the one that just finished.
+typedef struct EdfTask {
+    int pid;
+    int wcet;               // the job's time_limit
+    int rel_deadline;
+    int period;             // 0 for a one-shot job
+    int instances_left;
+    int done;               // no PCB refers to the task any more
+    double density;         // wcet / min(deadline, period)
+    long completed;
+    long misses;
+    long max_lateness;
+    long hist[EDF_HIST_BUCKETS];
+    struct EdfTask *next;
+} EdfTask;
+
+// Deadline bookkeeping shared by every policy, so EDF can be compared with
+// the others; only EDF turns the density sum into an admission test.
+typedef struct EdfState {
+    double capacity;        // CPUs available to real-time work
+    double utilization;     // density sum of admitted, unfinished tasks
+    long admitted;
+    long rejected;
+    long completed;
+    long misses;
+    EdfTask *tasks;
+    EdfTask *tail;
+} EdfState;
+
+int edf_admissible(const EdfState *e, const struct PCB *p);
+int edf_register(EdfState *e, struct PCB *p);
+int edf_complete(EdfState *e, struct PCB *p, long now);
+void edf_clear_stats(EdfState *e);
+void edf_reset(EdfState *e);
+void edf_print(const EdfState *e, int per_task);
+
+#endif
@@ -0,0 +1,240 @@
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include "advancedScheduler.h"
+#include "fairShare.h"
+
+FairGroup fair_groups[FS_MAX_GROUPS] = { [FS_DEFAULT_GROUP] = { "default", FS_DEFAULT_WEIGHT, 0, 0, NULL } };
+int fair_group_count = 1;
+static pthread_mutex_t groups_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void fair_init(FairShare *fs, int target_latency, int min_granularity) {
+    for (int g = 0; g < FS_MAX_GROUPS; g++) {
+        memset(&fs->rq[g], 0, sizeof(FairRq));
+        cfs_init(&fs->rq[g].cfs, target_latency, min_granularity);
+    }
+    fs->runnable = 0;
+    fs->min_vruntime = 0;
+    atomic_init(&fs->waiting_refill, 0);
+    fs->draining = 0;
+    fs->initialized = 1;
+}
+
+// Groups
+static int valid_limits(long weight, int quota, int period) {
+    if (weight <= 0 || quota < 0 || (quota > 0 && period <= 0)) {
+        printf("Weight must be positive and a quota needs a period\n");
+        return 0;
+    }
+    return 1;
+}
+
+// The leader is a PCB that never runs; joining a group means becoming its child
+int fair_group_create(const char *name, long weight, int quota, int period) {
+    if (!valid_limits(weight, quota, period)) return -1;
+    pthread_mutex_lock(&groups_lock);
+    if (fair_group_find(name) >= 0 || fair_group_count >= FS_MAX_GROUPS) {
+        pthread_mutex_unlock(&groups_lock);
+        printf("Group '%s' exists or the group table is full\n", name);
+        return -1;
+    }
+    PCB *leader = sched_create_process(0, 1);
+    if (!leader) {
+        pthread_mutex_unlock(&groups_lock);
+        return -1;
+    }
+    leader->state = NEW;
+    int id = fair_group_count;
+    FairGroup *grp = &fair_groups[id];
+    strncpy(grp->name, name, FS_NAME_LEN - 1);
+    grp->weight = weight;
+    grp->quota = quota;
+    grp->period = period;
+    grp->leader = leader;
+    leader->fair_group = id;
+    fair_group_count++;
+    pthread_mutex_unlock(&groups_lock);
+    return id;
+}
+
+int fair_group_find(const char *name) {
+    for (int g = 0; g < fair_group_count; g++) {
+        if (strcmp(fair_groups[g].name, name) == 0) return g;
+    }
+    return -1;
+}
+
+int fair_group_set(int id, long weight, int quota, int period) {
+    if (id < 0 || id >= fair_group_count || !valid_limits(weight, quota, period)) return -1;
+    pthread_mutex_lock(&groups_lock);
+    fair_groups[id].weight = weight;
+    fair_groups[id].quota = quota;
+    fair_groups[id].period = period;
+    pthread_mutex_unlock(&groups_lock);
+    return 0;
+}
+
+// Call before the PCB is first queued; a queued PCB must not change group
+int fair_group_join(int id, PCB *p) {
+    if (id <= FS_DEFAULT_GROUP || id >= fair_group_count) return 0;
+    return pcb_add_child(fair_groups[id].leader, p);
+}
+
+// The nearest ancestor leading a group decides, so a member's own
+// children share its group
+int fair_group_of(const PCB *p) {
+    for (const PCB *a = p->parent; a; a = a->parent) {
+        if (a->fair_group >= 0) return a->fair_group;
+    }
+    return FS_DEFAULT_GROUP;
+}
+
+// Accounting. Usage past the quota is carried into later periods, so a PCB
+// that overran its group's budget is paid back rather than forgiven.
+static void refresh_period(FairRq *rq, const FairGroup *grp, long now) {
+    if (grp->quota <= 0 || grp->period <= 0) {
+        rq->used = 0;
+        rq->throttled = 0;
+        return;
+    }
+    long elapsed = now - rq->period_start;
+    if (elapsed < grp->period) return;
+    long periods = elapsed / grp->period;
+    rq->period_start += periods * grp->period;
+    rq->used -= periods * grp->quota;
+    if (rq->used < 0) rq->used = 0;
+    rq->throttled = 0;
+}
+
+static void charge(FairShare *fs, int g, long ran, long now) {
+    if (ran <= 0) return;
+    FairRq *rq = &fs->rq[g];
+    const FairGroup *grp = &fair_groups[g];
+    rq->vruntime += ran * CFS_VRUNTIME_SCALE * FS_DEFAULT_WEIGHT / grp->weight;
+    rq->ran += ran;
+    refresh_period(rq, grp, now);
+    if (grp->quota > 0) rq->used += ran;
+}
+
+static int over_quota(FairRq *rq, const FairGroup *grp, long now) {
+    refresh_period(rq, grp, now);
+    if (grp->quota <= 0 || rq->used < grp->quota) return 0;
+    if (!rq->throttled) {
+        rq->throttled = 1;
+        rq->throttles++;
+    }
+    return 1;
+}
+
+// Policy operations, all with the queue lock held
+int fair_enqueue(FairShare *fs, PCB *p, long now) {
+    int g = fair_group_of(p);
+    FairRq *rq = &fs->rq[g];
+    // Charged before cfs_enqueue() moves exec_start up
+    charge(fs, g, p->cpu_time_used - p->exec_start, now);
+    if (rq->cfs.nr_running == 0) {
+        // A group back from idle starts level with the rest, not with
+        // credit saved up while it had nothing to run
+        if (rq->vruntime < fs->min_vruntime) rq->vruntime = fs->min_vruntime;
+        fs->runnable |= 1u << g;
+    }
+    cfs_enqueue(&rq->cfs, p);
+    return 0;
+}
+
+PCB *fair_pick_next(FairShare *fs, long now) {
+    int best = -1, skipped = 0;
+    for (unsigned mask = fs->runnable; mask; mask &= mask - 1) {
+        int g = __builtin_ctz(mask);
+        if (!fs->draining && over_quota(&fs->rq[g], &fair_groups[g], now)) {
+            skipped++;
+            continue;
+        }
+        if (best < 0 || fs->rq[g].vruntime < fs->rq[best].vruntime) best = g;
+    }
+    atomic_store(&fs->waiting_refill, skipped);
+    if (best < 0) return NULL;
+
+    FairRq *rq = &fs->rq[best];
+    if (rq->vruntime > fs->min_vruntime) fs->min_vruntime = rq->vruntime;
+    PCB *p = cfs_pick_next(&rq->cfs);
+    if (rq->cfs.nr_running == 0) fs->runnable &= ~(1u << best);
+    return p;
+}
+
+int fair_remove(FairShare *fs, PCB *p) {
+    int g = fair_group_of(p);
+    FairRq *rq = &fs->rq[g];
+    if (!p->rb_parent && rq->cfs.root != p) return 0;
+    cfs_remove(&rq->cfs, p);
+    if (rq->cfs.nr_running == 0) fs->runnable &= ~(1u << g);
+    return 1;
+}
+
+// The member's CFS slice, cut to what is left of the group's quota
+int fair_timeslice(FairShare *fs, const PCB *p, long now) {
+    int g = fair_group_of(p);
+    FairRq *rq = &fs->rq[g];
+    const FairGroup *grp = &fair_groups[g];
+    int slice = cfs_timeslice(&rq->cfs, p);
+    if (grp->quota > 0) {
+        refresh_period(rq, grp, now);
+        long left = grp->quota - rq->used;
+        if (left < slice) slice = left > 1 ? (int)left : 1;
+    }
+    return slice;
+}
+
+// Preempts a running member once the run not yet charged uses up the quota
+int fair_over_quota(FairShare *fs, const PCB *p, long now) {
+    int g = fair_group_of(p);
+    const FairGroup *grp = &fair_groups[g];
+    if (grp->quota <= 0) return 0;
+    FairRq *rq = &fs->rq[g];
+    refresh_period(rq, grp, now);
+    return rq->used + (p->cpu_time_used - p->exec_start) >= grp->quota;
+}
+
+// Exiting PCBs are never enqueued again, so their last run is charged here
+void fair_charge_exit(FairShare *fs, PCB *p, long now) {
+    charge(fs, fair_group_of(p), p->cpu_time_used - p->exec_start, now);
+    p->exec_start = p->cpu_time_used;
+}
+
+// Earliest tick at which a throttled runnable group gets its quota back
+long fair_next_refill(FairShare *fs, long now) {
+    long next = LONG_MAX;
+    for (unsigned mask = fs->runnable; mask; mask &= mask - 1) {
+        int g = __builtin_ctz(mask);
+        if (!over_quota(&fs->rq[g], &fair_groups[g], now)) continue;
+        // Enough whole periods to pay off the overrun
+        const FairGroup *grp = &fair_groups[g];
+        long periods = fs->rq[g].used / grp->quota;
+        long at = fs->rq[g].period_start + periods * grp->period;
+        if (at < next) next = at;
+    }
+    return next;
+}
+
+void fair_for_each(FairShare *fs, void (*fn)(PCB *, void *), void *ctx) {
+    for (int g = 0; g < FS_MAX_GROUPS; g++) cfs_for_each(&fs->rq[g].cfs, fn, ctx);
+}
+
+void print_fair_stats(FairShare *fs, long now) {
+    long total = 0;
+    for (int g = 0; g < fair_group_count; g++) total += fs->rq[g].ran;
+    printf("GROUP            WEIGHT   QUOTA/PERIOD  MEMBERS  RUNNABLE    RAN  SHARE%%  VRUNTIME  THROTTLED\n");
+    for (int g = 0; g < fair_group_count; g++) {
+        FairGroup *grp = &fair_groups[g];
+        FairRq *rq = &fs->rq[g];
+        char limits[24];
+        if (grp->quota > 0) snprintf(limits, sizeof(limits), "%d/%d", grp->quota, grp->period);
+        else snprintf(limits, sizeof(limits), "-");
+        if (grp->quota > 0) refresh_period(rq, grp, now);
+        printf("%-16s %6ld %14s %8d %9d %6ld %7.1f %9.2f %6ld%s\n", grp->name, grp->weight, limits,
+               grp->leader ? grp->leader->child_count : 0, rq->cfs.nr_running, rq->ran,
+               total ? 100.0 * rq->ran / total : 0.0, (double)rq->vruntime / CFS_VRUNTIME_SCALE,
+               rq->throttles, grp->quota > 0 && rq->used >= grp->quota ? " now" : "");
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef FAIRSHARE_H
+#define FAIRSHARE_H
+
+#include <stdatomic.h>
+#include "cfs.h"
+
+#define FS_MAX_GROUPS 32
+#define FS_NAME_LEN 16
+#define FS_DEFAULT_WEIGHT 1024
+#define FS_DEFAULT_GROUP 0          // PCBs under no group leader
+
+struct PCB;
+
+// A share group is the subtree under its leader PCB: members are the
+// leader's children (and their descendants). The weight divides the CPU
+// between groups; a quota caps the group at quota ticks in every period.
+typedef struct FairGroup {
+    char name[FS_NAME_LEN];
+    long weight;
+    int quota;                  // 0 = unlimited
+    int period;
+    struct PCB *leader;
+} FairGroup;
+
+// One group's share of a ready queue
+typedef struct FairRq {
+    CFS cfs;                    // its runnable members, fair by nice value
+    long vruntime;              // ticks run scaled by FS_DEFAULT_WEIGHT / weight
+    long period_start;
+    long used;                  // ticks charged in the current period
+    long ran;
+    long throttles;             // periods in which the quota ran out
+    int throttled;
+} FairRq;
+
+// Hierarchical fair share. The runnable group with the least virtual
+// runtime and quota left goes first, then CFS picks a member inside it, so
+// 100 jobs in one group get the same total share as 2 in another.
+typedef struct FairShare {
+    FairRq rq[FS_MAX_GROUPS];
+    unsigned runnable;          // bit g set while group g has queued PCBs
+    long min_vruntime;
+    atomic_int waiting_refill;  // runnable groups last skipped for quota
+    int draining;               // ignore quotas while the queue is emptied
+    int initialized;
+} FairShare;
+
+extern FairGroup fair_groups[FS_MAX_GROUPS];
+extern int fair_group_count;
+
+void fair_init(FairShare *fs, int target_latency, int min_granularity);
+int fair_group_create(const char *name, long weight, int quota, int period);
+int fair_group_find(const char *name);
+int fair_group_set(int id, long weight, int quota, int period);
+int fair_group_join(int id, struct PCB *p);
+int fair_group_of(const struct PCB *p);
+
+int fair_enqueue(FairShare *fs, struct PCB *p, long now);
+struct PCB *fair_pick_next(FairShare *fs, long now);
+int fair_remove(FairShare *fs, struct PCB *p);
+int fair_timeslice(FairShare *fs, const struct PCB *p, long now);
+int fair_over_quota(FairShare *fs, const struct PCB *p, long now);
+void fair_charge_exit(FairShare *fs, struct PCB *p, long now);
+long fair_next_refill(FairShare *fs, long now);
+void fair_for_each(FairShare *fs, void (*fn)(struct PCB *, void *), void *ctx);
+void print_fair_stats(FairShare *fs, long now);
+
+#endif
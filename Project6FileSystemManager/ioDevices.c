@@ -0,0 +1,293 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "advancedScheduler.h"
+#include "ioDevices.h"
+
+IoDevice io_devices[MAX_IO_DEVICES];
+int io_device_count = 0;
+
+static const char *sched_names[] = { "fifo", "deadline", "elevator" };
+static ObjPool *request_pool;
+
+static void io_device_done(Timer *timer, void *arg);
+
+void io_init() {
+    if (!request_pool) request_pool = pool_create("io-request", sizeof(IoRequest));
+    io_device_count = 0;
+    io_device_create("disk0", "hdd", IO_SCHED_ELEVATOR);
+}
+
+int io_sched_lookup(const char *name) {
+    for (int i = 0; i < 3; i++) {
+        if (strcmp(sched_names[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+IoDevice *io_device_create(const char *name, const char *type, IoSchedType sched) {
+    if (io_device_count >= MAX_IO_DEVICES) {
+        printf("Too many I/O devices\n");
+        return NULL;
+    }
+    if (io_device_find(name)) {
+        printf("I/O device '%s' already exists\n", name);
+        return NULL;
+    }
+    IoDevice *d = &io_devices[io_device_count];
+    memset(d, 0, sizeof(IoDevice));
+    if (strcmp(type, "hdd") == 0) {
+        d->latency_ms = 4;
+        d->seek_ms = 10;
+        d->tracks = 10000;
+        d->kb_per_ms = 100;
+        d->expire_ms = 500;
+    } else if (strcmp(type, "ssd") == 0) {
+        d->latency_ms = 0;
+        d->seek_ms = 0;
+        d->tracks = 1;
+        d->kb_per_ms = 500;
+        d->expire_ms = 100;
+    } else {
+        printf("Unknown device type '%s' (hdd or ssd)\n", type);
+        return NULL;
+    }
+    d->id = io_device_count++;
+    strncpy(d->name, name, IO_DEVICE_NAME_LEN - 1);
+    d->sched = sched;
+    d->direction = 1;
+    d->down.max_first = 1;
+    pthread_mutex_init(&d->lock, NULL);
+    timer_init(&d->timer, io_device_done, d);
+    d->stats_start = d->last_depth_change = timer_wheel_now(&timer_wheel);
+    return d;
+}
+
+IoDevice *io_device_find(const char *name) {
+    for (int i = 0; i < io_device_count; i++) {
+        if (strcmp(io_devices[i].name, name) == 0) return &io_devices[i];
+    }
+    return NULL;
+}
+
+// Heap helpers
+static int io_before(IoHeap *h, IoRequest *a, IoRequest *b) {
+    if (a->track != b->track) return h->max_first ? a->track > b->track : a->track < b->track;
+    return a->submit_ms < b->submit_ms;
+}
+
+static void io_heap_swap(IoHeap *h, int i, int j) {
+    IoRequest *tmp = h->items[i];
+    h->items[i] = h->items[j];
+    h->items[j] = tmp;
+    h->items[i]->heap_index = i;
+    h->items[j]->heap_index = j;
+}
+
+static void io_heap_sift_up(IoHeap *h, int i) {
+    while (i > 0 && io_before(h, h->items[i], h->items[(i - 1) / 2])) {
+        io_heap_swap(h, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void io_heap_sift_down(IoHeap *h, int i) {
+    while (1) {
+        int best = i, left = 2 * i + 1, right = left + 1;
+        if (left < h->count && io_before(h, h->items[left], h->items[best])) best = left;
+        if (right < h->count && io_before(h, h->items[right], h->items[best])) best = right;
+        if (best == i) break;
+        io_heap_swap(h, i, best);
+        i = best;
+    }
+}
+
+static int io_heap_push(IoHeap *h, IoRequest *r) {
+    if (h->count == h->capacity) {
+        int capacity = h->capacity ? h->capacity * 2 : 32;
+        IoRequest **items = realloc(h->items, capacity * sizeof(IoRequest *));
+        if (!items) return -1;
+        h->items = items;
+        h->capacity = capacity;
+    }
+    r->heap = h;
+    r->heap_index = h->count;
+    h->items[h->count] = r;
+    io_heap_sift_up(h, h->count++);
+    return 0;
+}
+
+static void io_heap_remove(IoRequest *r) {
+    IoHeap *h = r->heap;
+    if (!h) return;
+    int i = r->heap_index;
+    io_heap_swap(h, i, --h->count);
+    if (i < h->count) {
+        IoRequest *moved = h->items[i];
+        io_heap_sift_up(h, i);
+        io_heap_sift_down(h, moved->heap_index);
+    }
+    r->heap = NULL;
+}
+
+// Queue bookkeeping, all with d->lock held
+static void note_depth(IoDevice *d, long now) {
+    d->depth_area += (long)d->depth * (now - d->last_depth_change);
+    d->last_depth_change = now;
+}
+
+static void io_queue(IoDevice *d, IoRequest *r, long now) {
+    r->fifo_next = NULL;
+    r->fifo_prev = d->fifo_tail;
+    if (d->fifo_tail) d->fifo_tail->fifo_next = r;
+    else d->fifo_head = r;
+    d->fifo_tail = r;
+    r->heap = NULL;
+    if (d->sched != IO_SCHED_FIFO && io_heap_push(r->track >= d->head ? &d->up : &d->down, r) < 0) {
+        perror("io_queue");
+    }
+    note_depth(d, now);
+    if (++d->depth > d->max_depth) d->max_depth = d->depth;
+}
+
+static void io_unqueue(IoDevice *d, IoRequest *r, long now) {
+    if (r->fifo_prev) r->fifo_prev->fifo_next = r->fifo_next;
+    else d->fifo_head = r->fifo_next;
+    if (r->fifo_next) r->fifo_next->fifo_prev = r->fifo_prev;
+    else d->fifo_tail = r->fifo_prev;
+    io_heap_remove(r);
+    note_depth(d, now);
+    d->depth--;
+}
+
+// LOOK: keep sweeping in one direction while there is work that way
+static IoRequest *elevator_next(IoDevice *d) {
+    if (d->direction > 0 && d->up.count == 0) d->direction = -1;
+    else if (d->direction < 0 && d->down.count == 0) d->direction = 1;
+    IoHeap *h = d->direction > 0 ? &d->up : &d->down;
+    return h->count ? h->items[0] : NULL;
+}
+
+static IoRequest *io_pick(IoDevice *d, long now) {
+    switch (d->sched) {
+    case IO_SCHED_FIFO:
+        return d->fifo_head;
+    case IO_SCHED_DEADLINE:
+        if (d->fifo_head && d->fifo_head->deadline_ms <= now) {
+            d->expired++;
+            return d->fifo_head;
+        }
+        return elevator_next(d);
+    case IO_SCHED_ELEVATOR:
+        return elevator_next(d);
+    }
+    return NULL;
+}
+
+static void io_start_next(IoDevice *d, long now) {
+    IoRequest *r = io_pick(d, now);
+    d->active = r;
+    if (!r) return;
+    io_unqueue(d, r, now);
+
+    int distance = abs(r->track - d->head);
+    long service = d->latency_ms + (long)d->seek_ms * distance / d->tracks +
+                   (r->size_kb + d->kb_per_ms - 1) / d->kb_per_ms;
+    if (service < 1) service = 1;
+    d->head = r->track;
+    d->seek_tracks += distance;
+    d->wait_ms += now - r->submit_ms;
+    r->start_ms = now;
+    timer_arm(&timer_wheel, &d->timer, service);
+}
+
+// Completion: account, start the next request, then wake this one's PCB
+static void io_device_done(Timer *timer, void *arg) {
+    IoDevice *d = arg;
+    long now = timer_wheel_now(&timer_wheel);
+    pthread_mutex_lock(&d->lock);
+    IoRequest *r = d->active;
+    if (!r) {
+        pthread_mutex_unlock(&d->lock);
+        return;
+    }
+    d->busy_ms += now - r->start_ms;
+    d->completed++;
+    io_start_next(d, now);
+    pthread_mutex_unlock(&d->lock);
+
+    PCB *p = r->pcb;
+    pool_free(request_pool, r);
+    wake_from_io(p);
+}
+
+void io_submit(PCB *p, int track) {
+    IoDevice *d = &io_devices[p->io_device >= 0 && p->io_device < io_device_count ? p->io_device : 0];
+    IoRequest *r = pool_zalloc(request_pool);
+    if (!r) {
+        perror("io_submit");
+        wake_from_io(p);
+        return;
+    }
+    long now = timer_wheel_now(&timer_wheel);
+    r->pcb = p;
+    r->track = track % d->tracks;
+    r->size_kb = p->io_size_kb > 0 ? p->io_size_kb : IO_DEFAULT_SIZE_KB;
+    r->submit_ms = now;
+    r->deadline_ms = now + d->expire_ms;
+
+    pthread_mutex_lock(&d->lock);
+    io_queue(d, r, now);
+    if (!d->active) io_start_next(d, now);
+    pthread_mutex_unlock(&d->lock);
+}
+
+// Re-files everything queued under the new scheduler, in arrival order
+void io_device_set_sched(IoDevice *d, IoSchedType sched) {
+    long now = timer_wheel_now(&timer_wheel);
+    pthread_mutex_lock(&d->lock);
+    IoRequest *r = d->fifo_head;
+    d->fifo_head = d->fifo_tail = NULL;
+    d->up.count = d->down.count = 0;
+    d->depth = 0;
+    d->sched = sched;
+    while (r) {
+        IoRequest *next = r->fifo_next;
+        io_queue(d, r, now);
+        r = next;
+    }
+    pthread_mutex_unlock(&d->lock);
+}
+
+void io_stats_reset() {
+    long now = timer_wheel_now(&timer_wheel);
+    for (int i = 0; i < io_device_count; i++) {
+        IoDevice *d = &io_devices[i];
+        pthread_mutex_lock(&d->lock);
+        d->stats_start = d->last_depth_change = now;
+        d->depth_area = 0;
+        d->max_depth = d->depth;
+        d->completed = d->busy_ms = d->wait_ms = d->seek_tracks = d->expired = 0;
+        pthread_mutex_unlock(&d->lock);
+    }
+}
+
+void print_io_stats() {
+    long now = timer_wheel_now(&timer_wheel);
+    printf("DEVICE     SCHED     DONE   UTIL%%  AVG_DEPTH  MAX_DEPTH  AVG_WAIT_MS  AVG_SEEK  EXPIRED\n");
+    for (int i = 0; i < io_device_count; i++) {
+        IoDevice *d = &io_devices[i];
+        pthread_mutex_lock(&d->lock);
+        note_depth(d, now);
+        long elapsed = now - d->stats_start;
+        long busy = d->busy_ms + (d->active ? now - d->active->start_ms : 0);
+        printf("%-10s %-8s %6ld %7.1f %10.2f %10d %12.2f %9.1f %8ld\n",
+               d->name, sched_names[d->sched], d->completed,
+               elapsed > 0 ? 100.0 * busy / elapsed : 0.0,
+               elapsed > 0 ? (double)d->depth_area / elapsed : 0.0, d->max_depth,
+               d->completed ? (double)d->wait_ms / d->completed : 0.0,
+               d->completed ? (double)d->seek_tracks / d->completed : 0.0, d->expired);
+        pthread_mutex_unlock(&d->lock);
+    }
+}
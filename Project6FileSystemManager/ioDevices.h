@@ -0,0 +1,83 @@
+#ifndef IODEVICES_H
+#define IODEVICES_H
+
+#include <pthread.h>
+#include "timerWheel.h"
+
+#define MAX_IO_DEVICES 16
+#define IO_DEVICE_NAME_LEN 16
+#define IO_DEFAULT_SIZE_KB 64
+
+struct PCB;
+
+typedef enum { IO_SCHED_FIFO, IO_SCHED_DEADLINE, IO_SCHED_ELEVATOR } IoSchedType;
+
+typedef struct IoRequest {
+    struct PCB *pcb;
+    int track;
+    int size_kb;
+    long submit_ms;
+    long deadline_ms;               // deadline scheduler only
+    long start_ms;
+    struct IoRequest *fifo_prev, *fifo_next;
+    struct IoHeap *heap;            // elevator half the request sits in
+    int heap_index;
+} IoRequest;
+
+// Indexed heap of requests by track, min-first or max-first
+typedef struct IoHeap {
+    IoRequest **items;
+    int count;
+    int capacity;
+    int max_first;
+} IoHeap;
+
+// A simulated block device serving one request at a time. Service time is
+// latency + seek (proportional to track distance) + transfer. Every request
+// is on the arrival FIFO; the elevator and deadline schedulers also keep it
+// in one of two heaps: tracks at or past the head (swept upward, min first)
+// and tracks behind it (swept downward, max first). Deadline serves the FIFO
+// head instead once it is older than expire_ms.
+typedef struct IoDevice {
+    int id;
+    char name[IO_DEVICE_NAME_LEN];
+    IoSchedType sched;
+    int latency_ms;
+    int seek_ms;                    // full-stroke seek
+    int tracks;
+    int kb_per_ms;
+    int expire_ms;
+
+    pthread_mutex_t lock;
+    IoRequest *fifo_head, *fifo_tail;
+    IoHeap up, down;
+    IoRequest *active;
+    Timer timer;                    // completion of the active request
+    int head;
+    int direction;                  // 1 sweeping up, -1 down
+    int depth;                      // queued, not counting the active one
+
+    long stats_start;
+    long last_depth_change;
+    long depth_area;                // integral of depth over ms
+    int max_depth;
+    long completed;
+    long busy_ms;
+    long wait_ms;
+    long seek_tracks;
+    long expired;                   // deadline dispatches out of sweep order
+} IoDevice;
+
+extern IoDevice io_devices[MAX_IO_DEVICES];
+extern int io_device_count;
+
+void io_init();
+IoDevice *io_device_create(const char *name, const char *type, IoSchedType sched);
+IoDevice *io_device_find(const char *name);
+int io_sched_lookup(const char *name);
+void io_device_set_sched(IoDevice *d, IoSchedType sched);
+void io_submit(struct PCB *p, int track);
+void io_stats_reset();
+void print_io_stats();
+
+#endif
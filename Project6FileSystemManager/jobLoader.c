@@ -0,0 +1,556 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include "advancedScheduler.h"
+#include "jobLoader.h"
+#include "trace.h"
+
+static JobLoader *loaders[MAX_JOB_LOADERS];
+static pthread_mutex_t loaders_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *mem_pattern_names[] = { "none", "seq", "rand", "local" };
+
+// Mapping
+static int job_file_map(JobFile *f, size_t size) {
+    if (f->map) munmap((void *)f->map, f->size);
+    f->map = NULL;
+    f->size = 0;
+    if (size == 0) return 0;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, f->fd, 0);
+    if (map == MAP_FAILED) return -1;
+    madvise(map, size, MADV_SEQUENTIAL);
+    f->map = map;
+    f->size = size;
+    return 0;
+}
+
+int job_file_open(JobFile *f, const char *path, int follow) {
+    memset(f, 0, sizeof(JobFile));
+    strncpy(f->path, path, sizeof(f->path) - 1);
+    f->follow = follow;
+    f->fd = open(path, O_RDONLY);
+    if (f->fd < 0) return -1;
+    struct stat st;
+    if (follow ? job_file_refresh(f) < 0 : fstat(f->fd, &st) < 0 || job_file_map(f, st.st_size) < 0) {
+        int saved = errno;
+        job_file_close(f);
+        errno = saved;
+        return -1;
+    }
+    return 0;
+}
+
+// Follow mode: reads what was appended since the last call, keeping only
+// the unparsed tail of the buffer. A file that shrank below what was
+// already read was rotated, so it is read again from the start; one
+// truncated mid-read just comes up short. Returns 1 if there is new data,
+// 0 if not, -1 on error.
+int job_file_refresh(JobFile *f) {
+    struct stat st;
+    if (fstat(f->fd, &st) < 0) return -1;
+    size_t size = st.st_size, read_to = f->base + f->size;
+    if (size == read_to) return 0;
+    if (size < read_to) {
+        fprintf(stderr, "[Batch] %s was truncated, reading from the start\n", f->path);
+        f->base = f->size = f->pos = 0;
+        f->line = 0;
+        read_to = 0;
+    }
+    if (f->pos) memmove(f->buf, f->buf + f->pos, f->size - f->pos);
+    f->base += f->pos;
+    f->size -= f->pos;
+    f->pos = 0;
+    size_t want = f->size + (size - read_to);
+    if (want > f->buf_capacity) {
+        char *buf = realloc(f->buf, want);
+        if (!buf) return -1;
+        f->buf = buf;
+        f->buf_capacity = want;
+    }
+    f->map = f->buf;
+    size_t got = 0;
+    while (read_to + got < size) {
+        ssize_t n = pread(f->fd, f->buf + f->size + got, size - read_to - got, read_to + got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        if (n == 0) break;
+        got += n;
+    }
+    f->size += got;
+    return got > 0;
+}
+
+void job_file_close(JobFile *f) {
+    if (f->buf) {
+        free(f->buf);
+        f->buf = NULL;
+        f->map = NULL;
+        f->size = 0;
+    } else {
+        job_file_map(f, 0);
+    }
+    if (f->fd >= 0) close(f->fd);
+    f->fd = -1;
+}
+
+// Parser: works on [p, end) of the mapping, nothing is copied or terminated
+static void job_warn(JobFile *f, const char *fmt, ...) {
+    if (f->warnings++ >= JOB_WARN_LIMIT) return;
+    va_list ap;
+    va_start(ap, fmt);
+    fprintf(stderr, "[Batch] %s:%ld: ", f->path, f->line);
+    vfprintf(stderr, fmt, ap);
+    fputc('\n', stderr);
+    va_end(ap);
+}
+
+static int is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char *skip_blanks(const char *p, const char *end) {
+    while (p < end && is_blank(*p)) p++;
+    return p;
+}
+
+static int parse_long(const char **pp, const char *end, long *out) {
+    const char *p = *pp;
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+    if (p >= end || *p < '0' || *p > '9') return 0;
+    long value = 0;
+    while (p < end && *p >= '0' && *p <= '9') value = value * 10 + (*p++ - '0');
+    *out = negative ? -value : value;
+    *pp = p;
+    return 1;
+}
+
+// Decimal, or hex with a 0x prefix
+static int parse_mask(const char **pp, const char *end, unsigned long *out) {
+    const char *p = *pp;
+    if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+        unsigned long value = 0;
+        int digits = 0;
+        for (p += 2; p < end; p++, digits++) {
+            int d = *p >= '0' && *p <= '9' ? *p - '0' :
+                    (*p | 0x20) >= 'a' && (*p | 0x20) <= 'f' ? (*p | 0x20) - 'a' + 10 : -1;
+            if (d < 0) break;
+            value = value << 4 | d;
+        }
+        if (!digits) return 0;
+        *out = value;
+        *pp = p;
+        return 1;
+    }
+    long value;
+    if (!parse_long(pp, end, &value) || value < 0) return 0;
+    *out = value;
+    return 1;
+}
+
+static int key_is(const char *key, size_t len, const char *name) {
+    return strlen(name) == len && memcmp(key, name, len) == 0;
+}
+
+// Whole-token integer value
+static int value_long(const char *v, const char *end, long *out) {
+    return parse_long(&v, end, out) && v == end;
+}
+
+static int parse_bursts(const char *v, const char *end, JobRecord *r) {
+    r->burst_count = 0;
+    while (v < end) {
+        long burst;
+        if (!parse_long(&v, end, &burst) || burst <= 0 || r->burst_count == JOB_MAX_BURSTS) return 0;
+        r->bursts[r->burst_count++] = burst;
+        if (v < end && *v++ != ',') return 0;
+    }
+    return r->burst_count > 0;
+}
+
+static int parse_claims(const char *v, const char *end, JobRecord *r) {
+    r->claim_count = 0;
+    while (v < end) {
+        long units;
+        if (!parse_long(&v, end, &units) || units < 0 || r->claim_count == BANK_MAX_RESOURCES) return 0;
+        r->claims[r->claim_count++] = units;
+        if (v < end && *v++ != ',') return 0;
+    }
+    return r->claim_count > 0;
+}
+
+// mem=<pages>[:seq|rand|local]
+static int parse_mem(const char *v, const char *end, JobRecord *r) {
+    long pages;
+    if (!parse_long(&v, end, &pages) || pages < 0) return 0;
+    r->mem_pages = pages;
+    r->mem_pattern = pages ? MEM_SEQUENTIAL : MEM_NONE;
+    if (v == end) return 1;
+    if (*v++ != ':') return 0;
+    for (int i = MEM_SEQUENTIAL; i <= MEM_LOCALITY; i++) {
+        if (key_is(v, end - v, mem_pattern_names[i])) {
+            r->mem_pattern = i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int apply_field(JobFile *f, JobRecord *r, const char *key, size_t key_len, const char *v, const char *end) {
+    long value;
+    if (key_is(key, key_len, "cpus")) {
+        unsigned long mask;
+        if (!parse_mask(&v, end, &mask) || v != end) return 0;
+        if (mask) r->affinity = mask;
+    } else if (key_is(key, key_len, "arrival")) {
+        if (!value_long(v, end, &value)) return 0;
+        r->arrival = value;
+    } else if (key_is(key, key_len, "deadline")) {
+        if (!value_long(v, end, &value)) return 0;
+        r->rel_deadline = value;
+    } else if (key_is(key, key_len, "period")) {
+        if (!value_long(v, end, &value)) return 0;
+        r->period = value;
+    } else if (key_is(key, key_len, "count")) {
+        if (!value_long(v, end, &value)) return 0;
+        r->instances = value;
+    } else if (key_is(key, key_len, "tickets")) {
+        if (!value_long(v, end, &value)) return 0;
+        if (value > 0) r->tickets = value;
+    } else if (key_is(key, key_len, "io")) {
+        char name[IO_DEVICE_NAME_LEN];
+        size_t len = end - v;
+        if (len >= sizeof(name)) len = sizeof(name) - 1;
+        memcpy(name, v, len);
+        name[len] = '\0';
+        IoDevice *d = io_device_find(name);
+        if (d) r->io_device = d->id;
+        else job_warn(f, "unknown I/O device '%s'", name);
+    } else if (key_is(key, key_len, "iosize")) {
+        if (!value_long(v, end, &value)) return 0;
+        r->io_size_kb = value;
+    } else if (key_is(key, key_len, "iochance")) {
+        if (!value_long(v, end, &value) || value < 0) return 0;
+        r->io_chance = value ? value : -1;
+    } else if (key_is(key, key_len, "group")) {
+        char name[FS_NAME_LEN];
+        size_t len = end - v;
+        if (len >= sizeof(name)) len = sizeof(name) - 1;
+        memcpy(name, v, len);
+        name[len] = '\0';
+        int id = fair_group_find(name);
+        if (id >= 0) r->group = id;
+        else job_warn(f, "unknown group '%s'", name);
+    } else if (key_is(key, key_len, "burst")) {
+        return parse_bursts(v, end, r);
+    } else if (key_is(key, key_len, "mem")) {
+        return parse_mem(v, end, r);
+    } else if (key_is(key, key_len, "claim")) {
+        return parse_claims(v, end, r);
+    } else {
+        job_warn(f, "ignoring unknown field '%.*s'", (int)key_len, key);
+    }
+    return 1;
+}
+
+static RecordType parse_job(JobFile *f, const char *p, const char *end, JobRecord *r) {
+    long priority, time_limit;
+    int ok = parse_long(&p, end, &priority);
+    p = skip_blanks(p, end);
+    if (!ok || !parse_long(&p, end, &time_limit)) {
+        f->bad_lines++;
+        job_warn(f, "expected '<priority> <time_limit>'");
+        return REC_SKIP;
+    }
+    r->priority = priority;
+    r->time_limit = time_limit;
+    r->arrival = 0;
+    r->affinity = 0;
+    r->rel_deadline = r->period = r->instances = r->tickets = 0;
+    r->io_device = r->io_size_kb = r->io_chance = 0;
+    r->burst_count = 0;
+    r->mem_pages = 0;
+    r->mem_pattern = MEM_NONE;
+    r->claim_count = 0;
+    r->group = FS_DEFAULT_GROUP;
+
+    while ((p = skip_blanks(p, end)) < end) {
+        const char *token = p;
+        while (p < end && !is_blank(*p)) p++;
+        const char *eq = memchr(token, '=', p - token);
+        if (!eq) continue;
+        if (!apply_field(f, r, token, eq - token, eq + 1, p)) {
+            job_warn(f, "bad value in '%.*s'", (int)(p - token), token);
+        }
+    }
+
+    // A burst pattern is the job's whole CPU demand
+    if (r->burst_count > 0) {
+        r->time_limit = 0;
+        for (int i = 0; i < r->burst_count; i++) r->time_limit += r->bursts[i];
+    }
+    if (r->time_limit <= 0) {
+        f->bad_lines++;
+        job_warn(f, "time limit must be positive");
+        return REC_SKIP;
+    }
+    return REC_JOB;
+}
+
+static RecordType parse_line(JobFile *f, const char *p, const char *end, JobRecord *r) {
+    p = skip_blanks(p, end);
+    if (p == end || *p == '#') return REC_SKIP;
+
+    if (end - p >= 5 && memcmp(p, "SLEEP", 5) == 0) {
+        p = skip_blanks(p + 5, end);
+        if (!parse_long(&p, end, &r->sleep) || r->sleep < 0) {
+            f->bad_lines++;
+            job_warn(f, "expected 'SLEEP <seconds>'");
+            return REC_SKIP;
+        }
+        return REC_SLEEP;
+    }
+    if (end - p >= 6 && memcmp(p, "POLICY", 6) == 0) {
+        p = skip_blanks(p + 6, end);
+        size_t len = end - p;
+        if (len >= sizeof(r->policy)) len = sizeof(r->policy) - 1;
+        memcpy(r->policy, p, len);
+        r->policy[len] = '\0';
+        return REC_POLICY;
+    }
+    return parse_job(f, p, end, r);
+}
+
+// Next record, or REC_END when the mapping is used up. Following a file,
+// a last line without its newline is left for the next refresh.
+RecordType job_file_next(JobFile *f, JobRecord *r) {
+    if (f->pos >= f->size) return REC_END;
+    const char *start = f->map + f->pos, *end = f->map + f->size;
+    const char *eol = memchr(start, '\n', end - start);
+    if (!eol) {
+        if (f->follow) return REC_END;
+        eol = end;
+    }
+    f->pos = eol - f->map + (eol < end);
+    f->line++;
+    return parse_line(f, start, eol, r);
+}
+
+// The burst pattern becomes an I/O script: the PCB blocks after each burst
+// but the last, for however long its device or engine takes. pid 0 takes
+// the next shell pid.
+PCB *job_record_to_pcb(const JobRecord *r, int pid) {
+    PCB *p = pid ? pcb_create(pid, r->priority, r->time_limit) : sched_create_process(r->priority, r->time_limit);
+    if (!p) return NULL;
+    if (r->affinity) p->affinity = r->affinity;
+    p->rel_deadline = r->rel_deadline;
+    p->period = r->period;
+    p->instances = r->instances;
+    if (r->tickets > 0) p->tickets = r->tickets;
+    p->io_device = r->io_device;
+    p->io_size_kb = r->io_size_kb;
+    p->io_chance = r->io_chance;
+    p->mem_pages = r->mem_pages;
+    p->mem_pattern = r->mem_pattern;
+    if (r->claim_count > 0) {
+        p->claim = malloc(r->claim_count * sizeof(int));
+        if (!p->claim) {
+            perror("job_record_to_pcb");
+            pcb_free(p);
+            return NULL;
+        }
+        memcpy(p->claim, r->claims, r->claim_count * sizeof(int));
+        p->claim_count = r->claim_count;
+    }
+    if (fair_group_join(r->group, p) < 0) perror("job_record_to_pcb");
+
+    int points = r->burst_count - 1;
+    if (points > 0) {
+        TraceScript *s = malloc(sizeof(TraceScript) + points * (sizeof(long) + sizeof(int)));
+        if (!s) {
+            perror("job_record_to_pcb");
+            pcb_free(p);
+            return NULL;
+        }
+        s->count = points;
+        s->next = 0;
+        s->latency = (long *)(s + 1);
+        s->at_used = (int *)(s->latency + points);
+        int used = 0;
+        for (int i = 0; i < points; i++) {
+            used += r->bursts[i];
+            s->at_used[i] = used;
+            s->latency[i] = 0;
+        }
+        p->script = s;
+        p->script_owned = 1;
+    }
+    return p;
+}
+
+// Background loader
+static void loader_flush(JobLoader *l, PCB **batch, int *n) {
+    if (*n == 0) return;
+    arrive_batch(batch, *n);
+    atomic_fetch_add(&l->bulk_inserts, 1);
+    *n = 0;
+}
+
+// Sleeps in short steps so a stop request is seen promptly
+static void loader_sleep(JobLoader *l, long ms) {
+    while (ms > 0 && !atomic_load(&l->stop)) {
+        long step = ms < 100 ? ms : 100;
+        usleep(step * 1000);
+        ms -= step;
+    }
+}
+
+// Jobs due now are gathered and go onto the ready queue in bulk. Later
+// arrivals go on the timer wheel, but parsing never runs more than
+// JOB_LOOKAHEAD_TICKS ahead of the clock, so a long log only ever has a
+// short window of future jobs in memory.
+static void *job_loader_thread(void *arg) {
+    JobLoader *l = arg;
+    JobRecord r;
+    PCB *batch[JOB_BULK_BATCH];
+    int n = 0;
+    long start = current_tick(), delay = 0;
+
+    while (!atomic_load(&l->stop)) {
+        RecordType type = job_file_next(&l->file, &r);
+        if (type == REC_END) {
+            loader_flush(l, batch, &n);
+            if (!l->file.follow) break;
+            int grew = job_file_refresh(&l->file);
+            if (grew < 0) {
+                perror("[Batch] Follow error");
+                break;
+            }
+            if (grew == 0) loader_sleep(l, JOB_FOLLOW_POLL_MS);
+            continue;
+        }
+        if (type == REC_SLEEP) {
+            printf("[Batch] Delaying later processes by %ld seconds\n", r.sleep);
+            delay += r.sleep * 1000 / SCHED_TICK_MS;
+            continue;
+        }
+        if (type == REC_POLICY) {
+            loader_flush(l, batch, &n);
+            apply_batch_policy(&ready_queue, r.policy);
+            continue;
+        }
+        if (type != REC_JOB) continue;
+
+        PCB *p = job_record_to_pcb(&r, 0);
+        if (!p) continue;
+        p->arrival_time = start + delay + r.arrival;
+        atomic_fetch_add(&l->loaded, 1);
+        long ahead = p->arrival_time - current_tick();
+        if (ahead > 0) {
+            schedule_arrival(p);
+        } else {
+            batch[n++] = p;
+            if (n == JOB_BULK_BATCH) loader_flush(l, batch, &n);
+        }
+        if (ahead > JOB_LOOKAHEAD_TICKS) {
+            loader_flush(l, batch, &n);
+            loader_sleep(l, (ahead - JOB_LOOKAHEAD_TICKS) * SCHED_TICK_MS);
+        }
+    }
+    loader_flush(l, batch, &n);
+
+    l->end_ms = timer_wheel_now(&timer_wheel);
+    double seconds = (l->end_ms - l->start_ms) / 1000.0;
+    long loaded = atomic_load(&l->loaded);
+    printf("[Batch] %s: loaded %ld jobs in %.3f s (%.0f jobs/s)", l->file.path, loaded, seconds,
+           seconds > 0 ? loaded / seconds : 0.0);
+    if (l->file.bad_lines) printf(", skipped %ld bad lines", l->file.bad_lines);
+    printf("\n");
+    job_file_close(&l->file);
+    atomic_store(&l->running, 0);
+    return NULL;
+}
+
+int job_loader_start(const char *path, int follow) {
+    pthread_mutex_lock(&loaders_lock);
+    int slot = -1;
+    for (int i = 0; i < MAX_JOB_LOADERS && slot < 0; i++) {
+        if (!loaders[i]) slot = i;
+        else if (!atomic_load(&loaders[i]->running)) {
+            pthread_join(loaders[i]->thread, NULL);
+            free(loaders[i]);
+            loaders[i] = NULL;
+            slot = i;
+        }
+    }
+    if (slot < 0) {
+        pthread_mutex_unlock(&loaders_lock);
+        printf("Too many job loaders running (max %d)\n", MAX_JOB_LOADERS);
+        return -1;
+    }
+
+    JobLoader *l = calloc(1, sizeof(JobLoader));
+    if (!l) {
+        pthread_mutex_unlock(&loaders_lock);
+        perror("job_loader_start");
+        return -1;
+    }
+    if (job_file_open(&l->file, path, follow) < 0) {
+        pthread_mutex_unlock(&loaders_lock);
+        perror("Batch file error");
+        free(l);
+        return -1;
+    }
+    l->id = slot + 1;
+    l->start_ms = timer_wheel_now(&timer_wheel);
+    atomic_init(&l->running, 1);
+    if (pthread_create(&l->thread, NULL, job_loader_thread, l) != 0) {
+        pthread_mutex_unlock(&loaders_lock);
+        perror("job_loader_start");
+        job_file_close(&l->file);
+        free(l);
+        return -1;
+    }
+    loaders[slot] = l;
+    pthread_mutex_unlock(&loaders_lock);
+    printf("[Batch] Loader %d reading %s%s\n", l->id, path, follow ? " (following)" : "");
+    return l->id;
+}
+
+int job_loader_stop(int id) {
+    pthread_mutex_lock(&loaders_lock);
+    JobLoader *l = id >= 1 && id <= MAX_JOB_LOADERS ? loaders[id - 1] : NULL;
+    if (!l) {
+        pthread_mutex_unlock(&loaders_lock);
+        printf("No job loader %d\n", id);
+        return -1;
+    }
+    loaders[id - 1] = NULL;
+    pthread_mutex_unlock(&loaders_lock);
+    atomic_store(&l->stop, 1);
+    pthread_join(l->thread, NULL);
+    free(l);
+    return 0;
+}
+
+void print_job_loaders() {
+    pthread_mutex_lock(&loaders_lock);
+    printf("ID  STATE     LOADED  BULK_INSERTS  LINE  BAD  FILE\n");
+    for (int i = 0; i < MAX_JOB_LOADERS; i++) {
+        JobLoader *l = loaders[i];
+        if (!l) continue;
+        int running = atomic_load(&l->running);
+        printf("%2d  %-8s %7ld %13ld %5ld %4ld  %s\n", l->id,
+               running ? (l->file.follow ? "follow" : "loading") : "done",
+               atomic_load(&l->loaded), atomic_load(&l->bulk_inserts),
+               l->file.line, l->file.bad_lines, l->file.path);
+    }
+    pthread_mutex_unlock(&loaders_lock);
+}
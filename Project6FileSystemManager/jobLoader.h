@@ -0,0 +1,89 @@
+#ifndef JOBLOADER_H
+#define JOBLOADER_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include "advancedScheduler.h"
+#include "banker.h"
+
+#define JOB_MAX_BURSTS 64
+#define JOB_BULK_BATCH 256          // PCBs per ready queue lock round trip
+#define JOB_LOOKAHEAD_TICKS 2       // a streaming loader parses this far ahead of the clock
+#define JOB_FOLLOW_POLL_MS 200
+#define JOB_WARN_LIMIT 10           // per file, then warnings are only counted
+#define MAX_JOB_LOADERS 8
+
+typedef enum { REC_JOB, REC_SLEEP, REC_POLICY, REC_SKIP, REC_END } RecordType;
+
+// One parsed line of a job file:
+//   <priority> <time_limit> [key=value ...]
+//   SLEEP <seconds>
+//   POLICY <name> [slice]
+typedef struct {
+    int priority;
+    int time_limit;
+    long arrival;               // ticks after the file's current SLEEP offset
+    unsigned long affinity;
+    int rel_deadline;
+    int period;
+    int instances;
+    int tickets;
+    int io_device;
+    int io_size_kb;
+    int io_chance;              // 0 engine default, -1 never
+    int bursts[JOB_MAX_BURSTS]; // burst=cpu,cpu,...: blocks for I/O between them
+    int burst_count;
+    int mem_pages;
+    MemPattern mem_pattern;
+    int group;                  // fair share group, see fairShare.h
+    int claims[BANK_MAX_RESOURCES]; // claim=n0,n1,...: banker's max claim per resource
+    int claim_count;
+    long sleep;                 // REC_SLEEP, in seconds
+    char policy[64];            // REC_POLICY, the rest of the line
+} JobRecord;
+
+// A job file mapped read-only and parsed in place. A followed file can be
+// truncated under a mapping, which would raise SIGBUS, so in follow mode it
+// is read with pread() into buf instead: map then points at buf, which
+// holds only the bytes from file offset base on, and job_file_refresh()
+// appends what was written since. Only complete lines are parsed.
+typedef struct {
+    int fd;
+    char path[256];
+    const char *map;
+    size_t size;
+    size_t pos;
+    char *buf;                  // follow mode only
+    size_t buf_capacity;
+    size_t base;
+    long line;
+    int follow;
+    long bad_lines;
+    long warnings;
+} JobFile;
+
+int job_file_open(JobFile *f, const char *path, int follow);
+RecordType job_file_next(JobFile *f, JobRecord *r);
+int job_file_refresh(JobFile *f);
+void job_file_close(JobFile *f);
+PCB *job_record_to_pcb(const JobRecord *r, int pid);
+
+// Background loader feeding the live scheduler
+typedef struct {
+    int id;
+    JobFile file;
+    pthread_t thread;
+    atomic_int stop;
+    atomic_int running;
+    atomic_long loaded;
+    atomic_long bulk_inserts;
+    long start_ms;
+    long end_ms;
+} JobLoader;
+
+int job_loader_start(const char *path, int follow);
+int job_loader_stop(int id);
+void print_job_loaders();
+
+#endif
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <string.h>
+#include "memGroup.h"
+
+MemGroup mem_groups[MAX_MEM_GROUPS];
+int mem_group_count = 0;
+MemGroup *root_mem_group = NULL;
+
+void mem_group_init() {
+    mem_group_count = 0;
+    root_mem_group = NULL;
+    root_mem_group = mem_group_create("root", 0, 0, NULL);
+}
+
+MemGroup *mem_group_create(const char *name, int hard_limit, int soft_limit, MemGroup *parent) {
+    if (mem_group_count >= MAX_MEM_GROUPS) {
+        printf("Too many memory groups\n");
+        return NULL;
+    }
+    if (mem_group_find(name)) {
+        printf("Memory group '%s' already exists\n", name);
+        return NULL;
+    }
+    if (hard_limit < 0 || soft_limit < 0 || (hard_limit && soft_limit > hard_limit)) {
+        printf("Invalid limits: hard %d, soft %d\n", hard_limit, soft_limit);
+        return NULL;
+    }
+    MemGroup *group = &mem_groups[mem_group_count];
+    memset(group, 0, sizeof(MemGroup));
+    group->id = mem_group_count++;
+    strncpy(group->name, name, MEM_GROUP_NAME_LEN - 1);
+    group->parent = parent ? parent : root_mem_group;
+    group->hard_limit = hard_limit;
+    group->soft_limit = soft_limit;
+    return group;
+}
+
+MemGroup *mem_group_find(const char *name) {
+    for (int i = 0; i < mem_group_count; i++) {
+        if (strcmp(mem_groups[i].name, name) == 0) return &mem_groups[i];
+    }
+    return NULL;
+}
+
+int mem_group_is_ancestor(MemGroup *ancestor, MemGroup *group) {
+    for (; group; group = group->parent) {
+        if (group == ancestor) return 1;
+    }
+    return 0;
+}
+
+// Returns the outermost group in the chain that has no room for one more frame
+MemGroup *mem_group_over_hard_limit(MemGroup *group) {
+    MemGroup *limited = NULL;
+    for (; group; group = group->parent) {
+        if (group->hard_limit && group->usage >= group->hard_limit) limited = group;
+    }
+    return limited;
+}
+
+int mem_group_over_soft_limit(MemGroup *group) {
+    for (; group; group = group->parent) {
+        if (group->soft_limit && group->usage > group->soft_limit) return 1;
+    }
+    return 0;
+}
+
+void mem_group_charge(MemGroup *group, int frames) {
+    for (; group; group = group->parent) group->usage += frames;
+}
+
+void mem_group_record_access(MemGroup *group, int tlb_hit, int fault) {
+    for (; group; group = group->parent) {
+        group->accesses++;
+        group->tlb_hits += tlb_hit;
+        group->faults += fault;
+    }
+}
+
+void mem_group_record_eviction(MemGroup *victim, int self_reclaim) {
+    for (; victim; victim = victim->parent) {
+        victim->evictions++;
+        victim->self_reclaims += self_reclaim;
+    }
+}
+
+// Copies the group tree with its limits into dst, which holds
+// MAX_MEM_GROUPS, with usage and statistics cleared. Returns the count;
+// dst[0] is the copy of the root.
+int mem_group_copy_tree(MemGroup *dst) {
+    for (int i = 0; i < mem_group_count; i++) {
+        MemGroup *g = &mem_groups[i];
+        dst[i] = (MemGroup){.id = i, .hard_limit = g->hard_limit, .soft_limit = g->soft_limit};
+        memcpy(dst[i].name, g->name, MEM_GROUP_NAME_LEN);
+        dst[i].parent = g->parent ? &dst[g->parent->id] : NULL;
+    }
+    return mem_group_count;
+}
+
+void print_mem_groups() {
+    printf("\nMemory Groups:\n");
+    printf("%-12s %-12s %5s %5s %5s %8s %6s %8s %9s %8s\n",
+           "NAME", "PARENT", "USED", "SOFT", "HARD", "ACCESSES", "FAULTS", "HIT_RATE", "EVICTIONS", "RECLAIMS");
+    for (int i = 0; i < mem_group_count; i++) {
+        MemGroup *g = &mem_groups[i];
+        double hit_rate = g->accesses ? 100.0 * (g->accesses - g->faults) / g->accesses : 0.0;
+        printf("%-12s %-12s %5d %5d %5d %8ld %6ld %7.1f%% %9ld %8ld\n",
+               g->name, g->parent ? g->parent->name : "-", g->usage, g->soft_limit, g->hard_limit,
+               g->accesses, g->faults, hit_rate, g->evictions, g->self_reclaims);
+    }
+    printf("\n");
+}
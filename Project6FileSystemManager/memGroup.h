@@ -0,0 +1,41 @@
+#ifndef MEMGROUP_H
+#define MEMGROUP_H
+
+#define MAX_MEM_GROUPS 32
+#define MEM_GROUP_NAME_LEN 32
+
+// Hierarchical frame accounting in the spirit of memory cgroups. Usage and
+// statistics are charged to a group and every ancestor, so a parent sees the
+// total of its subtree. A limit of 0 means unlimited.
+typedef struct MemGroup {
+    int id;
+    char name[MEM_GROUP_NAME_LEN];
+    struct MemGroup *parent;
+    int hard_limit;     // frames the subtree may never exceed
+    int soft_limit;     // frames above which the subtree is reclaimed first
+    int usage;          // frames currently charged to the subtree
+
+    long accesses;
+    long tlb_hits;
+    long faults;
+    long evictions;     // frames taken away from this subtree
+    long self_reclaims; // evictions caused by this subtree's own limit
+} MemGroup;
+
+extern MemGroup mem_groups[MAX_MEM_GROUPS];
+extern int mem_group_count;
+extern MemGroup *root_mem_group;
+
+void mem_group_init();
+MemGroup *mem_group_create(const char *name, int hard_limit, int soft_limit, MemGroup *parent);
+MemGroup *mem_group_find(const char *name);
+int mem_group_is_ancestor(MemGroup *ancestor, MemGroup *group);
+MemGroup *mem_group_over_hard_limit(MemGroup *group);
+int mem_group_over_soft_limit(MemGroup *group);
+void mem_group_charge(MemGroup *group, int frames);
+void mem_group_record_access(MemGroup *group, int tlb_hit, int fault);
+void mem_group_record_eviction(MemGroup *victim, int self_reclaim);
+int mem_group_copy_tree(MemGroup *dst);
+void print_mem_groups();
+
+#endif
@@ -0,0 +1,235 @@
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "advancedScheduler.h"
+#include "metrics.h"
+
+SchedMetrics sched_metrics;
+
+static const char *metric_names[] = { "turnaround", "waiting", "response", "run", "io" };
+
+// Histograms
+static int hist_index(long value) {
+    if (value < 0) value = 0;
+    if (value < HIST_LINEAR) return (int)value;
+    int msb = 63 - __builtin_clzl((unsigned long)value);
+    if (msb > HIST_MAX_BITS) return HIST_BUCKETS - 1;
+    int shift = msb - HIST_SUB_BITS;
+    int sub = (int)(value >> shift) - (1 << HIST_SUB_BITS);
+    return HIST_LINEAR + (msb - HIST_SUB_BITS - 1) * (1 << HIST_SUB_BITS) + sub;
+}
+
+// Midpoint of the bucket's range
+static long hist_value(int index) {
+    if (index < HIST_LINEAR) return index;
+    int k = index - HIST_LINEAR;
+    int shift = k / (1 << HIST_SUB_BITS) + 1;
+    long low = (long)((1 << HIST_SUB_BITS) + k % (1 << HIST_SUB_BITS)) << shift;
+    return low + ((1L << shift) - 1) / 2;
+}
+
+void hist_record(Histogram *h, long value) {
+    if (value < 0) value = 0;
+    atomic_fetch_add_explicit(&h->counts[hist_index(value)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->total, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum, value, memory_order_relaxed);
+    long max = atomic_load_explicit(&h->max, memory_order_relaxed);
+    while (value > max && !atomic_compare_exchange_weak_explicit(&h->max, &max, value,
+                                                                 memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+long hist_percentile(Histogram *h, double percent) {
+    long total = atomic_load_explicit(&h->total, memory_order_relaxed);
+    if (total == 0) return 0;
+    long target = (long)(percent / 100.0 * total + 0.999999);
+    if (target < 1) target = 1;
+    long seen = 0;
+    long max = atomic_load_explicit(&h->max, memory_order_relaxed);
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += atomic_load_explicit(&h->counts[i], memory_order_relaxed);
+        if (seen >= target) {
+            long value = hist_value(i);
+            return value < max ? value : max;
+        }
+    }
+    return max;
+}
+
+static double hist_mean(Histogram *h) {
+    long total = atomic_load_explicit(&h->total, memory_order_relaxed);
+    return total ? (double)atomic_load_explicit(&h->sum, memory_order_relaxed) / total : 0.0;
+}
+
+// Concurrent recorders may lose a few samples across a reset
+void metrics_reset() {
+    SchedMetrics *m = &sched_metrics;
+    for (int k = 0; k < METRIC_COUNT; k++) {
+        Histogram *h = &m->hist[k];
+        for (int i = 0; i < HIST_BUCKETS; i++) atomic_store_explicit(&h->counts[i], 0, memory_order_relaxed);
+        atomic_store(&h->total, 0);
+        atomic_store(&h->sum, 0);
+        atomic_store(&h->max, 0);
+    }
+    for (int i = 0; i < MAX_CPUS; i++) atomic_store(&m->cpu_busy_ms[i], 0);
+    atomic_store(&m->completed, 0);
+    atomic_store(&m->transitions, 0);
+    // Each slot is emptied the way a writer fills it. seq 0 matches no
+    // ticket, so a reader skips the slot. The cursor goes back last so that
+    // new completions land in slots already emptied.
+    for (int i = 0; i < METRICS_LOG_SIZE; i++) {
+        CompletionRecord *r = &m->log[i];
+        atomic_store_explicit(&r->seq, 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        r->pid = r->priority = r->transitions = 0;
+        r->arrival = r->first_run = r->completion = 0;
+        memset(r->state_ms, 0, sizeof(r->state_ms));
+        atomic_store_explicit(&r->seq, 0, memory_order_release);
+    }
+    atomic_store(&m->log_next, 0);
+    atomic_store(&m->start_ms, timer_wheel_now(&timer_wheel));
+}
+
+// PCB timestamps
+void metrics_arrive(PCB *p) {
+    long now = timer_wheel_now(&timer_wheel);
+    p->t_arrival = now;
+    p->t_first_run = -1;
+    p->t_last_change = now;
+    p->transitions = 0;
+    memset(p->state_ms, 0, sizeof(p->state_ms));
+}
+
+// Sets p->state, charging the time since the last change to the old state
+// and, for RUNNING, to the CPU it ran on
+void metrics_transition(PCB *p, ProcessState to) {
+    long now = timer_wheel_now(&timer_wheel);
+    long spent = now - p->t_last_change;
+    p->state_ms[p->state] += spent;
+    if (p->state == RUNNING && p->last_cpu >= 0 && p->last_cpu < MAX_CPUS) {
+        atomic_fetch_add_explicit(&sched_metrics.cpu_busy_ms[p->last_cpu], spent, memory_order_relaxed);
+    }
+    if (to == RUNNING && p->t_first_run < 0) p->t_first_run = now;
+    p->t_last_change = now;
+    p->transitions++;
+    p->state = to;
+    atomic_fetch_add_explicit(&sched_metrics.transitions, 1, memory_order_relaxed);
+}
+
+// Call after the transition to TERMINATED
+void metrics_complete(PCB *p) {
+    SchedMetrics *m = &sched_metrics;
+    long now = p->t_last_change;
+    hist_record(&m->hist[METRIC_TURNAROUND], now - p->t_arrival);
+    hist_record(&m->hist[METRIC_WAITING], p->state_ms[READY]);
+    hist_record(&m->hist[METRIC_RESPONSE], (p->t_first_run >= 0 ? p->t_first_run : now) - p->t_arrival);
+    hist_record(&m->hist[METRIC_RUN], p->state_ms[RUNNING]);
+    hist_record(&m->hist[METRIC_IO], p->state_ms[WAITING]);
+    atomic_fetch_add_explicit(&m->completed, 1, memory_order_relaxed);
+
+    unsigned long ticket = atomic_fetch_add_explicit(&m->log_next, 1, memory_order_relaxed);
+    CompletionRecord *r = &m->log[ticket % METRICS_LOG_SIZE];
+    atomic_store_explicit(&r->seq, 2 * ticket + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    r->pid = p->pid;
+    r->priority = p->priority;
+    r->transitions = p->transitions;
+    r->arrival = p->t_arrival;
+    r->first_run = p->t_first_run;
+    r->completion = now;
+    memcpy(r->state_ms, p->state_ms, sizeof(r->state_ms));
+    atomic_store_explicit(&r->seq, 2 * ticket + 2, memory_order_release);
+}
+
+// Copies the record for ticket, or returns 0 if it is being written or gone
+static int read_record(unsigned long ticket, CompletionRecord *out) {
+    CompletionRecord *r = &sched_metrics.log[ticket % METRICS_LOG_SIZE];
+    unsigned long seq = atomic_load_explicit(&r->seq, memory_order_acquire);
+    if (seq != 2 * ticket + 2) return 0;
+    out->pid = r->pid;
+    out->priority = r->priority;
+    out->transitions = r->transitions;
+    out->arrival = r->arrival;
+    out->first_run = r->first_run;
+    out->completion = r->completion;
+    memcpy(out->state_ms, r->state_ms, sizeof(out->state_ms));
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&r->seq, memory_order_relaxed) == seq;
+}
+
+static long elapsed_ms() {
+    long elapsed = timer_wheel_now(&timer_wheel) - atomic_load(&sched_metrics.start_ms);
+    return elapsed > 0 ? elapsed : 1;
+}
+
+// Reporting. Time a PCB is still running for is charged when it stops.
+void print_sched_stats() {
+    SchedMetrics *m = &sched_metrics;
+    long elapsed = elapsed_ms();
+    long completed = atomic_load(&m->completed);
+    printf("[Stats] Elapsed: %.1f s, Completed: %ld, Throughput: %.3f/s, Transitions: %ld\n",
+           elapsed / 1000.0, completed, completed * 1000.0 / elapsed, atomic_load(&m->transitions));
+    for (int i = 0; i < cpu_set.num_cpus; i++) {
+        printf("[Stats] CPU %d utilization: %.1f%%\n", i, 100.0 * atomic_load(&m->cpu_busy_ms[i]) / elapsed);
+    }
+    printf("METRIC (ms)     COUNT       MEAN      P50      P90      P99    P99.9      MAX\n");
+    for (int k = 0; k < METRIC_COUNT; k++) {
+        Histogram *h = &m->hist[k];
+        printf("%-12s %8ld %10.1f %8ld %8ld %8ld %8ld %8ld\n", metric_names[k], atomic_load(&h->total),
+               hist_mean(h), hist_percentile(h, 50), hist_percentile(h, 90), hist_percentile(h, 99),
+               hist_percentile(h, 99.9), atomic_load(&h->max));
+    }
+}
+
+int metrics_export_csv(const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        perror("schedstat csv");
+        return -1;
+    }
+    fprintf(fp, "pid,priority,arrival_ms,first_run_ms,completion_ms,turnaround_ms,waiting_ms,response_ms,run_ms,io_ms,transitions\n");
+    unsigned long next = atomic_load(&sched_metrics.log_next);
+    unsigned long first = next > METRICS_LOG_SIZE ? next - METRICS_LOG_SIZE : 0;
+    int rows = 0;
+    for (unsigned long t = first; t < next; t++) {
+        CompletionRecord r;
+        if (!read_record(t, &r)) continue;
+        fprintf(fp, "%d,%d,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%d\n", r.pid, r.priority, r.arrival, r.first_run,
+                r.completion, r.completion - r.arrival, r.state_ms[READY],
+                (r.first_run >= 0 ? r.first_run : r.completion) - r.arrival,
+                r.state_ms[RUNNING], r.state_ms[WAITING], r.transitions);
+        rows++;
+    }
+    fclose(fp);
+    printf("[Stats] Wrote %d completions to %s\n", rows, path);
+    return 0;
+}
+
+int metrics_export_json(const char *path) {
+    SchedMetrics *m = &sched_metrics;
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        perror("schedstat json");
+        return -1;
+    }
+    long elapsed = elapsed_ms();
+    long completed = atomic_load(&m->completed);
+    fprintf(fp, "{\n  \"elapsed_ms\": %ld,\n  \"completed\": %ld,\n  \"throughput_per_s\": %.3f,\n",
+            elapsed, completed, completed * 1000.0 / elapsed);
+    fprintf(fp, "  \"transitions\": %ld,\n  \"cpu_utilization\": [", atomic_load(&m->transitions));
+    for (int i = 0; i < cpu_set.num_cpus; i++) {
+        fprintf(fp, "%s%.4f", i ? ", " : "", (double)atomic_load(&m->cpu_busy_ms[i]) / elapsed);
+    }
+    fprintf(fp, "],\n  \"metrics_ms\": {\n");
+    for (int k = 0; k < METRIC_COUNT; k++) {
+        Histogram *h = &m->hist[k];
+        fprintf(fp, "    \"%s\": {\"count\": %ld, \"mean\": %.3f, \"p50\": %ld, \"p90\": %ld, \"p99\": %ld, \"p999\": %ld, \"max\": %ld}%s\n",
+                metric_names[k], atomic_load(&h->total), hist_mean(h), hist_percentile(h, 50),
+                hist_percentile(h, 90), hist_percentile(h, 99), hist_percentile(h, 99.9),
+                atomic_load(&h->max), k + 1 < METRIC_COUNT ? "," : "");
+    }
+    fprintf(fp, "  }\n}\n");
+    fclose(fp);
+    printf("[Stats] Wrote summary to %s\n", path);
+    return 0;
+}
@@ -0,0 +1,64 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdatomic.h>
+#include "advancedScheduler.h"
+
+// Log-linear histogram in the HDR style: values below HIST_LINEAR are exact,
+// above that each power of two is split into 2^HIST_SUB_BITS buckets, so any
+// recorded value is off by at most about 3%. Recording is a few relaxed
+// atomic adds and never blocks.
+#define HIST_SUB_BITS 5
+#define HIST_LINEAR (2 << HIST_SUB_BITS)
+#define HIST_MAX_BITS 40            // values up to 2^41 ms
+#define HIST_BUCKETS (HIST_LINEAR + (HIST_MAX_BITS - HIST_SUB_BITS) * (1 << HIST_SUB_BITS))
+#define METRICS_LOG_SIZE 4096       // most recent completions kept for export
+
+typedef struct {
+    atomic_long counts[HIST_BUCKETS];
+    atomic_long total;
+    atomic_long sum;
+    atomic_long max;
+} Histogram;
+
+typedef enum { METRIC_TURNAROUND, METRIC_WAITING, METRIC_RESPONSE, METRIC_RUN, METRIC_IO, METRIC_COUNT } MetricType;
+
+// One finished PCB. seq is odd while a writer fills the slot, so readers
+// can skip or retry torn records without a lock.
+typedef struct {
+    atomic_ulong seq;
+    int pid;
+    int priority;
+    int transitions;
+    long arrival;
+    long first_run;
+    long completion;
+    long state_ms[5];
+} CompletionRecord;
+
+// Live scheduler metrics, in timer wheel milliseconds. PCB timestamps are
+// written only by the thread that currently owns the PCB; everything shared
+// is atomic, so nothing here takes a queue lock.
+typedef struct {
+    atomic_long start_ms;
+    atomic_long completed;
+    atomic_long transitions;
+    Histogram hist[METRIC_COUNT];
+    atomic_long cpu_busy_ms[MAX_CPUS];
+    atomic_ulong log_next;
+    CompletionRecord log[METRICS_LOG_SIZE];
+} SchedMetrics;
+
+extern SchedMetrics sched_metrics;
+
+void hist_record(Histogram *h, long value);
+long hist_percentile(Histogram *h, double percent);
+void metrics_reset();
+void metrics_arrive(PCB *p);
+void metrics_transition(PCB *p, ProcessState to);
+void metrics_complete(PCB *p);
+void print_sched_stats();
+int metrics_export_csv(const char *path);
+int metrics_export_json(const char *path);
+
+#endif
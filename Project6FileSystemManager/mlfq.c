@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <pthread.h>
+#include "advancedScheduler.h"
+#include "mlfq.h"
+
+void mlfq_init(MLFQ *m, int levels, const int *quanta, int boost_interval) {
+    if (levels < 1) levels = 1;
+    if (levels > MLFQ_MAX_LEVELS) levels = MLFQ_MAX_LEVELS;
+    m->levels = levels;
+    for (int i = 0; i < levels; i++) {
+        // Default quanta double per level: 1, 2, 4, ...
+        m->quantum[i] = quanta && quanta[i] > 0 ? quanta[i] : 1 << i;
+        m->head[i] = m->tail[i] = NULL;
+    }
+    m->boost_interval = boost_interval;
+    m->last_boost = 0;
+    m->epoch = 1;
+    m->level_mask = 0;
+}
+
+// A PCB's stored level is only meaningful if no boost happened since it was
+// set; otherwise it has been boosted back to the top level. This keeps a
+// boost O(levels) instead of touching every queued PCB.
+int mlfq_level(const MLFQ *m, const PCB *p) {
+    if (p->mlfq_epoch != m->epoch || p->mlfq_level >= m->levels) return 0;
+    return p->mlfq_level;
+}
+
+int mlfq_quantum(const MLFQ *m, const PCB *p) {
+    return m->quantum[mlfq_level(m, p)];
+}
+
+static void set_level(MLFQ *m, PCB *p, int level) {
+    p->mlfq_level = level;
+    p->mlfq_epoch = m->epoch;
+}
+
+void mlfq_push(MLFQ *m, PCB *p) {
+    int level = mlfq_level(m, p);
+    set_level(m, p, level);
+    p->next = NULL;
+    p->prev = m->tail[level];
+    if (m->tail[level]) m->tail[level]->next = p;
+    else m->head[level] = p;
+    m->tail[level] = p;
+    m->level_mask |= 1u << level;
+}
+
+PCB *mlfq_pop(MLFQ *m, long now) {
+    if (m->boost_interval > 0 && now - m->last_boost >= m->boost_interval) mlfq_boost(m, now);
+    if (!m->level_mask) return NULL;
+    int level = __builtin_ctz(m->level_mask);
+    PCB *p = m->head[level];
+    m->head[level] = p->next;
+    if (m->head[level]) m->head[level]->prev = NULL;
+    else {
+        m->tail[level] = NULL;
+        m->level_mask &= ~(1u << level);
+    }
+    p->next = p->prev = NULL;
+    return p;
+}
+
+// O(1) through the back link. A queued PCB sits in the list of its current
+// level, boosts included, since a boost splices every list onto level 0.
+int mlfq_remove(MLFQ *m, PCB *p) {
+    int level = mlfq_level(m, p);
+    if (p->prev ? p->prev->next != p : m->head[level] != p) return 0;
+    if (p->prev) p->prev->next = p->next;
+    else m->head[level] = p->next;
+    if (p->next) p->next->prev = p->prev;
+    else m->tail[level] = p->prev;
+    if (!m->head[level]) m->level_mask &= ~(1u << level);
+    p->next = p->prev = NULL;
+    return 1;
+}
+
+// Used its whole quantum: looks CPU bound, run it less often
+void mlfq_demote(MLFQ *m, PCB *p) {
+    int level = mlfq_level(m, p);
+    set_level(m, p, level + 1 < m->levels ? level + 1 : level);
+}
+
+// Gave up the CPU for I/O: looks interactive, run it sooner
+void mlfq_promote(MLFQ *m, PCB *p) {
+    int level = mlfq_level(m, p);
+    set_level(m, p, level > 0 ? level - 1 : 0);
+}
+
+// Splices every lower level onto the end of level 0 so nothing starves
+void mlfq_boost(MLFQ *m, long now) {
+    for (int i = 1; i < m->levels; i++) {
+        if (!m->head[i]) continue;
+        m->head[i]->prev = m->tail[0];
+        if (m->tail[0]) m->tail[0]->next = m->head[i];
+        else m->head[0] = m->head[i];
+        m->tail[0] = m->tail[i];
+        m->head[i] = m->tail[i] = NULL;
+    }
+    m->level_mask = m->head[0] ? 1u : 0;
+    m->epoch++;
+    m->last_boost = now;
+}
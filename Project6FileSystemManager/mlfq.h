@@ -0,0 +1,32 @@
+#ifndef MLFQ_H
+#define MLFQ_H
+
+#define MLFQ_MAX_LEVELS 8
+
+struct PCB;
+
+// Multi-level feedback queue. Level 0 is the highest priority; each level is
+// a FIFO list and level_mask has bit i set while level i is non-empty, so the
+// next level to run is a single count-trailing-zeros.
+typedef struct MLFQ {
+    int levels;
+    int quantum[MLFQ_MAX_LEVELS];   // ticks a process may run per dispatch
+    int boost_interval;             // ticks between priority boosts, 0 = never
+    long last_boost;
+    unsigned long epoch;            // bumped by every boost
+    unsigned level_mask;
+    struct PCB *head[MLFQ_MAX_LEVELS];
+    struct PCB *tail[MLFQ_MAX_LEVELS];
+} MLFQ;
+
+void mlfq_init(MLFQ *m, int levels, const int *quanta, int boost_interval);
+int mlfq_level(const MLFQ *m, const struct PCB *p);
+int mlfq_quantum(const MLFQ *m, const struct PCB *p);
+void mlfq_push(MLFQ *m, struct PCB *p);
+struct PCB *mlfq_pop(MLFQ *m, long now);
+int mlfq_remove(MLFQ *m, struct PCB *p);
+void mlfq_demote(MLFQ *m, struct PCB *p);
+void mlfq_promote(MLFQ *m, struct PCB *p);
+void mlfq_boost(MLFQ *m, long now);
+
+#endif
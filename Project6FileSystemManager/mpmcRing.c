@@ -0,0 +1,71 @@
+#include <stdlib.h>
+#include "mpmcRing.h"
+
+#define MASK (MPMC_RING_SIZE - 1)
+
+MpmcRing *ring_create() {
+    MpmcRing *r = aligned_alloc(CACHE_LINE, sizeof(MpmcRing));
+    if (!r) return NULL;
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    for (unsigned long i = 0; i < MPMC_RING_SIZE; i++) {
+        atomic_init(&r->cells[i].seq, i);
+        r->cells[i].pcb = NULL;
+    }
+    return r;
+}
+
+void ring_destroy(MpmcRing *r) {
+    free(r);
+}
+
+// Any thread. Returns -1 when the ring is full.
+int ring_push(MpmcRing *r, struct PCB *p) {
+    unsigned long pos = atomic_load_explicit(&r->head, memory_order_relaxed);
+    while (1) {
+        RingCell *cell = &r->cells[pos & MASK];
+        unsigned long seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        long diff = (long)(seq - pos);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&r->head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                cell->pcb = p;
+                atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+                return 0;
+            }
+        } else if (diff < 0) {
+            return -1;
+        } else {
+            pos = atomic_load_explicit(&r->head, memory_order_relaxed);
+        }
+    }
+}
+
+// Any thread. Takes the oldest PCB, or NULL if empty.
+struct PCB *ring_pop(MpmcRing *r) {
+    unsigned long pos = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    while (1) {
+        RingCell *cell = &r->cells[pos & MASK];
+        unsigned long seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        long diff = (long)(seq - (pos + 1));
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&r->tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                struct PCB *p = cell->pcb;
+                atomic_store_explicit(&cell->seq, pos + MPMC_RING_SIZE, memory_order_release);
+                return p;
+            }
+        } else if (diff < 0) {
+            return NULL;
+        } else {
+            pos = atomic_load_explicit(&r->tail, memory_order_relaxed);
+        }
+    }
+}
+
+// Approximate while other threads are pushing or popping
+long ring_size(MpmcRing *r) {
+    unsigned long head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    unsigned long tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    return head > tail ? (long)(head - tail) : 0;
+}
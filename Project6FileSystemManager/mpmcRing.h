@@ -0,0 +1,33 @@
+#ifndef MPMCRING_H
+#define MPMCRING_H
+
+#include <stdatomic.h>
+
+#define MPMC_RING_SIZE 1024     // must be a power of two
+#define CACHE_LINE 64
+
+struct PCB;
+
+// Bounded multi-producer/multi-consumer queue (Vyukov). Each cell carries a
+// sequence number saying whose turn it is: a producer at position pos owns
+// the cell when seq == pos, a consumer when seq == pos + 1. Producers and
+// consumers only contend on their own index with one CAS, and the cells are
+// never freed while the ring is live, so no memory reclamation is needed.
+typedef struct {
+    atomic_ulong seq;
+    struct PCB *pcb;
+} RingCell;
+
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_ulong head;     // next position to push
+    _Alignas(CACHE_LINE) atomic_ulong tail;     // next position to pop
+    _Alignas(CACHE_LINE) RingCell cells[MPMC_RING_SIZE];
+} MpmcRing;
+
+MpmcRing *ring_create();
+void ring_destroy(MpmcRing *r);
+int ring_push(MpmcRing *r, struct PCB *p);
+struct PCB *ring_pop(MpmcRing *r);
+long ring_size(MpmcRing *r);
+
+#endif
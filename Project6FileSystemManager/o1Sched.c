@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <pthread.h>
+#include "advancedScheduler.h"
+#include "o1Sched.h"
+
+void o1_init(O1Sched *o, int age_interval, int starvation_limit) {
+    for (int a = 0; a < 2; a++) {
+        for (int i = 0; i < O1_LEVELS; i++) o->arrays[a].head[i] = o->arrays[a].tail[i] = NULL;
+        o->arrays[a].bitmap = 0;
+        o->arrays[a].count = 0;
+    }
+    o->active = 0;
+    o->agings = 0;
+    o->last_aging = 0;
+    o->expired_since = -1;
+    o->age_interval = age_interval;
+    o->starvation_limit = starvation_limit;
+    o->swaps = 0;
+    o->starved_pushes = 0;
+    o->initialized = 1;
+}
+
+static int static_level(const PCB *p) {
+    return p->priority < 0 ? 0 : p->priority >= O1_LEVELS ? O1_LEVELS - 1 : p->priority;
+}
+
+// Level at push, less the aging steps since; steps never go past level 0
+int o1_level(const O1Sched *o, const PCB *p) {
+    unsigned long aged = o->agings - p->o1_aging;
+    return aged >= (unsigned long)p->o1_level ? 0 : p->o1_level - (int)aged;
+}
+
+// Higher priority, longer slice
+int o1_timeslice(const PCB *p) {
+    int slice = O1_MAX_SLICE >> (static_level(p) / 8);
+    return slice > 0 ? slice : 1;
+}
+
+// Every queued PCB moves up one level per step: level 1 joins the back of
+// level 0, level 2 takes the place of level 1, and so on
+static void age_array(O1Array *arr) {
+    unsigned long long above = arr->bitmap & ~1ULL;
+    while (above) {
+        int level = __builtin_ctzll(above);
+        above &= above - 1;
+        PCB *head = arr->head[level], *tail = arr->tail[level];
+        if (arr->tail[level - 1]) {
+            arr->tail[level - 1]->next = head;
+            head->prev = arr->tail[level - 1];
+        } else {
+            arr->head[level - 1] = head;
+        }
+        arr->tail[level - 1] = tail;
+        arr->head[level] = arr->tail[level] = NULL;
+    }
+    arr->bitmap = (arr->bitmap >> 1) | (arr->bitmap & 1);
+}
+
+static void o1_age(O1Sched *o, long now) {
+    if (o->age_interval <= 0) return;
+    long steps = (now - o->last_aging) / o->age_interval;
+    if (steps <= 0) return;
+    o->last_aging += steps * o->age_interval;
+    // Past O1_LEVELS steps everything is already at level 0
+    if (steps > O1_LEVELS) steps = O1_LEVELS;
+    for (long s = 0; s < steps; s++) {
+        age_array(&o->arrays[0]);
+        age_array(&o->arrays[1]);
+        o->agings++;
+    }
+}
+
+static int starving(const O1Sched *o, long now) {
+    return o->starvation_limit > 0 && o->expired_since >= 0 && now - o->expired_since >= o->starvation_limit;
+}
+
+void o1_push(O1Sched *o, PCB *p, long now) {
+    o1_age(o, now);
+    int to_expired = p->o1_expired;
+    if (!to_expired && starving(o, now)) {
+        to_expired = 1;
+        o->starved_pushes++;
+    }
+    p->o1_expired = 0;
+    int a = to_expired ? !o->active : o->active;
+    O1Array *arr = &o->arrays[a];
+    if (a != o->active && arr->count == 0) o->expired_since = now;
+
+    int level = static_level(p);
+    p->o1_array = a;
+    p->o1_level = level;
+    p->o1_aging = o->agings;
+    p->next = NULL;
+    p->prev = arr->tail[level];
+    if (arr->tail[level]) arr->tail[level]->next = p;
+    else arr->head[level] = p;
+    arr->tail[level] = p;
+    arr->bitmap |= 1ULL << level;
+    arr->count++;
+}
+
+static void unlink_pcb(O1Array *arr, int level, PCB *p) {
+    if (p->prev) p->prev->next = p->next;
+    else arr->head[level] = p->next;
+    if (p->next) p->next->prev = p->prev;
+    else arr->tail[level] = p->prev;
+    if (!arr->head[level]) arr->bitmap &= ~(1ULL << level);
+    arr->count--;
+    p->next = p->prev = NULL;
+    p->o1_array = -1;
+}
+
+PCB *o1_pop(O1Sched *o, long now) {
+    o1_age(o, now);
+    O1Array *arr = &o->arrays[o->active];
+    if (arr->count == 0) {
+        if (o->arrays[!o->active].count == 0) return NULL;
+        o->active = !o->active;
+        o->expired_since = -1;
+        o->swaps++;
+        arr = &o->arrays[o->active];
+    }
+    int level = __builtin_ctzll(arr->bitmap);
+    PCB *p = arr->head[level];
+    unlink_pcb(arr, level, p);
+    return p;
+}
+
+int o1_remove(O1Sched *o, PCB *p) {
+    if (p->o1_array < 0) return 0;
+    O1Array *arr = &o->arrays[p->o1_array];
+    int was_expired = p->o1_array != o->active;
+    unlink_pcb(arr, o1_level(o, p), p);
+    if (was_expired && arr->count == 0) o->expired_since = -1;
+    return 1;
+}
+
+// Used its whole slice: it waits in the expired array for its next turn
+void o1_expire(PCB *p) {
+    p->o1_expired = 1;
+}
+
+void o1_for_each(O1Sched *o, void (*fn)(PCB *, void *), void *ctx) {
+    for (int a = 0; a < 2; a++) {
+        O1Array *arr = &o->arrays[a == 0 ? o->active : !o->active];
+        for (unsigned long long m = arr->bitmap; m; m &= m - 1) {
+            for (PCB *p = arr->head[__builtin_ctzll(m)]; p; p = p->next) fn(p, ctx);
+        }
+    }
+}
+
+void o1_print(O1Sched *o, long now) {
+    O1Array *active = &o->arrays[o->active], *expired = &o->arrays[!o->active];
+    printf("[O1] Active: %d PCBs, bitmap %016llx\n", active->count, active->bitmap);
+    printf("[O1] Expired: %d PCBs, bitmap %016llx", expired->count, expired->bitmap);
+    if (o->expired_since >= 0) printf(", waiting %ld ticks", now - o->expired_since);
+    printf("\n[O1] Age interval: %d ticks/level, Starvation limit: %d ticks\n", o->age_interval, o->starvation_limit);
+    printf("[O1] Array swaps: %ld, Aging steps: %lu, Pushes held back by the starvation limit: %ld\n",
+           o->swaps, o->agings, o->starved_pushes);
+}
@@ -0,0 +1,52 @@
+#ifndef O1SCHED_H
+#define O1SCHED_H
+
+#define O1_LEVELS 64                // priority 0..63, one bitmap word
+#define O1_MAX_SLICE 4              // ticks at levels 0-7, halved every 8 levels
+#define O1_DEFAULT_AGE_INTERVAL 2
+#define O1_DEFAULT_STARVATION_LIMIT 20
+
+struct PCB;
+
+typedef struct O1Array {
+    struct PCB *head[O1_LEVELS];
+    struct PCB *tail[O1_LEVELS];
+    unsigned long long bitmap;      // bit n set while level n is non-empty
+    int count;
+} O1Array;
+
+// O(1) scheduler in the Linux 2.6 style. Each array is a FIFO list per
+// priority level plus a bitmap, so picking is one count-trailing-zeros.
+// A PCB that uses up its slice goes to the expired array and the arrays
+// swap when the active one empties, so every active PCB runs before any
+// expired one runs twice.
+//
+// Two things stop starvation. Aging: every age_interval ticks every queued
+// PCB rises a level, done by splicing each list onto the one above. That is
+// O(levels), not O(PCBs), and a PCB works out its level from the aging count.
+// Starvation limit: once the expired array has waited that long, new and
+// woken PCBs also go to it, so the active array drains and they swap.
+typedef struct O1Sched {
+    O1Array arrays[2];
+    int active;                     // index of the active array
+    unsigned long agings;           // aging steps so far
+    long last_aging;
+    long expired_since;             // when the expired array became non-empty
+    int age_interval;               // ticks queued per level gained, 0 = no aging
+    int starvation_limit;           // ticks, 0 = none
+    long swaps;
+    long starved_pushes;            // PCBs sent to expired by the limit
+    int initialized;
+} O1Sched;
+
+void o1_init(O1Sched *o, int age_interval, int starvation_limit);
+int o1_level(const O1Sched *o, const struct PCB *p);
+int o1_timeslice(const struct PCB *p);
+void o1_push(O1Sched *o, struct PCB *p, long now);
+struct PCB *o1_pop(O1Sched *o, long now);
+int o1_remove(O1Sched *o, struct PCB *p);
+void o1_expire(struct PCB *p);
+void o1_for_each(O1Sched *o, void (*fn)(struct PCB *, void *), void *ctx);
+void o1_print(O1Sched *o, long now);
+
+#endif
@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdalign.h>
+#include <stddef.h>
+#include "objPool.h"
+
+ObjPool obj_pools[MAX_OBJ_POOLS];
+int obj_pool_count = 0;
+
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+
+typedef struct {
+    Magazine *loaded;
+    Magazine *previous;
+    long allocs;
+    long frees;
+    long hits;
+} ThreadCache;
+
+static _Thread_local ThreadCache thread_caches[MAX_OBJ_POOLS];
+static _Thread_local int thread_registered;
+static pthread_key_t flush_key;
+static pthread_once_t flush_key_once = PTHREAD_ONCE_INIT;
+
+static void flush_on_exit(void *arg) {
+    (void)arg;
+    pool_flush_thread();
+}
+
+static void make_flush_key() {
+    pthread_key_create(&flush_key, flush_on_exit);
+}
+
+// A key with a destructor gives exiting threads' magazines back to the depot
+static ThreadCache *thread_cache(ObjPool *pool) {
+    if (!thread_registered) {
+        pthread_once(&flush_key_once, make_flush_key);
+        pthread_setspecific(flush_key, &thread_registered);
+        thread_registered = 1;
+    }
+    return &thread_caches[pool->id];
+}
+
+ObjPool *pool_create(const char *name, size_t obj_size) {
+    pthread_mutex_lock(&registry_lock);
+    if (obj_pool_count >= MAX_OBJ_POOLS) {
+        pthread_mutex_unlock(&registry_lock);
+        printf("Too many object pools\n");
+        return NULL;
+    }
+    ObjPool *pool = &obj_pools[obj_pool_count];
+    memset(pool, 0, sizeof(ObjPool));
+    pool->id = obj_pool_count;
+    strncpy(pool->name, name, OBJ_POOL_NAME_LEN - 1);
+    size_t align = alignof(max_align_t);
+    pool->obj_size = (obj_size + align - 1) / align * align;
+    pthread_mutex_init(&pool->lock, NULL);
+    obj_pool_count++;
+    pthread_mutex_unlock(&registry_lock);
+    return pool;
+}
+
+static Magazine *new_magazine() {
+    Magazine *m = malloc(sizeof(Magazine));
+    if (m) {
+        m->next = NULL;
+        m->rounds = 0;
+    }
+    return m;
+}
+
+// With pool->lock held
+static void fold_stats(ObjPool *pool, ThreadCache *tc) {
+    atomic_fetch_add_explicit(&pool->allocs, tc->allocs, memory_order_relaxed);
+    atomic_fetch_add_explicit(&pool->frees, tc->frees, memory_order_relaxed);
+    atomic_fetch_add_explicit(&pool->hits, tc->hits, memory_order_relaxed);
+    tc->allocs = tc->frees = tc->hits = 0;
+}
+
+static void depot_put(ObjPool *pool, Magazine *m) {
+    if (m->rounds > 0) {
+        m->next = pool->full;
+        pool->full = m;
+        pool->full_count++;
+    } else {
+        m->next = pool->empty;
+        pool->empty = m;
+    }
+}
+
+void *pool_alloc(ObjPool *pool) {
+    ThreadCache *tc = thread_cache(pool);
+    tc->allocs++;
+    if (tc->loaded && tc->loaded->rounds > 0) {
+        tc->hits++;
+        return tc->loaded->objs[--tc->loaded->rounds];
+    }
+    if (tc->previous && tc->previous->rounds > 0) {
+        Magazine *m = tc->previous;
+        tc->previous = tc->loaded;
+        tc->loaded = m;
+        tc->hits++;
+        return m->objs[--m->rounds];
+    }
+
+    // Both empty: trade one for a full magazine from the depot
+    Magazine *full = NULL;
+    pthread_mutex_lock(&pool->lock);
+    fold_stats(pool, tc);
+    atomic_fetch_add_explicit(&pool->depot_trips, 1, memory_order_relaxed);
+    if (pool->full) {
+        full = pool->full;
+        pool->full = full->next;
+        pool->full_count--;
+        if (tc->previous) depot_put(pool, tc->previous);
+        tc->previous = tc->loaded;
+        tc->loaded = full;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    if (!full) {
+        if (!tc->loaded && !(tc->loaded = new_magazine())) return NULL;
+        char *slab = malloc(pool->obj_size * MAGAZINE_SIZE);
+        if (!slab) return NULL;
+        atomic_fetch_add_explicit(&pool->slabs, 1, memory_order_relaxed);
+        for (int i = 0; i < MAGAZINE_SIZE; i++) tc->loaded->objs[i] = slab + i * pool->obj_size;
+        tc->loaded->rounds = MAGAZINE_SIZE;
+    }
+    return tc->loaded->objs[--tc->loaded->rounds];
+}
+
+void *pool_zalloc(ObjPool *pool) {
+    void *obj = pool_alloc(pool);
+    if (obj) memset(obj, 0, pool->obj_size);
+    return obj;
+}
+
+void pool_free(ObjPool *pool, void *obj) {
+    if (!obj) return;
+    ThreadCache *tc = thread_cache(pool);
+    tc->frees++;
+    if (tc->loaded && tc->loaded->rounds < MAGAZINE_SIZE) {
+        tc->loaded->objs[tc->loaded->rounds++] = obj;
+        return;
+    }
+    if (tc->previous && tc->previous->rounds == 0) {
+        Magazine *m = tc->previous;
+        tc->previous = tc->loaded;
+        tc->loaded = m;
+        m->objs[m->rounds++] = obj;
+        return;
+    }
+
+    // Both full: hand one to the depot and take an empty one back
+    Magazine *empty = NULL;
+    pthread_mutex_lock(&pool->lock);
+    fold_stats(pool, tc);
+    atomic_fetch_add_explicit(&pool->depot_trips, 1, memory_order_relaxed);
+    if (tc->previous) depot_put(pool, tc->previous);
+    tc->previous = NULL;
+    if (pool->empty) {
+        empty = pool->empty;
+        pool->empty = empty->next;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    if (!empty && !(empty = new_magazine())) {
+        perror("pool_free");
+        return;
+    }
+    tc->previous = tc->loaded;
+    tc->loaded = empty;
+    empty->objs[empty->rounds++] = obj;
+}
+
+// Returns the calling thread's magazines and counts to the depots
+void pool_flush_thread() {
+    for (int i = 0; i < obj_pool_count; i++) {
+        ObjPool *pool = &obj_pools[i];
+        ThreadCache *tc = &thread_caches[i];
+        pthread_mutex_lock(&pool->lock);
+        fold_stats(pool, tc);
+        if (tc->loaded) depot_put(pool, tc->loaded);
+        if (tc->previous) depot_put(pool, tc->previous);
+        tc->loaded = tc->previous = NULL;
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+// Other threads' counts since their last depot trip are not included
+void print_pool_stats() {
+    printf("POOL          SIZE      ALLOCS    HIT%%  DEPOT_TRIPS  SLABS   IN_USE  DEPOT_MAGS\n");
+    for (int i = 0; i < obj_pool_count; i++) {
+        ObjPool *pool = &obj_pools[i];
+        pthread_mutex_lock(&pool->lock);
+        fold_stats(pool, &thread_caches[i]);
+        long full = pool->full_count;
+        pthread_mutex_unlock(&pool->lock);
+        long allocs = atomic_load(&pool->allocs);
+        long frees = atomic_load(&pool->frees);
+        printf("%-12s %5zu %11ld %7.2f %12ld %6ld %8ld %11ld\n",
+               pool->name, pool->obj_size, allocs,
+               allocs ? 100.0 * atomic_load(&pool->hits) / allocs : 0.0,
+               atomic_load(&pool->depot_trips), atomic_load(&pool->slabs), allocs - frees, full);
+    }
+}
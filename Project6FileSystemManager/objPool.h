@@ -0,0 +1,52 @@
+#ifndef OBJPOOL_H
+#define OBJPOOL_H
+
+#include <stddef.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define MAX_OBJ_POOLS 16
+#define OBJ_POOL_NAME_LEN 16
+#define MAGAZINE_SIZE 64            // objects per magazine, and per slab
+
+// Fixed-size object cache with per-thread magazines (Bonwick). Each thread
+// keeps a loaded and a previous magazine, so alloc and free touch nothing
+// shared until both run dry or fill up; then a whole magazine is traded
+// with the global depot under its lock. An empty depot is refilled with a
+// slab of MAGAZINE_SIZE objects from one malloc. Memory is never returned
+// to malloc, only recycled.
+typedef struct Magazine {
+    struct Magazine *next;
+    int rounds;
+    void *objs[MAGAZINE_SIZE];
+} Magazine;
+
+typedef struct ObjPool {
+    int id;
+    char name[OBJ_POOL_NAME_LEN];
+    size_t obj_size;
+
+    pthread_mutex_t lock;           // depot
+    Magazine *full;
+    Magazine *empty;
+    long full_count;
+
+    // Thread counters are folded in at each depot trip and at thread exit
+    atomic_long allocs;
+    atomic_long frees;
+    atomic_long hits;               // served from the thread's magazines
+    atomic_long depot_trips;
+    atomic_long slabs;
+} ObjPool;
+
+extern ObjPool obj_pools[MAX_OBJ_POOLS];
+extern int obj_pool_count;
+
+ObjPool *pool_create(const char *name, size_t obj_size);
+void *pool_alloc(ObjPool *pool);
+void *pool_zalloc(ObjPool *pool);
+void pool_free(ObjPool *pool, void *obj);
+void pool_flush_thread();
+void print_pool_stats();
+
+#endif
@@ -0,0 +1,106 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/wait.h>
+#include "advancedScheduler.h"
+#include "realSched.h"
+#include "trace.h"
+
+atomic_int real_sched_enabled = 0;
+
+static atomic_long admitted, resumes, preemptions, exited;
+
+// Queues a forked child that has stopped itself before exec. Waiting for
+// the stop first means the first SIGCONT can never arrive before it.
+int real_sched_admit(pid_t pid, int priority) {
+    int status;
+    if (waitpid(pid, &status, WUNTRACED) < 0 || !WIFSTOPPED(status)) {
+        fprintf(stderr, "[Real] Child %d exited before it could be scheduled\n", pid);
+        return -1;
+    }
+    PCB *p = sched_create_process(priority, REAL_TIME_LIMIT);
+    p->os_pid = pid;
+    p->io_chance = -1;          // it does its own I/O
+    atomic_fetch_add(&admitted, 1);
+    printf("[Real] Host pid %d queued as PID %d\n", pid, p->pid);
+    trace_record(TRACE_ARRIVE, -1, p);
+    enqueue(&ready_queue, p);
+    return 0;
+}
+
+// Simulated CPU n runs its child on host core n (modulo the host's cores)
+void real_sched_resume(PCB *p, int cpu) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores > 0) {
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        CPU_SET(cpu % cores, &mask);
+        sched_setaffinity(p->os_pid, sizeof(mask), &mask);
+    }
+    kill(p->os_pid, SIGCONT);
+    atomic_fetch_add(&resumes, 1);
+}
+
+// Stopped before the PCB is requeued, so no other CPU can resume it first
+void real_sched_preempt(PCB *p) {
+    kill(p->os_pid, SIGSTOP);
+    atomic_fetch_add(&preemptions, 1);
+}
+
+// Reads utime + stime from /proc/<pid>/stat. Returns 0 once the child has
+// exited (zombie, or already reaped by the shell), 1 while it lives.
+int real_proc_sample(pid_t pid, long *cpu_ms) {
+    char path[64], buf[512];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    size_t len = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[len] = '\0';
+
+    // The command name may hold spaces and parentheses, so fields are
+    // counted from the last ')'
+    char *s = strrchr(buf, ')');
+    if (!s || s[1] == '\0') return 0;
+    char state = s[2];
+    if (state == 'Z' || state == 'X') return 0;
+    s += 3;
+    for (int field = 4; field < 14 && s; field++) {
+        s = strchr(s, ' ');
+        if (s) s++;
+    }
+    unsigned long utime, stime;
+    if (s && sscanf(s, "%lu %lu", &utime, &stime) == 2) {
+        static long hz;
+        if (!hz) hz = sysconf(_SC_CLK_TCK);
+        *cpu_ms = (long)((utime + stime) * 1000 / hz);
+    }
+    return 1;
+}
+
+// Runs a real child for up to max_ns or until its quantum expires. Checks
+// every REAL_POLL_MS so a short command frees its CPU as soon as it exits,
+// and charges the PCB the CPU time it really used. Returns 0 once it exited.
+int real_sched_run(PCB *p, TimeManager *t, long long max_ns) {
+    int alive = 1;
+    for (long long waited = 0; waited < max_ns && alive && !should_preempt(t);) {
+        long long step = max_ns - waited;
+        if (step > REAL_POLL_MS * 1000000LL) step = REAL_POLL_MS * 1000000LL;
+        waited += timer_run(t, step);
+        alive = real_proc_sample(p->os_pid, &p->os_cpu_ms);
+    }
+    p->cpu_time_ns = p->os_cpu_ms * 1000000LL;
+    p->cpu_time_used = p->cpu_time_ns / SCHED_TICK_NS;
+    if (!alive) atomic_fetch_add(&exited, 1);
+    return alive;
+}
+
+void print_real_sched() {
+    printf("[Real] Scheduling of forked commands is %s\n", atomic_load(&real_sched_enabled) ? "on" : "off");
+    printf("[Real] Admitted: %ld, Exited: %ld, Resumes: %ld, Preemptions: %ld\n",
+           atomic_load(&admitted), atomic_load(&exited), atomic_load(&resumes), atomic_load(&preemptions));
+}
@@ -0,0 +1,26 @@
+#ifndef REALSCHED_H
+#define REALSCHED_H
+
+#include <stdatomic.h>
+#include <sys/types.h>
+#include "advancedScheduler.h"
+
+#define REAL_DEFAULT_PRIORITY 2
+#define REAL_TIME_LIMIT (1 << 30)   // real jobs end when the child exits
+#define REAL_POLL_MS 10             // exit and CPU time checks within a tick
+
+// With realsched on, every command the shell forks stops itself before
+// exec and is queued as a PCB bound to its host pid. Only the dispatched
+// PCB's child runs: dispatch sends SIGCONT and pins it to the host core of
+// its simulated CPU, preemption sends SIGSTOP, and the PCB is charged the
+// utime + stime the child actually used, read from /proc.
+extern atomic_int real_sched_enabled;
+
+int real_sched_admit(pid_t pid, int priority);
+void real_sched_resume(PCB *p, int cpu);
+void real_sched_preempt(PCB *p);
+int real_sched_run(PCB *p, TimeManager *t, long long max_ns);
+int real_proc_sample(pid_t pid, long *cpu_ms);
+void print_real_sched();
+
+#endif
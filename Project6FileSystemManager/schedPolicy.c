@@ -0,0 +1,480 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "advancedScheduler.h"
+
+#define STRIDE1 (1L << 20)      // stride = STRIDE1 / tickets
+
+static int remaining(const PCB *p) {
+    return p->time_limit - p->cpu_time_used;
+}
+
+static int tickets(const PCB *p) {
+    return p->tickets > 0 ? p->tickets : 1;
+}
+
+// Grows the PCB array shared by the heap and lottery policies
+static int reserve_slot(Queue *q) {
+    if (q->count < q->capacity) return 0;
+    int new_capacity = q->capacity ? q->capacity * 2 : 64;
+    PCB **heap = realloc(q->heap, new_capacity * sizeof(PCB *));
+    if (!heap) return -1;
+    q->heap = heap;
+    q->capacity = new_capacity;
+    return 0;
+}
+
+// FIFO list: FCFS, round robin, and every unordered queue
+static int fifo_enqueue(Queue *q, PCB *p) {
+    p->next = NULL;
+    p->prev = q->tail;
+    if (q->tail) q->tail->next = p;
+    else q->head = p;
+    q->tail = p;
+    q->count++;
+    return 0;
+}
+
+static PCB *fifo_pick(Queue *q) {
+    PCB *p = q->head;
+    if (!p) return NULL;
+    q->head = p->next;
+    if (q->head) q->head->prev = NULL;
+    else q->tail = NULL;
+    p->next = NULL;
+    q->count--;
+    return p;
+}
+
+// O(1) through the back link, e.g. for an I/O timer taking its PCB out
+static int fifo_remove(Queue *q, PCB *p) {
+    if (p->prev ? p->prev->next != p : q->head != p) return 0;
+    if (p->prev) p->prev->next = p->next;
+    else q->head = p->next;
+    if (p->next) p->next->prev = p->prev;
+    else q->tail = p->prev;
+    p->next = p->prev = NULL;
+    q->count--;
+    return 1;
+}
+
+static void fifo_for_each(Queue *q, void (*fn)(PCB *, void *), void *ctx) {
+    for (PCB *p = q->head; p; p = p->next) fn(p, ctx);
+}
+
+// Indexed binary min-heap ordered by the policy's before(): priority, SJF,
+// SRTF and stride
+#define BEFORE(q, a, b) (sched_policies[(q)->policy].before((a), (b)))
+
+static void heap_swap(Queue *q, int i, int j) {
+    PCB *tmp = q->heap[i];
+    q->heap[i] = q->heap[j];
+    q->heap[j] = tmp;
+    q->heap[i]->heap_index = i;
+    q->heap[j]->heap_index = j;
+}
+
+static void heap_sift_up(Queue *q, int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!BEFORE(q, q->heap[i], q->heap[parent])) break;
+        heap_swap(q, i, parent);
+        i = parent;
+    }
+}
+
+static void heap_sift_down(Queue *q, int i) {
+    while (1) {
+        int best = i, left = 2 * i + 1, right = left + 1;
+        if (left < q->count && BEFORE(q, q->heap[left], q->heap[best])) best = left;
+        if (right < q->count && BEFORE(q, q->heap[right], q->heap[best])) best = right;
+        if (best == i) break;
+        heap_swap(q, i, best);
+        i = best;
+    }
+}
+
+static int heap_contains(Queue *q, PCB *p) {
+    return p->heap_index >= 0 && p->heap_index < q->count && q->heap[p->heap_index] == p;
+}
+
+static int heap_enqueue(Queue *q, PCB *p) {
+    if (reserve_slot(q) < 0) return -1;
+    p->heap_index = q->count;
+    q->heap[q->count] = p;
+    heap_sift_up(q, q->count++);
+    return 0;
+}
+
+static int heap_remove(Queue *q, PCB *p) {
+    if (!heap_contains(q, p)) return 0;
+    int i = p->heap_index;
+    heap_swap(q, i, --q->count);
+    if (i < q->count) {
+        PCB *moved = q->heap[i];
+        heap_sift_up(q, i);
+        heap_sift_down(q, moved->heap_index);
+    }
+    p->heap_index = -1;
+    return 1;
+}
+
+static PCB *heap_pick(Queue *q) {
+    if (q->count == 0) return NULL;
+    PCB *p = q->heap[0];
+    heap_remove(q, p);
+    return p;
+}
+
+static void heap_for_each(Queue *q, void (*fn)(PCB *, void *), void *ctx) {
+    for (int i = 0; i < q->count; i++) fn(q->heap[i], ctx);
+}
+
+// Priority keeps the heap plus a list in queueing order, which aging walks
+// from its oldest end, see queue_age_locked()
+static void age_unlink(Queue *q, PCB *p) {
+    if (p->age_prev) p->age_prev->age_next = p->age_next;
+    else q->age_head = p->age_next;
+    if (p->age_next) p->age_next->age_prev = p->age_prev;
+    else q->age_tail = p->age_prev;
+    p->age_next = p->age_prev = NULL;
+}
+
+static int priority_enqueue(Queue *q, PCB *p) {
+    if (heap_enqueue(q, p) < 0) return -1;
+    p->age_next = NULL;
+    p->age_prev = q->age_tail;
+    if (q->age_tail) q->age_tail->age_next = p;
+    else q->age_head = p;
+    q->age_tail = p;
+    return 0;
+}
+
+static PCB *priority_pick(Queue *q) {
+    PCB *p = heap_pick(q);
+    if (p) age_unlink(q, p);
+    return p;
+}
+
+static int priority_remove(Queue *q, PCB *p) {
+    if (!heap_remove(q, p)) return 0;
+    age_unlink(q, p);
+    return 1;
+}
+
+// Lower priority value first, then shorter time limit, then FIFO
+static int priority_before(const PCB *a, const PCB *b) {
+    if (a->priority != b->priority) return a->priority < b->priority;
+    if (a->time_limit != b->time_limit) return a->time_limit < b->time_limit;
+    return a->seq < b->seq;
+}
+
+static int sjf_before(const PCB *a, const PCB *b) {
+    if (a->time_limit != b->time_limit) return a->time_limit < b->time_limit;
+    return a->seq < b->seq;
+}
+
+static int srtf_before(const PCB *a, const PCB *b) {
+    if (remaining(a) != remaining(b)) return remaining(a) < remaining(b);
+    return a->seq < b->seq;
+}
+
+static int stride_before(const PCB *a, const PCB *b) {
+    if (a->pass != b->pass) return a->pass < b->pass;
+    return a->seq < b->seq;
+}
+
+// Earliest absolute deadline first; PCBs without one share LONG_MAX
+static int edf_before(const PCB *a, const PCB *b) {
+    if (a->deadline != b->deadline) return a->deadline < b->deadline;
+    return a->seq < b->seq;
+}
+
+// Quanta
+static int fixed_quantum(Queue *q, PCB *p) {
+    return 5;
+}
+
+static int slice_quantum(Queue *q, PCB *p) {
+    return q->slice > 0 ? q->slice : 2;
+}
+
+// Non-preemptive policies run the PCB until it finishes or blocks
+static int run_to_completion(Queue *q, PCB *p) {
+    return remaining(p) > 0 ? remaining(p) : 1;
+}
+
+// SRTF preempts as soon as a queued PCB has strictly less work left
+static int srtf_on_tick(Queue *q, PCB *p) {
+    return q->count > 0 && remaining(q->heap[0]) < remaining(p);
+}
+
+// EDF preempts when a queued PCB's deadline is earlier
+static int edf_on_tick(Queue *q, PCB *p) {
+    return q->count > 0 && q->heap[0]->deadline < p->deadline;
+}
+
+static int edf_admit(Queue *q, PCB *p) {
+    return edf_admissible(&q->edf, p);
+}
+
+// Stride: pass advances by stride per tick actually run. New PCBs join at
+// the global pass, and sleepers may not come back behind it.
+static int stride_enqueue(Queue *q, PCB *p) {
+    int ran = p->cpu_time_used - p->exec_start;
+    if (ran > 0) p->pass += (long)ran * (STRIDE1 / tickets(p));
+    p->exec_start = p->cpu_time_used;
+    if (p->pass == 0) p->pass = q->global_pass;
+    return heap_enqueue(q, p);
+}
+
+static PCB *stride_pick(Queue *q) {
+    PCB *p = heap_pick(q);
+    if (p) q->global_pass = p->pass;
+    return p;
+}
+
+static void stride_on_wake(Queue *q, PCB *p) {
+    if (p->pass < q->global_pass) p->pass = q->global_pass;
+}
+
+// Lottery: PCBs sit in array slots and a Fenwick tree over their ticket
+// counts turns a draw into an O(log n) prefix-sum search. Removal moves the
+// last slot into the hole so the slots stay dense.
+static void fenwick_add(Queue *q, int slot, long delta) {
+    for (int i = slot + 1; i <= q->fenwick_capacity; i += i & -i) q->fenwick[i] += delta;
+}
+
+static int lottery_reserve(Queue *q) {
+    if (reserve_slot(q) < 0) return -1;
+    if (q->fenwick_capacity == q->capacity) return 0;
+    long *tree = realloc(q->fenwick, (q->capacity + 1) * sizeof(long));
+    if (!tree) return -1;
+    q->fenwick = tree;
+    q->fenwick_capacity = q->capacity;
+    // Linear-time rebuild: each node pushes its sum to its parent
+    memset(tree, 0, (q->capacity + 1) * sizeof(long));
+    for (int i = 1; i <= q->capacity; i++) {
+        if (i <= q->count) tree[i] += tickets(q->heap[i - 1]);
+        int parent = i + (i & -i);
+        if (parent <= q->capacity) tree[parent] += tree[i];
+    }
+    return 0;
+}
+
+static int lottery_enqueue(Queue *q, PCB *p) {
+    if (lottery_reserve(q) < 0) return -1;
+    p->heap_index = q->count;
+    q->heap[q->count++] = p;
+    fenwick_add(q, p->heap_index, tickets(p));
+    q->total_tickets += tickets(p);
+    return 0;
+}
+
+static int lottery_remove(Queue *q, PCB *p) {
+    if (!heap_contains(q, p)) return 0;
+    int slot = p->heap_index, last = --q->count;
+    fenwick_add(q, slot, -tickets(p));
+    q->total_tickets -= tickets(p);
+    if (slot != last) {
+        PCB *moved = q->heap[last];
+        fenwick_add(q, last, -tickets(moved));
+        fenwick_add(q, slot, tickets(moved));
+        q->heap[slot] = moved;
+        moved->heap_index = slot;
+    }
+    p->heap_index = -1;
+    return 1;
+}
+
+static PCB *lottery_pick(Queue *q) {
+    if (q->count == 0 || q->total_tickets <= 0) return NULL;
+    long draw = ((long)rand_r(&q->seed) * (RAND_MAX + 1L) + rand_r(&q->seed)) % q->total_tickets;
+    // Descend the tree for the first slot whose prefix sum exceeds the draw
+    int pos = 0, step = 1;
+    while (step * 2 <= q->fenwick_capacity) step *= 2;
+    for (; step; step /= 2) {
+        if (pos + step <= q->fenwick_capacity && q->fenwick[pos + step] <= draw) {
+            pos += step;
+            draw -= q->fenwick[pos];
+        }
+    }
+    PCB *p = q->heap[pos];
+    lottery_remove(q, p);
+    return p;
+}
+
+// Adapters for the policies that live in their own modules
+static int mlfq_enqueue_op(Queue *q, PCB *p) {
+    mlfq_push(&q->mlfq, p);
+    q->count++;
+    return 0;
+}
+
+static PCB *mlfq_pick_op(Queue *q) {
+    PCB *p = mlfq_pop(&q->mlfq, q->clock ? q->clock() : current_tick());
+    if (p) q->count--;
+    return p;
+}
+
+static int mlfq_remove_op(Queue *q, PCB *p) {
+    if (!mlfq_remove(&q->mlfq, p)) return 0;
+    q->count--;
+    return 1;
+}
+
+static int mlfq_quantum_op(Queue *q, PCB *p) {
+    return mlfq_quantum(&q->mlfq, p);
+}
+
+static void mlfq_preempt_op(Queue *q, PCB *p) {
+    mlfq_demote(&q->mlfq, p);
+}
+
+static void mlfq_block_op(Queue *q, PCB *p) {
+    mlfq_promote(&q->mlfq, p);
+}
+
+static void mlfq_for_each(Queue *q, void (*fn)(PCB *, void *), void *ctx) {
+    for (int level = 0; level < q->mlfq.levels; level++) {
+        for (PCB *p = q->mlfq.head[level]; p; p = p->next) fn(p, ctx);
+    }
+}
+
+static int cfs_enqueue_op(Queue *q, PCB *p) {
+    cfs_enqueue(&q->cfs, p);
+    q->count++;
+    return 0;
+}
+
+static PCB *cfs_pick_op(Queue *q) {
+    PCB *p = cfs_pick_next(&q->cfs);
+    if (p) q->count--;
+    return p;
+}
+
+static int cfs_remove_op(Queue *q, PCB *p) {
+    if (!p->rb_parent && q->cfs.root != p) return 0;
+    cfs_remove(&q->cfs, p);
+    q->count--;
+    return 1;
+}
+
+static int cfs_quantum_op(Queue *q, PCB *p) {
+    return cfs_timeslice(&q->cfs, p);
+}
+
+static void cfs_for_each_op(Queue *q, void (*fn)(PCB *, void *), void *ctx) {
+    cfs_for_each(&q->cfs, fn, ctx);
+}
+
+static long fair_now(Queue *q) {
+    return q->clock ? q->clock() : current_tick();
+}
+
+static int fair_enqueue_op(Queue *q, PCB *p) {
+    fair_enqueue(&q->fair, p, fair_now(q));
+    q->count++;
+    return 0;
+}
+
+static PCB *fair_pick_op(Queue *q) {
+    PCB *p = fair_pick_next(&q->fair, fair_now(q));
+    if (p) q->count--;
+    return p;
+}
+
+static int fair_remove_op(Queue *q, PCB *p) {
+    if (!fair_remove(&q->fair, p)) return 0;
+    q->count--;
+    return 1;
+}
+
+static int fair_quantum_op(Queue *q, PCB *p) {
+    return fair_timeslice(&q->fair, p, fair_now(q));
+}
+
+static int fair_on_tick(Queue *q, PCB *p) {
+    return fair_over_quota(&q->fair, p, fair_now(q));
+}
+
+static void fair_on_exit(Queue *q, PCB *p) {
+    fair_charge_exit(&q->fair, p, fair_now(q));
+}
+
+static void fair_for_each_op(Queue *q, void (*fn)(PCB *, void *), void *ctx) {
+    fair_for_each(&q->fair, fn, ctx);
+}
+
+static int o1_enqueue_op(Queue *q, PCB *p) {
+    o1_push(&q->o1, p, fair_now(q));
+    q->count++;
+    return 0;
+}
+
+static PCB *o1_pick_op(Queue *q) {
+    PCB *p = o1_pop(&q->o1, fair_now(q));
+    if (p) q->count--;
+    return p;
+}
+
+static int o1_remove_op(Queue *q, PCB *p) {
+    if (!o1_remove(&q->o1, p)) return 0;
+    q->count--;
+    return 1;
+}
+
+static int o1_quantum_op(Queue *q, PCB *p) {
+    return o1_timeslice(p);
+}
+
+static void o1_preempt_op(Queue *q, PCB *p) {
+    o1_expire(p);
+}
+
+static void o1_for_each_op(Queue *q, void (*fn)(PCB *, void *), void *ctx) {
+    o1_for_each(&q->o1, fn, ctx);
+}
+
+const SchedPolicy sched_policies[POLICY_COUNT] = {
+    [POLICY_PRIORITY] = { "priority", priority_enqueue, priority_pick, priority_remove, fixed_quantum,
+                          NULL, NULL, NULL, NULL, heap_for_each, priority_before },
+    [POLICY_MLFQ]     = { "mlfq", mlfq_enqueue_op, mlfq_pick_op, mlfq_remove_op, mlfq_quantum_op,
+                          NULL, mlfq_preempt_op, mlfq_block_op, NULL, mlfq_for_each, NULL },
+    [POLICY_CFS]      = { "cfs", cfs_enqueue_op, cfs_pick_op, cfs_remove_op, cfs_quantum_op,
+                          NULL, NULL, NULL, NULL, cfs_for_each_op, NULL },
+    [POLICY_FCFS]     = { "fcfs", fifo_enqueue, fifo_pick, fifo_remove, run_to_completion,
+                          NULL, NULL, NULL, NULL, fifo_for_each, NULL },
+    [POLICY_SJF]      = { "sjf", heap_enqueue, heap_pick, heap_remove, run_to_completion,
+                          NULL, NULL, NULL, NULL, heap_for_each, sjf_before },
+    [POLICY_SRTF]     = { "srtf", heap_enqueue, heap_pick, heap_remove, run_to_completion,
+                          srtf_on_tick, NULL, NULL, NULL, heap_for_each, srtf_before },
+    [POLICY_RR]       = { "rr", fifo_enqueue, fifo_pick, fifo_remove, slice_quantum,
+                          NULL, NULL, NULL, NULL, fifo_for_each, NULL },
+    [POLICY_LOTTERY]  = { "lottery", lottery_enqueue, lottery_pick, lottery_remove, slice_quantum,
+                          NULL, NULL, NULL, NULL, heap_for_each, NULL },
+    [POLICY_STRIDE]   = { "stride", stride_enqueue, stride_pick, heap_remove, slice_quantum,
+                          NULL, NULL, NULL, stride_on_wake, heap_for_each, stride_before },
+    [POLICY_EDF]      = { "edf", heap_enqueue, heap_pick, heap_remove, run_to_completion,
+                          edf_on_tick, NULL, NULL, NULL, heap_for_each, edf_before, edf_admit },
+    [POLICY_FAIR]     = { "fair", fair_enqueue_op, fair_pick_op, fair_remove_op, fair_quantum_op,
+                          fair_on_tick, NULL, NULL, NULL, fair_for_each_op, NULL, NULL, fair_on_exit },
+    [POLICY_O1]       = { "o1", o1_enqueue_op, o1_pick_op, o1_remove_op, o1_quantum_op,
+                          NULL, o1_preempt_op, NULL, NULL, o1_for_each_op, NULL },
+};
+
+int sched_policy_lookup(const char *name) {
+    for (int i = 0; i < POLICY_COUNT; i++) {
+        if (strcmp(sched_policies[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+void sched_policy_names(char *buf, int size) {
+    int used = 0;
+    buf[0] = '\0';
+    for (int i = 0; i < POLICY_COUNT && used < size; i++) {
+        used += snprintf(buf + used, size - used, i ? "|%s" : "%s", sched_policies[i].name);
+    }
+}
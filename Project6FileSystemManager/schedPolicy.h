@@ -0,0 +1,37 @@
+#ifndef SCHEDPOLICY_H
+#define SCHEDPOLICY_H
+
+struct PCB;
+struct Queue;
+
+typedef enum {
+    POLICY_PRIORITY, POLICY_MLFQ, POLICY_CFS, POLICY_FCFS, POLICY_SJF,
+    POLICY_SRTF, POLICY_RR, POLICY_LOTTERY, POLICY_STRIDE, POLICY_EDF, POLICY_FAIR, POLICY_O1, POLICY_COUNT
+} SchedPolicyType;
+
+// What a ready-queue policy implements. Every operation runs with the queue
+// lock held and keeps q->count in step; a NULL hook means the policy does not
+// care about that event. Heap-backed policies share one implementation and
+// differ only in their ordering function.
+typedef struct SchedPolicy {
+    const char *name;
+    int (*enqueue)(struct Queue *q, struct PCB *p);
+    struct PCB *(*pick_next)(struct Queue *q);
+    int (*remove)(struct Queue *q, struct PCB *p);          // 1 if p was queued
+    int (*quantum)(struct Queue *q, struct PCB *p);
+    int (*on_tick)(struct Queue *q, struct PCB *p);         // nonzero = preempt p now
+    void (*on_preempt)(struct Queue *q, struct PCB *p);
+    void (*on_block)(struct Queue *q, struct PCB *p);
+    void (*on_wake)(struct Queue *q, struct PCB *p);
+    void (*for_each)(struct Queue *q, void (*fn)(struct PCB *, void *), void *ctx);
+    int (*before)(const struct PCB *a, const struct PCB *b);  // heap order
+    int (*admit)(struct Queue *q, struct PCB *p);           // 0 = reject on arrival
+    void (*on_exit)(struct Queue *q, struct PCB *p);
+} SchedPolicy;
+
+extern const SchedPolicy sched_policies[POLICY_COUNT];
+
+int sched_policy_lookup(const char *name);
+void sched_policy_names(char *buf, int size);
+
+#endif
@@ -7,13 +7,23 @@
 #include <pthread.h>
 #include <signal.h>
 #include "VMmanager.h"
+#include "memGroup.h"
+#include "cacheSim.h"
 #include "advancedScheduler.h"
 #include "fileSystem.h"
+#include "simEngine.h"
+#include "metrics.h"
+#include "trace.h"
+#include "jobLoader.h"
+#include "realSched.h"
+#include "vmSched.h"
+#include "banker.h"
 
 #define MAX_LINE 1024
 #define MAX_ARGS 64
 #define MAX_JOBS 64
 #define MAX_PID_MAP 64
+#define END_GRACE_MS 2000
 
 typedef struct {
     pid_t shell_pid;     // From fork()
@@ -23,6 +33,17 @@ typedef struct {
 PIDMap pid_map[MAX_PID_MAP];
 int pid_map_count = 0;
 
+// Releases the VM address space of a finished command and recycles its map slot
+void release_vm_mapping(pid_t shell_pid) {
+    for (int k = 0; k < pid_map_count; k++) {
+        if (pid_map[k].shell_pid == shell_pid) {
+            free_process(&vmm, pid_map[k].vm_pid);
+            pid_map[k] = pid_map[--pid_map_count];
+            return;
+        }
+    }
+}
+
 
 typedef struct {
     pid_t pid;
@@ -45,6 +66,21 @@ void add_job(pid_t pid, const char *input) {
     }
 }
 
+// SIGTERM first; a job that ignores or handles it and is still running
+// after END_GRACE_MS gets SIGKILL
+void terminate_job(pid_t pid) {
+    kill(pid, SIGTERM);
+    kill(pid, SIGCONT);     // a job stopped by realsched sees the SIGTERM now
+    for (int waited = 0; waited < END_GRACE_MS; waited += 10) {
+        pid_t result = waitpid(pid, NULL, WNOHANG);
+        if (result == pid || result < 0) return;
+        usleep(10000);
+    }
+    printf("[%d] did not exit on SIGTERM, killing it\n", pid);
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+}
+
 void parse_input(char *input, char **args) {
     int i = 0;
     char *token = strtok(input, " \t\r\n");
@@ -125,6 +161,9 @@ void execute_single_command(char **args, int background) {
             close(fd);
         }
 
+        // Under realsched the child waits, stopped, until a CPU dispatches it
+        if (atomic_load(&real_sched_enabled)) raise(SIGSTOP);
+
         if (execvp(args[0], args) == -1) {
             perror("Command failed");
             exit(1);
@@ -132,16 +171,25 @@ void execute_single_command(char **args, int background) {
     }
     else if (pid > 0) {
         // register the command with the scheduler (before wait!)
-        PCB *vm_proc = sched_create_process(2, 1);
-        enqueue(&ready_queue, vm_proc);
-        if (pid_map_count < MAX_PID_MAP) {
+        if (atomic_load(&real_sched_enabled)) {
+            if (real_sched_admit(pid, REAL_DEFAULT_PRIORITY) < 0) return;
+        } else {
+            PCB *vm_proc = sched_create_process(2, 1);
+            trace_record(TRACE_ARRIVE, -1, vm_proc);
+            enqueue(&ready_queue, vm_proc);
+        }
+        int vm_pid = create_process(&vmm);
+        if (vm_pid > 0 && pid_map_count < MAX_PID_MAP) {
             pid_map[pid_map_count].shell_pid = pid;
-            pid_map[pid_map_count].vm_pid = vm_proc->pid;
+            pid_map[pid_map_count].vm_pid = vm_pid;
             pid_map_count++;
+        } else if (vm_pid > 0) {
+            free_process(&vmm, vm_pid);
         }
 
         if (!background) {
             waitpid(pid, NULL, 0);
+            release_vm_mapping(pid);
         }
         else {
             printf("Process running in background with PID %d\n", pid);
@@ -191,12 +239,16 @@ void execute_pipeline(char *line, int background) {
                 close(pipefd[0]);
                 close(pipefd[1]);
             }
+            // Each stage is scheduled on its own, like a single command
+            if (atomic_load(&real_sched_enabled)) raise(SIGSTOP);
             execvp(args[0], args);
             perror("execvp failed");
             exit(1);
         } if (pid > 0) {
             // PARENT
             pids[i] = pid;
+            // A stage that exited before it stopped has been reaped already
+            if (atomic_load(&real_sched_enabled) && real_sched_admit(pid, REAL_DEFAULT_PRIORITY) < 0) pids[i] = -1;
             if (in_fd != 0) close(in_fd);
             if (i < num_cmds - 1) {
                 close(pipefd[1]);
@@ -210,7 +262,7 @@ void execute_pipeline(char *line, int background) {
 
     if (!background) {
         for (int i = 0; i < num_cmds; i++) {
-            waitpid(pids[i], NULL, 0);
+            if (pids[i] > 0) waitpid(pids[i], NULL, 0);
         }
     }
 }
@@ -218,15 +270,40 @@ void execute_pipeline(char *line, int background) {
 
 int main(int argc, char *argv[]) {
     FILE *input_source = stdin;
+    int batch_mode = 0;
+    int batch_arg = 1;
+    int num_cpus = DEFAULT_NUM_CPUS;
+    const char *snapshot = NULL;
+    int lockfree = 0;
+
+    // [-c <cpus>] [-r <snapshot>] [-l] [batch_file]
+    while (batch_arg < argc && argv[batch_arg][0] == '-') {
+        if (strcmp(argv[batch_arg], "-l") == 0) {
+            lockfree = 1;
+            batch_arg++;
+            continue;
+        }
+        if (batch_arg + 1 >= argc) break;
+        if (strcmp(argv[batch_arg], "-c") == 0) num_cpus = atoi(argv[batch_arg + 1]);
+        else if (strcmp(argv[batch_arg], "-r") == 0) snapshot = argv[batch_arg + 1];
+        else break;
+        batch_arg += 2;
+    }
 
-    start_scheduler_threads();
+    initialize();
+    // -r restores a warmed-up VMM instead of starting cold
+    if (snapshot) load_vm_snapshot(snapshot);
 
-    init_file_system();
+    // -l puts the ready and wait queues in lock-free mode
+    if (lockfree && (queue_enable_lockfree(&ready_queue) < 0 || queue_enable_lockfree(&wait_queue) < 0)) {
+        perror("lock-free queues");
+    }
+    start_scheduler_threads(num_cpus);
 
-    int batch_mode = 0;
+    init_file_system();
 
-    if (argc == 2) {
-        input_source = fopen(argv[1], "r");
+    if (argc == batch_arg + 1) {
+        input_source = fopen(argv[batch_arg], "r");
         if (!input_source) {
             perror("Failed to open batch file");
             exit(1);
@@ -245,13 +322,7 @@ int main(int argc, char *argv[]) {
                 if (result > 0) {
                     jobs[j].active = 0;
                     printf("[Completed] PID %d - %s\n", jobs[j].pid, jobs[j].command);
-
-                    for (int k = 0; k < pid_map_count; k++) {
-                        if (pid_map[k].shell_pid == jobs[j].pid) {
-                            free_process(pid_map[k].vm_pid);
-                            break;
-                        }
-                    }
+                    release_vm_mapping(jobs[j].pid);
                 }
             }
         }
@@ -312,13 +383,216 @@ int main(int argc, char *argv[]) {
             if (strcmp(args[0], "end") == 0) {
                 for (int j = 0; j < job_count; j++) {
                     if (jobs[j].active) {
-                        kill(jobs[j].pid, SIGTERM);
+                        terminate_job(jobs[j].pid);
                         jobs[j].active = 0;
+                        release_vm_mapping(jobs[j].pid);
                     }
                 }
                 printf("All background jobs terminated.\n");
                 continue;
             }
+            if (strcmp(args[0], "procs") == 0) {
+                display_procs(args[1] && strcmp(args[1], "-d") == 0);
+                continue;
+            }
+
+            if (strcmp(args[0], "realsched") == 0) {
+                if (args[1] && strcmp(args[1], "on") == 0) atomic_store(&real_sched_enabled, 1);
+                else if (args[1] && strcmp(args[1], "off") == 0) atomic_store(&real_sched_enabled, 0);
+                else if (args[1]) { printf("Usage: realsched [on|off]\n"); continue; }
+                print_real_sched();
+                continue;
+            }
+
+            if (strcmp(args[0], "loadjobs") == 0) {
+                if (!args[1]) {
+                    printf("Usage: loadjobs [-f] <job_file> | loadjobs status | loadjobs stop <id>\n");
+                } else if (strcmp(args[1], "status") == 0) {
+                    print_job_loaders();
+                } else if (strcmp(args[1], "stop") == 0) {
+                    if (!args[2]) printf("Usage: loadjobs stop <id>\n");
+                    else job_loader_stop(atoi(args[2]));
+                } else if (strcmp(args[1], "-f") == 0) {
+                    if (!args[2]) printf("Usage: loadjobs -f <job_file>\n");
+                    else job_loader_start(args[2], 1);
+                } else {
+                    job_loader_start(args[1], 0);
+                }
+                continue;
+            }
+
+            if (strcmp(args[0], "simulate") == 0) {
+                if (!args[1]) {
+                    printf("Usage: simulate <job_file> [cpus] [fast|realtime] [tick_ms]\n");
+                } else {
+                    int sim_cpus = args[2] ? atoi(args[2]) : DEFAULT_NUM_CPUS;
+                    int realtime = args[3] && strcmp(args[3], "realtime") == 0;
+                    run_simulation(args[1], sim_cpus, realtime, args[4] ? atoi(args[4]) : 1000);
+                }
+                continue;
+            }
+
+            if (strcmp(args[0], "schedbench") == 0) {
+                int max_cpus = args[1] ? atoi(args[1]) : 8;
+                int bench_jobs = args[2] ? atoi(args[2]) : 100000;
+                if (max_cpus < 1 || bench_jobs < 1) { printf("Usage: schedbench [max_cpus] [jobs]\n"); }
+                else { run_dispatch_benchmark(max_cpus, bench_jobs); }
+                continue;
+            }
+
+            if (strcmp(args[0], "trace") == 0) {
+                const char *sub = args[1] ? args[1] : "status";
+                if (strcmp(sub, "start") == 0) { trace_start(); printf("[Trace] Recording\n"); }
+                else if (strcmp(sub, "stop") == 0) { trace_stop(); trace_print_status(); }
+                else if (strcmp(sub, "status") == 0) { trace_print_status(); }
+                else if (strcmp(sub, "save") == 0 && args[2]) { trace_save(&trace_log, args[2]); }
+                else if (strcmp(sub, "load") == 0 && args[2]) { trace_load(&trace_log, args[2]); }
+                else if (strcmp(sub, "chrome") == 0 && args[2]) { trace_export_chrome(&trace_log, args[2]); }
+                else if (strcmp(sub, "gantt") == 0) { trace_print_gantt(&trace_log, args[2] ? atoi(args[2]) : 72); }
+                else if (strcmp(sub, "replay") == 0 && args[2] && sched_policy_lookup(args[2]) >= 0) {
+                    int replay_cpus = args[3] ? atoi(args[3]) : DEFAULT_NUM_CPUS;
+                    int replay_slice = args[3] && args[4] ? atoi(args[4]) : 0;
+                    trace_replay(&trace_log, sched_policy_lookup(args[2]), replay_cpus, replay_slice, 72);
+                } else {
+                    printf("Usage: trace start | stop | status | save <file> | load <file> | chrome <file> | gantt [width]"
+                           " | replay <policy> [cpus] [slice]\n");
+                }
+                continue;
+            }
+
+            if (strcmp(args[0], "schedstat") == 0) {
+                if (!args[1]) { print_sched_stats(); }
+                else if (strcmp(args[1], "reset") == 0) { metrics_reset(); }
+                else if (strcmp(args[1], "csv") == 0 && args[2]) { metrics_export_csv(args[2]); }
+                else if (strcmp(args[1], "json") == 0 && args[2]) { metrics_export_json(args[2]); }
+                else { printf("Usage: schedstat [reset | csv <file> | json <file>]\n"); }
+                continue;
+            }
+
+            if (strcmp(args[0], "poolstat") == 0) {
+                print_pool_stats();
+                continue;
+            }
+
+            if (strcmp(args[0], "qbench") == 0) {
+                int max_threads = args[1] ? atoi(args[1]) : 64;
+                int ops = args[2] ? atoi(args[2]) : 1000000;
+                if (max_threads < 1 || ops < 1) { printf("Usage: qbench [max_threads] [ops]\n"); }
+                else { run_queue_benchmark(max_threads, ops); }
+                continue;
+            }
+
+            if (strcmp(args[0], "policy") == 0) {
+                int policy = args[1] ? sched_policy_lookup(args[1]) : -1;
+                if (policy < 0) {
+                    char names[128];
+                    sched_policy_names(names, sizeof(names));
+                    printf("Usage: policy <%s> [slice]\n", names);
+                } else {
+                    if (args[2]) set_policy_slice(&ready_queue, atoi(args[2]));
+                    set_sched_policy(&ready_queue, policy);
+                }
+                continue;
+            }
+
+            if (strcmp(args[0], "edf") == 0) {
+                if (args[1] && strcmp(args[1], "stat") == 0) {
+                    pthread_mutex_lock(&ready_queue.lock);
+                    edf_print(&ready_queue.edf, args[2] && strcmp(args[2], "-t") == 0);
+                    pthread_mutex_unlock(&ready_queue.lock);
+                } else if (args[1] && strcmp(args[1], "reset") == 0) {
+                    pthread_mutex_lock(&ready_queue.lock);
+                    edf_clear_stats(&ready_queue.edf);
+                    pthread_mutex_unlock(&ready_queue.lock);
+                } else {
+                    printf("Usage: edf stat [-t] | edf reset\n");
+                }
+                continue;
+            }
+
+            if (strcmp(args[0], "iostat") == 0) {
+                if (args[1] && strcmp(args[1], "reset") == 0) { io_stats_reset(); }
+                else { print_io_stats(); }
+                continue;
+            }
+
+            if (strcmp(args[0], "iodev") == 0) {
+                int sched = IO_SCHED_ELEVATOR;
+                if (args[1] && strcmp(args[1], "add") == 0 && args[2] && args[3] &&
+                    (!args[4] || (sched = io_sched_lookup(args[4])) >= 0)) {
+                    if (io_device_create(args[2], args[3], sched)) printf("Added I/O device %s\n", args[2]);
+                } else if (args[1] && strcmp(args[1], "sched") == 0 && args[2] && args[3] &&
+                           (sched = io_sched_lookup(args[3])) >= 0) {
+                    IoDevice *d = io_device_find(args[2]);
+                    if (d) { io_device_set_sched(d, sched); }
+                    else { printf("No I/O device '%s'\n", args[2]); }
+                } else {
+                    printf("Usage: iodev add <name> <hdd|ssd> [fifo|deadline|elevator] | iodev sched <name> <fifo|deadline|elevator>\n");
+                }
+                continue;
+            }
+
+            if (strcmp(args[0], "cfs") == 0) {
+                if (args[1] && strcmp(args[1], "stat") == 0) { print_cfs_stats(&ready_queue); }
+                else if (args[1] && args[2]) { configure_cfs(&ready_queue, atoi(args[1]), atoi(args[2])); }
+                else { printf("Usage: cfs <target_latency> <min_granularity> | cfs stat\n"); }
+                continue;
+            }
+
+            // fsgroup add <name> [weight] [quota period] | set <name> <weight> [quota period] | stat
+            if (strcmp(args[0], "fsgroup") == 0) {
+                int adding = args[1] && strcmp(args[1], "add") == 0;
+                if (args[1] && strcmp(args[1], "stat") == 0) {
+                    print_fair_share(&ready_queue);
+                } else if ((adding || (args[1] && strcmp(args[1], "set") == 0)) && args[2] &&
+                           (adding || args[3]) && (!args[4] || args[5])) {
+                    long weight = args[3] ? atol(args[3]) : FS_DEFAULT_WEIGHT;
+                    int quota = args[4] ? atoi(args[4]) : 0, period = args[4] ? atoi(args[5]) : 0;
+                    if (adding) {
+                        int id = fair_group_create(args[2], weight, quota, period);
+                        if (id >= 0) printf("[Fair] Group %s (id %d), weight %ld\n", args[2], id, weight);
+                    } else if (fair_group_find(args[2]) < 0) {
+                        printf("No group '%s'\n", args[2]);
+                    } else {
+                        fair_group_set(fair_group_find(args[2]), weight, quota, period);
+                    }
+                } else {
+                    printf("Usage: fsgroup add <name> [weight] [quota period] | fsgroup set <name> <weight> [quota period] | fsgroup stat\n");
+                }
+                continue;
+            }
+
+            if (strcmp(args[0], "quantum") == 0) {
+                if (args[1]) { set_slice_ms(atoi(args[1])); }
+                print_quantum_stats();
+                continue;
+            }
+
+            if (strcmp(args[0], "o1") == 0) {
+                if (args[1] && strcmp(args[1], "stat") == 0) { print_o1_stats(&ready_queue); }
+                else if (args[1] && args[2]) { configure_o1(&ready_queue, atoi(args[1]), atoi(args[2])); }
+                else { printf("Usage: o1 <age_interval> <starvation_limit> | o1 stat\n"); }
+                continue;
+            }
+
+            if (strcmp(args[0], "aging") == 0) {
+                if (args[1]) { configure_aging(&ready_queue, atoi(args[1])); }
+                print_aging(&ready_queue);
+                continue;
+            }
+
+            if (strcmp(args[0], "mlfq") == 0) {
+                if (!args[1] || !args[2]) {
+                    printf("Usage: mlfq <levels> <boost_interval> [quantum0 quantum1 ...]\n");
+                } else {
+                    int quanta[MLFQ_MAX_LEVELS] = {0};
+                    for (int k = 0; k < MLFQ_MAX_LEVELS && args[k + 3]; k++) quanta[k] = atoi(args[k + 3]);
+                    configure_mlfq(&ready_queue, atoi(args[1]), quanta, atoi(args[2]));
+                    printf("MLFQ: %d levels, boost every %d ticks\n", ready_queue.mlfq.levels, ready_queue.mlfq.boost_interval);
+                }
+                continue;
+            }
+
             if (strcmp(args[0], "memaccess") == 0) {
                 if (args[1] && args[2] && args[3]) {
                     pid_t spid = atoi(args[1]);
@@ -327,8 +601,10 @@ int main(int argc, char *argv[]) {
 
                     for (int k = 0; k < pid_map_count; k++) {
                         if (pid_map[k].shell_pid == spid) {
-                            int vm_pid = pid_map[k].vm_pid;
-                            access_memory(&processes[vm_pid - 1], vm_pid, vaddr, mode);
+                            vm_lock(&vmm);
+                            Process *process = find_process(&vmm, pid_map[k].vm_pid);
+                            if (process) access_memory(&vmm, process, vaddr / PAGE_SIZE, vaddr % PAGE_SIZE, mode);
+                            vm_unlock(&vmm);
                             break;
                         }
                     }
@@ -336,6 +612,128 @@ int main(int argc, char *argv[]) {
                 continue;
             }
 
+            if (strcmp(args[0], "bank") == 0) {
+                if (args[1] && strcmp(args[1], "init") == 0 && args[2]) {
+                    int total[BANK_MAX_RESOURCES], m = 0;
+                    for (int k = 2; args[k] && m < BANK_MAX_RESOURCES; k++) total[m++] = atoi(args[k]);
+                    if (bank_set_totals(&bank, total, m) < 0) { printf("Resources are still claimed, try again when idle\n"); }
+                    else { printf("[Bank] %d resource types\n", m); }
+                } else if (args[1] && strcmp(args[1], "avoid") == 0 && args[2] &&
+                           (strcmp(args[2], "on") == 0 || strcmp(args[2], "off") == 0)) {
+                    if (bank_set_avoid(&bank, strcmp(args[2], "on") == 0) < 0) { printf("Resources are still claimed, try again when idle\n"); }
+                } else if (args[1] && strcmp(args[1], "stat") == 0) {
+                    print_bank(&bank);
+                } else if (args[1] && strcmp(args[1], "bench") == 0) {
+                    run_bank_benchmark(args[2] ? atoi(args[2]) : 5000, args[3] ? atoi(args[3]) : 32,
+                                       args[4] ? atoi(args[4]) : 200000);
+                } else {
+                    printf("Usage: bank init <total0> [total1 ...] | bank avoid <on|off> | bank stat | bank bench [clients] [types] [requests]\n");
+                }
+                continue;
+            }
+
+            if (strcmp(args[0], "vmsched") == 0) {
+                if (args[1] && strcmp(args[1], "tlb") == 0 && args[2] &&
+                    (strcmp(args[2], "flush") == 0 || strcmp(args[2], "tagged") == 0)) {
+                    tlb_set_mode(&vmm, strcmp(args[2], "tagged") == 0 ? TLB_TAGGED : TLB_FLUSH);
+                    printf("[VM] TLB is now %s on address space switches\n", args[2]);
+                } else if (args[1] && strcmp(args[1], "stat") == 0) {
+                    print_vm_sched(&vmm, &paging_disk, current_tick(), atomic_load(&sched_metrics.completed));
+                } else {
+                    printf("Usage: vmsched tlb <flush|tagged> | vmsched stat\n");
+                }
+                continue;
+            }
+
+            if (strcmp(args[0], "memgroup") == 0) {
+                if (args[1] && strcmp(args[1], "create") == 0 && args[2] && args[3] && args[4]) {
+                    MemGroup *parent = args[5] ? mem_group_find(args[5]) : root_mem_group;
+                    if (!parent) { printf("Unknown memory group: %s\n", args[5]); }
+                    else if (mem_group_create(args[2], atoi(args[3]), atoi(args[4]), parent)) {
+                        printf("Memory group '%s' created under '%s'\n", args[2], parent->name);
+                    }
+                } else if (args[1] && strcmp(args[1], "attach") == 0 && args[2] && args[3]) {
+                    pid_t spid = atoi(args[2]);
+                    MemGroup *group = mem_group_find(args[3]);
+                    Process *process = NULL;
+                    vm_lock(&vmm);
+                    for (int k = 0; k < pid_map_count; k++) {
+                        if (pid_map[k].shell_pid == spid) process = find_process(&vmm, pid_map[k].vm_pid);
+                    }
+                    if (!group) { printf("Unknown memory group: %s\n", args[3]); }
+                    else if (!process) { printf("No VM process for PID %d\n", spid); }
+                    else {
+                        set_process_group(&vmm, process, group);
+                        printf("PID %d attached to memory group '%s'\n", spid, group->name);
+                    }
+                    vm_unlock(&vmm);
+                } else if (args[1] && strcmp(args[1], "stat") == 0) {
+                    print_mem_groups();
+                } else {
+                    printf("Usage: memgroup create <name> <hard_limit> <soft_limit> [parent]\n");
+                    printf("       memgroup attach <shell_pid> <name>\n");
+                    printf("       memgroup stat\n");
+                }
+                continue;
+            }
+
+            if (strcmp(args[0], "vmsnap") == 0) {
+                if (args[1] && args[2] && strcmp(args[1], "save") == 0) { save_vm_snapshot(args[2]); }
+                else if (args[1] && args[2] && strcmp(args[1], "load") == 0) { load_vm_snapshot(args[2]); }
+                else if (args[1] && strcmp(args[1], "list") == 0) { print_vm_processes(&vmm); }
+                else if (args[1] && args[2] && args[3] && strcmp(args[1], "attach") == 0) {
+                    // The command's own, still fresh, address space gives way to the restored one
+                    int vm_pid = atoi(args[2]);
+                    pid_t spid = atoi(args[3]);
+                    int k = 0;
+                    while (k < pid_map_count && pid_map[k].shell_pid != spid) k++;
+                    if (k == pid_map_count) { printf("No VM process for PID %d\n", spid); }
+                    else if (vm_attach_process(&vmm, vm_pid) < 0) { printf("No restored VM process %d\n", vm_pid); }
+                    else {
+                        free_process(&vmm, pid_map[k].vm_pid);
+                        pid_map[k].vm_pid = vm_pid;
+                        printf("PID %d now runs in restored VM process %d\n", spid, vm_pid);
+                    }
+                }
+                else {
+                    printf("Usage: vmsnap <save|load> <file> | vmsnap list\n");
+                    printf("       vmsnap attach <vm_pid> <shell_pid>\n");
+                }
+                continue;
+            }
+
+            if (strcmp(args[0], "cache") == 0) {
+                if (args[1] && strcmp(args[1], "stat") == 0) {
+                    print_cache_stats();
+                } else if (args[1] && strcmp(args[1], "reset") == 0) {
+                    cache_reset();
+                } else if (args[1] && strcmp(args[1], "level") == 0 && args[2] && args[3]) {
+                    int size = atoi(args[3]);
+                    if (size != 0 && (!args[4] || !args[5])) { printf("Usage: cache level <n> <size> <ways> <latency>\n"); }
+                    else if (cache_configure_level(atoi(args[2]), size, size ? atoi(args[4]) : 0,
+                                                   size ? atoi(args[5]) : 0) < 0) {
+                        printf("Invalid cache level geometry\n");
+                    }
+                } else if (args[1] && strcmp(args[1], "line") == 0 && args[2]) {
+                    if (cache_set_line_size(atoi(args[2])) < 0) printf("Invalid line size: %s\n", args[2]);
+                } else if (args[1] && strcmp(args[1], "memlat") == 0 && args[2]) {
+                    cache_set_memory_latency(atoi(args[2]));
+                } else if (args[1] && strcmp(args[1], "policy") == 0 && args[2]) {
+                    if (strcmp(args[2], "inclusive") == 0) cache_set_inclusion(CACHE_INCLUSIVE);
+                    else if (strcmp(args[2], "exclusive") == 0) cache_set_inclusion(CACHE_EXCLUSIVE);
+                    else if (strcmp(args[2], "nine") == 0) cache_set_inclusion(CACHE_NINE);
+                    else printf("Unknown inclusion policy: %s\n", args[2]);
+                } else if (args[1] && strcmp(args[1], "trace") == 0 && args[2]) {
+                    if (cache_run_trace(args[2], args[3] && strcmp(args[3], "bin") == 0) == 0) print_cache_stats();
+                } else {
+                    printf("Usage: cache stat | reset | line <bytes> | memlat <cycles>\n");
+                    printf("       cache level <n> <size> <ways> <latency>   (size 0 removes the level)\n");
+                    printf("       cache policy <inclusive|exclusive|nine>\n");
+                    printf("       cache trace <file> [bin]\n");
+                }
+                continue;
+            }
+
             if (strcmp(args[0], "create") == 0) {
                 if (args[1] == NULL) { printf("Usage: create <file_name>\n"); }
                 else { create_file(args[1]); }
@@ -0,0 +1,426 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <limits.h>
+#include "simEngine.h"
+#include "jobLoader.h"
+#include "VMmanager.h"
+
+// The queue's policy clock has to be the virtual one while a simulation runs
+static SimEngine *active_sim = NULL;
+
+static long sim_clock() {
+    return active_sim ? active_sim->now : 0;
+}
+
+static void sim_bank_wake(PCB *p, void *ctx) {
+    SimEngine *sim = ctx;
+    sim_post(sim, sim->now, EV_RESOURCE_GRANTED, -1, p);
+}
+
+void sim_init(SimEngine *sim, int num_cpus, int realtime, int tick_ms) {
+    memset(sim, 0, sizeof(SimEngine));
+    if (num_cpus < 1) num_cpus = 1;
+    if (num_cpus > MAX_CPUS) num_cpus = MAX_CPUS;
+    sim->num_cpus = num_cpus;
+    sim->realtime = realtime;
+    sim->tick_ms = tick_ms > 0 ? tick_ms : 1000;
+    sim->io_latency = 3;
+    sim->io_chance = 5;
+    sim->seed = 1;
+
+    // Same policy and tuning as the live ready queue. Only the settings are
+    // read; the live lists and trees are never copied.
+    pthread_mutex_init(&sim->ready.lock, NULL);
+    event_init(&sim->ready.changed);
+    sim->ready.ordered = 1;
+    int mlfq_levels, mlfq_quantum[MLFQ_MAX_LEVELS], mlfq_boost;
+    int target_latency, min_granularity, o1_set, o1_age, o1_limit;
+    pthread_mutex_lock(&ready_queue.lock);
+    sim->ready.policy = ready_queue.policy;
+    sim->ready.slice = ready_queue.slice;
+    sim->ready.age_interval = ready_queue.age_interval;
+    mlfq_levels = ready_queue.mlfq.levels;
+    memcpy(mlfq_quantum, ready_queue.mlfq.quantum, sizeof(mlfq_quantum));
+    mlfq_boost = ready_queue.mlfq.boost_interval;
+    target_latency = ready_queue.cfs.target_latency;
+    min_granularity = ready_queue.cfs.min_granularity;
+    o1_set = ready_queue.o1.initialized;
+    o1_age = ready_queue.o1.age_interval;
+    o1_limit = ready_queue.o1.starvation_limit;
+    pthread_mutex_unlock(&ready_queue.lock);
+    cfs_init(&sim->ready.cfs, target_latency, min_granularity);
+    fair_init(&sim->ready.fair, target_latency, min_granularity);
+    sim->refill_posted = -1;
+    sim->next_pid = 1;
+    sim->paging = (PagingDisk){ 0, 0 };
+    pthread_mutex_lock(&bank.lock);
+    bank_init(&sim->bank, bank.total, bank.m);
+    sim->bank.avoid = bank.avoid;
+    pthread_mutex_unlock(&bank.lock);
+    sim->bank.on_wake = sim_bank_wake;
+    sim->bank.ctx = sim;
+    if (o1_set) o1_init(&sim->ready.o1, o1_age, o1_limit);
+    else o1_init(&sim->ready.o1, O1_DEFAULT_AGE_INTERVAL, O1_DEFAULT_STARVATION_LIMIT);
+    if (sim->ready.policy == POLICY_MLFQ) mlfq_init(&sim->ready.mlfq, mlfq_levels, mlfq_quantum, mlfq_boost);
+    sim->ready.edf.capacity = num_cpus;
+    sim->ready.clock = sim_clock;
+    // Memory runs on a VMM of its own with the shell's TLB mode and group
+    // limits, so the shell's frames, TLB and counters are left alone
+    vm_lock(&vmm);
+    mem_group_copy_tree(sim->mem_groups);
+    vmm_init(&sim->vmm, &sim->mem_groups[0]);
+    sim->vmm.tlb_mode = vmm.tlb_mode;
+    vm_unlock(&vmm);
+}
+
+void sim_destroy(SimEngine *sim) {
+    PCB *p;
+    sim->ready.fair.draining = 1;
+    while ((p = dequeue(&sim->ready))) pcb_free(p);
+    for (int i = 0; i < sim->event_count; i++) {
+        // Arrivals and blocked PCBs are owned by their pending event
+        if (sim->events[i].type == EV_ARRIVAL || sim->events[i].type == EV_IO_COMPLETE ||
+            sim->events[i].type == EV_PAGE_FAULT_COMPLETE || sim->events[i].type == EV_RESOURCE_GRANTED) {
+            pcb_free(sim->events[i].pcb);
+        }
+    }
+    for (int i = 0; i < sim->num_cpus; i++) pcb_free(sim->running[i]);
+    // Deadlocked PCBs, listed first since freeing one may grant another
+    int stuck = sim->bank.pending, n = 0;
+    PCB **blocked = stuck ? malloc(stuck * sizeof(PCB *)) : NULL;
+    if (blocked) {
+        for (int j = 0; j <= BANK_UNSAFE_LIST; j++) {
+            for (BankClient *c = sim->bank.pending_head[j]; c; c = c->next_pending) blocked[n++] = c->pcb;
+        }
+        sim->bank.on_wake = NULL;
+        for (int i = 0; i < n; i++) pcb_free(blocked[i]);
+        free(blocked);
+    }
+    bank_destroy(&sim->bank);
+    vmm_destroy(&sim->vmm);
+    free(sim->events);
+    queue_release(&sim->ready);
+    edf_reset(&sim->ready.edf);
+    pthread_mutex_destroy(&sim->ready.lock);
+    memset(sim, 0, sizeof(SimEngine));
+}
+
+static int event_before(const SimEvent *a, const SimEvent *b) {
+    if (a->time != b->time) return a->time < b->time;
+    return a->seq < b->seq;
+}
+
+void sim_post(SimEngine *sim, long time, SimEventType type, int cpu, PCB *p) {
+    if (sim->event_count == sim->event_capacity) {
+        int capacity = sim->event_capacity ? sim->event_capacity * 2 : 256;
+        SimEvent *events = realloc(sim->events, capacity * sizeof(SimEvent));
+        if (!events) {
+            perror("sim_post");
+            return;
+        }
+        sim->events = events;
+        sim->event_capacity = capacity;
+    }
+    int i = sim->event_count++;
+    SimEvent ev = { time, sim->next_seq++, type, cpu, p };
+    while (i > 0 && event_before(&ev, &sim->events[(i - 1) / 2])) {
+        sim->events[i] = sim->events[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    sim->events[i] = ev;
+}
+
+static SimEvent sim_pop(SimEngine *sim) {
+    SimEvent top = sim->events[0];
+    SimEvent last = sim->events[--sim->event_count];
+    int i = 0;
+    while (1) {
+        int child = 2 * i + 1;
+        if (child >= sim->event_count) break;
+        if (child + 1 < sim->event_count && event_before(&sim->events[child + 1], &sim->events[child])) child++;
+        if (!event_before(&sim->events[child], &last)) break;
+        sim->events[i] = sim->events[child];
+        i = child;
+    }
+    if (sim->event_count > 0) sim->events[i] = last;
+    return top;
+}
+
+// Virtual ticks are stamped as SCHED_TICK_MS each, like live traces
+static void sim_trace(SimEngine *sim, TraceType type, int cpu, PCB *p) {
+    if (sim->trace && trace_append(sim->trace, type, cpu, p, (uint64_t)sim->now * SCHED_TICK_MS * 1000) < 0) {
+        perror("sim_trace");
+        sim->trace = NULL;
+    }
+}
+
+static void make_ready(SimEngine *sim, PCB *p) {
+    p->state = READY;
+    p->ready_since = sim->now;
+    enqueue(&sim->ready, p);
+}
+
+// Plays the same per-tick rules as scheduler_loop() forward until the burst
+// ends, and posts a single event for however it ends
+static void dispatch(SimEngine *sim, int cpu) {
+    PCB *p = dequeue_allowed(&sim->ready, cpu);
+    if (!p) return;
+    sim->running[cpu] = p;
+    sim->dispatches++;
+    p->state = RUNNING;
+    p->last_cpu = cpu;
+    p->wait_time += sim->now - p->ready_since;
+    sim_trace(sim, TRACE_DISPATCH, cpu, p);
+
+    int quantum = queue_quantum(&sim->ready, p);
+    // A preemptive policy has to look again whenever another event lands,
+    // so the burst is cut at the next pending event
+    long horizon = LONG_MAX;
+    if (queue_preempts_on_arrival(&sim->ready) && sim->event_count > 0) horizon = sim->events[0].time - sim->now;
+    int ran = 0;
+    SimEventType outcome;
+    while (1) {
+        ran++;
+        p->cpu_time_used++;
+        if (p->cpu_time_used >= p->time_limit) { outcome = EV_EXIT; break; }
+        // The accesses happen when the burst is planned, which is exact on
+        // one CPU and close enough on several
+        if (vm_sched_run_tick(&sim->vmm, p)) { outcome = EV_PAGE_FAULT; break; }
+        // A job building up its claim asks for one more unit per tick
+        if (bank_wants(p)) { outcome = EV_RESOURCE_REQUEST; break; }
+        // Replayed and burst-pattern jobs block exactly at their script points
+        TraceScript *script = p->script;
+        int chance = p->io_chance ? p->io_chance : sim->io_chance;
+        if (script ? script->next < script->count && p->cpu_time_used == script->at_used[script->next]
+                   : chance > 0 && rand_r(&sim->seed) % chance == 0) { outcome = EV_IO_REQUEST; break; }
+        if (ran >= quantum || ran >= horizon || queue_on_tick(&sim->ready, p)) { outcome = EV_QUANTUM_EXPIRY; break; }
+    }
+    sim->busy_ticks[cpu] += ran;
+    sim_post(sim, sim->now + ran, outcome, cpu, p);
+    if (sim->realtime) printf("[Sim %ld] CPU %d runs PID %d for %d ticks\n", sim->now, cpu, p->pid, ran);
+}
+
+// Takes the PCB running on a CPU off it and blocks it until its page arrives
+void sim_block_on_page_fault(SimEngine *sim, int cpu, long latency) {
+    PCB *p = sim->running[cpu];
+    if (!p) return;
+    sim->running[cpu] = NULL;
+    p->state = WAITING;
+    sim_trace(sim, TRACE_BLOCK, cpu, p);
+    queue_on_block(&sim->ready, p);
+    sim_post(sim, sim->now + latency, EV_PAGE_FAULT_COMPLETE, cpu, p);
+}
+
+static void handle_event(SimEngine *sim, SimEvent *ev) {
+    PCB *p = ev->pcb;
+    switch (ev->type) {
+    case EV_ARRIVAL:
+        if (queue_admit(&sim->ready, p) < 0) {
+            if (sim->realtime) printf("[Sim %ld] PID %d rejected by admission control\n", sim->now, p->pid);
+            pcb_free(p);
+            break;
+        }
+        sim_trace(sim, TRACE_ARRIVE, -1, p);
+        make_ready(sim, p);
+        break;
+    case EV_QUANTUM_EXPIRY:
+        sim->running[ev->cpu] = NULL;
+        sim_trace(sim, TRACE_PREEMPT, ev->cpu, p);
+        queue_on_preempt(&sim->ready, p);
+        make_ready(sim, p);
+        break;
+    case EV_IO_REQUEST: {
+        sim->running[ev->cpu] = NULL;
+        p->state = WAITING;
+        sim_trace(sim, TRACE_BLOCK, ev->cpu, p);
+        queue_on_block(&sim->ready, p);
+        long latency = sim->io_latency;
+        if (p->script && p->script->next < p->script->count) {
+            long scripted = p->script->latency[p->script->next++];
+            if (scripted > 0) latency = scripted;
+        }
+        sim_post(sim, sim->now + latency, EV_IO_COMPLETE, ev->cpu, p);
+        break;
+    }
+    case EV_PAGE_FAULT:
+        sim_block_on_page_fault(sim, ev->cpu, paging_disk_reserve(&sim->vmm, &sim->paging, sim->now));
+        break;
+    case EV_RESOURCE_REQUEST:
+        sim->running[ev->cpu] = NULL;
+        if (bank_step(&sim->bank, p) == BANK_BLOCKED) {
+            p->state = WAITING;
+            sim_trace(sim, TRACE_BLOCK, ev->cpu, p);
+            queue_on_block(&sim->ready, p);
+        } else {
+            sim_trace(sim, TRACE_PREEMPT, ev->cpu, p);
+            make_ready(sim, p);
+        }
+        break;
+    case EV_EXIT:
+        sim->running[ev->cpu] = NULL;
+        if (p->bank_client) bank_release_all(&sim->bank, p);
+        p->state = TERMINATED;
+        sim_trace(sim, TRACE_EXIT, ev->cpu, p);
+        sim->completed++;
+        sim->total_turnaround += sim->now - p->arrival_time;
+        sim->total_waiting += p->wait_time;
+        if (sim->realtime) printf("[Sim %ld] PID %d completed\n", sim->now, p->pid);
+        if (queue_on_exit(&sim->ready, p)) {
+            sim_post(sim, p->arrival_time > sim->now ? p->arrival_time : sim->now, EV_ARRIVAL, -1, p);
+        } else {
+            pcb_free(p);
+        }
+        break;
+    case EV_IO_COMPLETE:
+    case EV_PAGE_FAULT_COMPLETE:
+    case EV_RESOURCE_GRANTED:
+        vm_sched_fault_done(p);
+        sim_trace(sim, TRACE_WAKE, -1, p);
+        queue_on_wake(&sim->ready, p);
+        make_ready(sim, p);
+        break;
+    case EV_QUOTA_REFILL:
+        // Nothing to do: the dispatch pass after it picks the group up
+        sim->refill_posted = -1;
+        break;
+    }
+}
+
+// Waits until wall time catches up with the virtual clock
+static void pace(SimEngine *sim, struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long elapsed_ms = (now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000;
+    long target_ms = sim->now * sim->tick_ms;
+    if (target_ms > elapsed_ms) usleep((target_ms - elapsed_ms) * 1000);
+}
+
+void sim_run(SimEngine *sim) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    SimEngine *previous = active_sim;
+    active_sim = sim;
+
+    while (sim->event_count > 0) {
+        SimEvent ev = sim_pop(sim);
+        sim->now = ev.time;
+        if (sim->realtime) pace(sim, &start);
+        handle_event(sim, &ev);
+        sim->events_processed++;
+
+        // Fairness is sampled rather than tracked, it walks the whole tree
+        if (sim->ready.policy == POLICY_CFS && sim->events_processed % 1000 == 0 && sim->ready.count > 1) {
+            double jain, lag;
+            cfs_fairness(&sim->ready.cfs, sim->now, &jain, &lag);
+            sim->fairness_sum += jain;
+            sim->fairness_samples++;
+            if (lag > sim->max_vruntime_lag) sim->max_vruntime_lag = lag;
+        }
+
+        // Drain everything due at this instant before dispatching, so
+        // simultaneous arrivals compete under the policy
+        if (sim->event_count > 0 && sim->events[0].time == sim->now) continue;
+        int idle = 0;
+        for (int cpu = 0; cpu < sim->num_cpus; cpu++) {
+            if (!sim->running[cpu]) dispatch(sim, cpu);
+            if (!sim->running[cpu]) idle = 1;
+        }
+        // Work held back by a quota needs an event to come back at
+        if (idle && sim->ready.count > 0 && sim->refill_posted < 0) {
+            long refill = queue_next_refill(&sim->ready);
+            if (refill != LONG_MAX) {
+                sim->refill_posted = refill > sim->now ? refill : sim->now + 1;
+                sim_post(sim, sim->refill_posted, EV_QUOTA_REFILL, -1, NULL);
+            }
+        }
+    }
+    active_sim = previous;
+}
+
+// Same job format as the live loader; SLEEP advances the arrival clock
+// instead of blocking, so it costs nothing in fast mode
+int sim_load_jobs(SimEngine *sim, const char *filename) {
+    JobFile file;
+    if (job_file_open(&file, filename, 0) < 0) {
+        perror("Simulation job file error");
+        return -1;
+    }
+    JobRecord r;
+    RecordType type;
+    long arrival = 0;
+    int loaded = 0;
+    while ((type = job_file_next(&file, &r)) != REC_END) {
+        if (type == REC_SLEEP) {
+            arrival += r.sleep;
+        } else if (type == REC_POLICY) {
+            apply_batch_policy(&sim->ready, r.policy);
+        } else if (type == REC_JOB) {
+            PCB *p = job_record_to_pcb(&r, sim->next_pid++);
+            if (!p) continue;
+            p->arrival_time = arrival + r.arrival;
+            sim_post(sim, p->arrival_time, EV_ARRIVAL, -1, p);
+            loaded++;
+        }
+    }
+    if (file.bad_lines) printf("[Sim] Skipped %ld bad lines in %s\n", file.bad_lines, filename);
+    job_file_close(&file);
+    return loaded;
+}
+
+void sim_report(SimEngine *sim, double wall_seconds) {
+    printf("\n[Sim] Virtual time: %ld ticks, wall time: %.3f s (%.0f events/s)\n", sim->now, wall_seconds,
+           wall_seconds > 0 ? sim->events_processed / wall_seconds : 0.0);
+    printf("[Sim] Completed: %ld, Dispatches: %ld, Events: %ld\n",
+           sim->completed, sim->dispatches, sim->events_processed);
+    if (sim->ready.count) printf("[Sim] %d jobs never ran (no allowed CPU)\n", sim->ready.count);
+    if (sim->completed) {
+        printf("[Sim] Avg turnaround: %.2f ticks, Avg waiting: %.2f ticks\n",
+               (double)sim->total_turnaround / sim->completed, (double)sim->total_waiting / sim->completed);
+    }
+    if (sim->fairness_samples) {
+        printf("[Sim] CFS mean Jain fairness index: %.4f, Max vruntime lag: %.2f ticks\n",
+               sim->fairness_sum / sim->fairness_samples, sim->max_vruntime_lag);
+    }
+    if (sim->ready.edf.admitted || sim->ready.edf.rejected) edf_print(&sim->ready.edf, 0);
+    if (sim->ready.policy == POLICY_FAIR) print_fair_stats(&sim->ready.fair, sim->now);
+    if (sim->ready.policy == POLICY_O1) o1_print(&sim->ready.o1, sim->now);
+    if (sim->ready.policy == POLICY_PRIORITY && sim->ready.age_interval > 0) {
+        printf("[Sim] Priority aging: %ld steps, one level per %d ticks queued\n", sim->ready.agings,
+               sim->ready.age_interval);
+    }
+    if (sim->bank.requests) {
+        print_bank(&sim->bank);
+        if (sim->bank.pending) printf("[Sim] %d jobs blocked forever on resources: deadlock\n", sim->bank.pending);
+    }
+    VmSchedStats vm;
+    vm_sched_stats(&sim->vmm, &vm);
+    if (vm.accesses) {
+        print_vm_sched(&sim->vmm, &sim->paging, sim->now, sim->completed);
+    }
+    for (int cpu = 0; cpu < sim->num_cpus; cpu++) {
+        printf("[Sim] CPU %d utilization: %.1f%%\n", cpu,
+               sim->now ? 100.0 * sim->busy_ticks[cpu] / sim->now : 0.0);
+    }
+    printf("\n");
+}
+
+void run_simulation(const char *filename, int num_cpus, int realtime, int tick_ms) {
+    SimEngine sim;
+    sim_init(&sim, num_cpus, realtime, tick_ms);
+    int loaded = sim_load_jobs(&sim, filename);
+    if (loaded < 0) {
+        sim_destroy(&sim);
+        return;
+    }
+    printf("[Sim] %d jobs on %d CPUs, %s mode\n", loaded, sim.num_cpus, realtime ? "realtime" : "fast");
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    sim_run(&sim);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    sim_report(&sim, (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+    sim_destroy(&sim);
+}
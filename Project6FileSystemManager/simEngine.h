@@ -0,0 +1,81 @@
+#ifndef SIMENGINE_H
+#define SIMENGINE_H
+
+#include <pthread.h>
+#include "advancedScheduler.h"
+#include "trace.h"
+#include "vmSched.h"
+#include "banker.h"
+#include "memGroup.h"
+
+typedef enum {
+    EV_ARRIVAL,             // PCB enters the ready queue
+    EV_QUANTUM_EXPIRY,      // running PCB used its whole quantum
+    EV_IO_REQUEST,          // running PCB blocks for I/O
+    EV_PAGE_FAULT,          // running PCB hard-faulted
+    EV_EXIT,                // running PCB finished its time limit
+    EV_IO_COMPLETE,         // blocked PCB's I/O finished
+    EV_PAGE_FAULT_COMPLETE, // blocked PCB's page is now resident
+    EV_QUOTA_REFILL,        // a throttled share group may run again
+    EV_RESOURCE_REQUEST,    // running PCB asks the banker for a unit
+    EV_RESOURCE_GRANTED     // blocked PCB's request went through
+} SimEventType;
+
+typedef struct {
+    long time;
+    unsigned long seq;      // keeps same-time events in posting order
+    SimEventType type;
+    int cpu;
+    PCB *pcb;
+} SimEvent;
+
+// Discrete-event simulation of the scheduler on a virtual clock. Time only
+// moves when the next event is popped, so a run costs CPU time proportional
+// to the number of events, not to the simulated duration. In realtime mode
+// each virtual tick is paced to tick_ms of wall time for demos.
+typedef struct {
+    SimEvent *events;
+    int event_count;
+    int event_capacity;
+    unsigned long next_seq;
+    long now;
+
+    Queue ready;
+    int num_cpus;
+    PCB *running[MAX_CPUS];
+    long busy_ticks[MAX_CPUS];
+
+    int realtime;
+    int tick_ms;
+    int io_latency;         // ticks an I/O request takes
+    int io_chance;          // 1 in io_chance ticks ends in an I/O request
+    unsigned int seed;
+
+    long events_processed;
+    long dispatches;
+    long completed;
+    long total_turnaround;
+    long total_waiting;
+    double fairness_sum;
+    long fairness_samples;
+    double max_vruntime_lag;
+
+    TraceLog *trace;        // decisions are appended here when set
+    long refill_posted;     // time of the pending EV_QUOTA_REFILL, -1 if none
+    int next_pid;           // jobs are numbered apart from the shell's pids
+    Vmm vmm;                // memory is simulated apart from the shell's
+    MemGroup mem_groups[MAX_MEM_GROUPS];    // copy of the shell's group limits
+    PagingDisk paging;
+    Bank bank;              // same resource totals as the live one
+} SimEngine;
+
+void sim_init(SimEngine *sim, int num_cpus, int realtime, int tick_ms);
+void sim_destroy(SimEngine *sim);
+void sim_post(SimEngine *sim, long time, SimEventType type, int cpu, PCB *p);
+void sim_block_on_page_fault(SimEngine *sim, int cpu, long latency);
+int sim_load_jobs(SimEngine *sim, const char *filename);
+void sim_run(SimEngine *sim);
+void sim_report(SimEngine *sim, double wall_seconds);
+void run_simulation(const char *filename, int num_cpus, int realtime, int tick_ms);
+
+#endif
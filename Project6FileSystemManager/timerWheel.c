@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "timerWheel.h"
+
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+
+TimerWheel timer_wheel;
+
+static long monotonic_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+void timer_wheel_init(TimerWheel *w) {
+    memset(w, 0, sizeof(TimerWheel));
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&w->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    w->start_ms = monotonic_ms();
+    w->sleep_until = -1;
+}
+
+long timer_wheel_now(TimerWheel *w) {
+    return monotonic_ms() - w->start_ms;
+}
+
+void timer_init(Timer *t, TimerFn fn, void *arg) {
+    memset(t, 0, sizeof(Timer));
+    t->fn = fn;
+    t->arg = arg;
+}
+
+static void link_timer(Timer **bucket, Timer *t) {
+    t->bucket = bucket;
+    t->prev = NULL;
+    t->next = *bucket;
+    if (*bucket) (*bucket)->prev = t;
+    *bucket = t;
+}
+
+static void unlink_timer(Timer *t) {
+    if (t->prev) t->prev->next = t->next;
+    else *t->bucket = t->next;
+    if (t->next) t->next->prev = t->prev;
+    t->next = t->prev = NULL;
+    t->bucket = NULL;
+}
+
+// A timer goes on the lowest level whose next digit up agrees with now, so
+// it is cascaded exactly when that level's hand reaches its slot
+static void place(TimerWheel *w, Timer *t) {
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        int shift = WHEEL_BITS * (level + 1);
+        if ((t->expires >> shift) == (w->now >> shift)) {
+            link_timer(&w->slots[level][(t->expires >> (WHEEL_BITS * level)) & WHEEL_MASK], t);
+            return;
+        }
+    }
+    link_timer(&w->overflow, t);
+}
+
+static void cascade(TimerWheel *w, Timer **bucket) {
+    Timer *t = *bucket;
+    *bucket = NULL;
+    while (t) {
+        Timer *next = t->next;
+        place(w, t);
+        t = next;
+    }
+}
+
+// Earliest time after now at which a slot fires or cascades, -1 if none.
+// Only the slots ahead of each hand can be occupied, and any level k slot
+// comes after every level k - 1 slot, so the first hit is the answer.
+static long next_event(TimerWheel *w) {
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        int shift = WHEEL_BITS * level;
+        long base = (w->now >> (shift + WHEEL_BITS)) << (shift + WHEEL_BITS);
+        for (int slot = ((w->now >> shift) & WHEEL_MASK) + 1; slot < WHEEL_SIZE; slot++) {
+            if (w->slots[level][slot]) return base + ((long)slot << shift);
+        }
+    }
+    if (w->overflow) return ((w->now >> (WHEEL_BITS * WHEEL_LEVELS)) + 1) << (WHEEL_BITS * WHEEL_LEVELS);
+    return -1;
+}
+
+// Moves the hands to target, jumping straight between occupied slots, and
+// puts everything due on the wheel's expired list
+static void advance(TimerWheel *w, long target) {
+    while (w->now < target) {
+        long next = next_event(w);
+        if (next < 0 || next > target) {
+            w->now = target;
+            return;
+        }
+        w->now = next;
+        // Higher levels first, so their timers can fall through lower ones
+        if ((next & ((1L << (WHEEL_BITS * WHEEL_LEVELS)) - 1)) == 0) cascade(w, &w->overflow);
+        for (int level = WHEEL_LEVELS - 1; level >= 1; level--) {
+            if (next & ((1L << (WHEEL_BITS * level)) - 1)) continue;
+            cascade(w, &w->slots[level][(next >> (WHEEL_BITS * level)) & WHEEL_MASK]);
+        }
+        Timer **slot = &w->slots[0][next & WHEEL_MASK];
+        while (*slot) {
+            Timer *t = *slot;
+            unlink_timer(t);
+            link_timer(&w->expired, t);
+        }
+    }
+}
+
+// Past expiry times fire on the next ms rather than a whole rotation later
+void timer_arm_at(TimerWheel *w, Timer *t, long expires) {
+    pthread_mutex_lock(&w->lock);
+    if (t->bucket) unlink_timer(t);
+    else w->pending++;
+    t->expires = expires > w->now ? expires : w->now + 1;
+    place(w, t);
+    if (w->sleep_until < 0 || t->expires < w->sleep_until) pthread_cond_signal(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+}
+
+void timer_arm(TimerWheel *w, Timer *t, long delay_ms) {
+    timer_arm_at(w, t, timer_wheel_now(w) + delay_ms);
+}
+
+// Returns 1 if the timer was pending. A callback already running is not
+// stopped; owners that re-arm check their own deadline in the callback.
+int timer_cancel(TimerWheel *w, Timer *t) {
+    pthread_mutex_lock(&w->lock);
+    int was_pending = t->bucket != NULL;
+    if (was_pending) {
+        unlink_timer(t);
+        w->pending--;
+    }
+    pthread_mutex_unlock(&w->lock);
+    return was_pending;
+}
+
+int timer_pending(TimerWheel *w, Timer *t) {
+    pthread_mutex_lock(&w->lock);
+    int pending = t->bucket != NULL;
+    pthread_mutex_unlock(&w->lock);
+    return pending;
+}
+
+// Runs callbacks one at a time without the lock. Expired timers stay linked
+// on a list until their turn, so a cancel or re-arm in the meantime wins.
+void *timer_service(void *arg) {
+    TimerWheel *w = arg;
+    pthread_mutex_lock(&w->lock);
+    while (1) {
+        advance(w, timer_wheel_now(w));
+        if (w->expired) {
+            Timer *t = w->expired;
+            unlink_timer(t);
+            w->pending--;
+            w->fired++;
+            pthread_mutex_unlock(&w->lock);
+            t->fn(t, t->arg);
+            pthread_mutex_lock(&w->lock);
+            continue;
+        }
+
+        long next = next_event(w);
+        w->sleep_until = next;
+        if (next < 0) {
+            pthread_cond_wait(&w->cond, &w->lock);
+        } else {
+            long wake = w->start_ms + next;
+            struct timespec ts = { wake / 1000, (wake % 1000) * 1000000 };
+            pthread_cond_timedwait(&w->cond, &w->lock, &ts);
+        }
+        w->sleep_until = -1;
+    }
+    return NULL;
+}
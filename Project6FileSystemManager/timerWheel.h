@@ -0,0 +1,51 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <pthread.h>
+
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 4              // 64^4 ms, about 4.6 hours, before overflow
+
+struct Timer;
+typedef void (*TimerFn)(struct Timer *timer, void *arg);
+
+// Embedded in whatever owns it (a PCB, an I/O device); never allocated
+typedef struct Timer {
+    long expires;                   // ms since the wheel started
+    struct Timer *next, *prev;
+    struct Timer **bucket;          // list head the timer is on, NULL if idle
+    TimerFn fn;
+    void *arg;
+} Timer;
+
+// Hierarchical timing wheel at 1 ms resolution. Level k holds timers due in
+// the current rotation of level k + 1; each slot is a doubly linked list, so
+// arm and cancel are O(1), and a timer is cascaded down at most once per
+// level. The service thread sleeps until the earliest non-empty slot, so
+// outstanding timers cost nothing per tick.
+typedef struct TimerWheel {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;            // CLOCK_MONOTONIC
+    long start_ms;
+    long now;                       // last ms processed
+    long sleep_until;               // what the service thread waits for, -1 = forever
+    int pending;
+    long fired;
+    Timer *slots[WHEEL_LEVELS][WHEEL_SIZE];
+    Timer *overflow;
+    Timer *expired;                 // due, callback not run yet
+} TimerWheel;
+
+extern TimerWheel timer_wheel;
+
+void timer_wheel_init(TimerWheel *w);
+long timer_wheel_now(TimerWheel *w);
+void timer_init(Timer *t, TimerFn fn, void *arg);
+void timer_arm(TimerWheel *w, Timer *t, long delay_ms);
+void timer_arm_at(TimerWheel *w, Timer *t, long expires);
+int timer_cancel(TimerWheel *w, Timer *t);
+int timer_pending(TimerWheel *w, Timer *t);
+void *timer_service(void *wheel);
+
+#endif
@@ -0,0 +1,492 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
+#include "advancedScheduler.h"
+#include "simEngine.h"
+#include "trace.h"
+
+#define RING_MASK (TRACE_RING_SIZE - 1)
+#define TICK_US ((uint64_t)SCHED_TICK_MS * 1000)
+
+// Single-writer flight recorder per thread: the newest TRACE_RING_SIZE
+// events survive, older ones are overwritten
+typedef struct TraceRing {
+    struct TraceRing *next;
+    atomic_ulong head;
+    TraceEvent events[TRACE_RING_SIZE];
+} TraceRing;
+
+TraceLog trace_log;
+atomic_int trace_enabled;
+
+static TraceRing *rings;
+static int ring_count;
+static pthread_mutex_t rings_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local TraceRing *thread_ring;
+static long dropped;
+
+static const char *type_names[] = { "arrive", "dispatch", "preempt", "block", "wake", "exit" };
+
+static uint64_t now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    long us = ts.tv_sec * 1000000L + ts.tv_nsec / 1000 - timer_wheel.start_ms * 1000L;
+    return us > 0 ? (uint64_t)us : 0;
+}
+
+static void fill_event(TraceEvent *e, TraceType type, int cpu, const PCB *p, uint64_t ts_us) {
+    e->ts_us = ts_us;
+    e->pid = p->pid;
+    e->arg = type == TRACE_ARRIVE ? p->time_limit : p->cpu_time_used;
+    e->priority = (int16_t)p->priority;
+    e->type = (uint8_t)type;
+    e->cpu = cpu < 0 || cpu >= TRACE_NO_CPU ? TRACE_NO_CPU : (uint8_t)cpu;
+}
+
+static TraceRing *register_ring() {
+    TraceRing *r = calloc(1, sizeof(TraceRing));
+    if (!r) return NULL;
+    pthread_mutex_lock(&rings_lock);
+    r->next = rings;
+    rings = r;
+    ring_count++;
+    pthread_mutex_unlock(&rings_lock);
+    return thread_ring = r;
+}
+
+// Hot path: a relaxed flag check when off, a few stores into this thread's
+// ring when on
+void trace_record(TraceType type, int cpu, const PCB *p) {
+    if (!atomic_load_explicit(&trace_enabled, memory_order_relaxed)) return;
+    TraceRing *r = thread_ring ? thread_ring : register_ring();
+    if (!r) return;
+    unsigned long head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    fill_event(&r->events[head & RING_MASK], type, cpu, p, now_us());
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+}
+
+int trace_append(TraceLog *log, TraceType type, int cpu, const PCB *p, uint64_t ts_us) {
+    if (log->count == log->capacity) {
+        int capacity = log->capacity ? log->capacity * 2 : 1024;
+        TraceEvent *events = realloc(log->events, capacity * sizeof(TraceEvent));
+        if (!events) return -1;
+        log->events = events;
+        log->capacity = capacity;
+    }
+    fill_event(&log->events[log->count++], type, cpu, p, ts_us);
+    return 0;
+}
+
+void trace_log_clear(TraceLog *log) {
+    free(log->events);
+    memset(log, 0, sizeof(TraceLog));
+}
+
+void trace_start() {
+    atomic_store(&trace_enabled, 0);
+    pthread_mutex_lock(&rings_lock);
+    for (TraceRing *r = rings; r; r = r->next) atomic_store(&r->head, 0);
+    pthread_mutex_unlock(&rings_lock);
+    trace_log_clear(&trace_log);
+    dropped = 0;
+    atomic_store(&trace_enabled, 1);
+}
+
+// Stops recording and merges the per-thread rings, each already in time
+// order, into trace_log
+void trace_stop() {
+    atomic_store(&trace_enabled, 0);
+    trace_log_clear(&trace_log);
+    pthread_mutex_lock(&rings_lock);
+    unsigned long pos[ring_count > 0 ? ring_count : 1], end[ring_count > 0 ? ring_count : 1];
+    TraceRing *by_index[ring_count > 0 ? ring_count : 1];
+    long total = 0;
+    int n = 0;
+    dropped = 0;
+    for (TraceRing *r = rings; r; r = r->next, n++) {
+        end[n] = atomic_load_explicit(&r->head, memory_order_acquire);
+        pos[n] = end[n] > TRACE_RING_SIZE ? end[n] - TRACE_RING_SIZE : 0;
+        dropped += pos[n];
+        total += end[n] - pos[n];
+        by_index[n] = r;
+    }
+    trace_log.events = malloc((total > 0 ? total : 1) * sizeof(TraceEvent));
+    if (!trace_log.events) {
+        pthread_mutex_unlock(&rings_lock);
+        perror("trace");
+        return;
+    }
+    trace_log.capacity = total;
+    while (trace_log.count < total) {
+        int best = -1;
+        for (int i = 0; i < n; i++) {
+            if (pos[i] == end[i]) continue;
+            if (best < 0 || by_index[i]->events[pos[i] & RING_MASK].ts_us <
+                            by_index[best]->events[pos[best] & RING_MASK].ts_us) best = i;
+        }
+        trace_log.events[trace_log.count++] = by_index[best]->events[pos[best]++ & RING_MASK];
+    }
+    pthread_mutex_unlock(&rings_lock);
+}
+
+void trace_print_status() {
+    printf("[Trace] %s, %d thread rings, %d events collected", atomic_load(&trace_enabled) ? "recording" : "stopped",
+           ring_count, trace_log.count);
+    if (dropped) printf(", %ld oldest overwritten", dropped);
+    printf("\n");
+}
+
+// File format: magic, version, count, then the raw events
+int trace_save(const TraceLog *log, const char *path) {
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        perror("trace save");
+        return -1;
+    }
+    uint32_t header[2] = { TRACE_VERSION, (uint32_t)log->count };
+    int ok = fwrite(TRACE_MAGIC, 1, 8, fp) == 8 && fwrite(header, sizeof(header), 1, fp) == 1 &&
+             (log->count == 0 || fwrite(log->events, sizeof(TraceEvent), log->count, fp) == (size_t)log->count);
+    fclose(fp);
+    if (!ok) {
+        printf("[Trace] Short write to %s\n", path);
+        return -1;
+    }
+    printf("[Trace] Saved %d events (%zu bytes each) to %s\n", log->count, sizeof(TraceEvent), path);
+    return 0;
+}
+
+int trace_load(TraceLog *log, const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        perror("trace load");
+        return -1;
+    }
+    char magic[8];
+    uint32_t header[2];
+    if (fread(magic, 1, 8, fp) != 8 || memcmp(magic, TRACE_MAGIC, 8) != 0 ||
+        fread(header, sizeof(header), 1, fp) != 1 || header[0] != TRACE_VERSION) {
+        printf("[Trace] %s is not a version %d trace\n", path, TRACE_VERSION);
+        fclose(fp);
+        return -1;
+    }
+    if (header[1] > INT_MAX) {
+        printf("[Trace] %s claims %u events, more than a log can hold\n", path, header[1]);
+        fclose(fp);
+        return -1;
+    }
+    TraceEvent *events = malloc((size_t)(header[1] ? header[1] : 1) * sizeof(TraceEvent));
+    if (!events || fread(events, sizeof(TraceEvent), header[1], fp) != header[1]) {
+        printf("[Trace] Truncated trace %s\n", path);
+        free(events);
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    // The replay and the exporters index by pid and type
+    for (uint32_t i = 0; i < header[1]; i++) {
+        if (events[i].pid < 0 || events[i].type > TRACE_EXIT) {
+            printf("[Trace] Bad event %u in %s (pid %d, type %d)\n", i, path, events[i].pid, events[i].type);
+            free(events);
+            return -1;
+        }
+    }
+    trace_log_clear(log);
+    log->events = events;
+    log->count = log->capacity = header[1];
+    printf("[Trace] Loaded %d events from %s\n", log->count, path);
+    return 0;
+}
+
+// Run slices: a dispatch up to the preempt, block or exit on the same CPU
+typedef struct {
+    int cpu;
+    int pid;
+    uint64_t start;
+    uint64_t end;
+} Slice;
+
+static Slice *build_slices(const TraceLog *log, int *count, int *num_cpus) {
+    Slice open[TRACE_NO_CPU];
+    int is_open[TRACE_NO_CPU] = { 0 };
+    Slice *slices = malloc((log->count > 0 ? log->count : 1) * sizeof(Slice));
+    *count = 0;
+    *num_cpus = 0;
+    if (!slices) return NULL;
+    for (int i = 0; i < log->count; i++) {
+        const TraceEvent *e = &log->events[i];
+        if (e->cpu == TRACE_NO_CPU) continue;
+        if (e->cpu + 1 > *num_cpus) *num_cpus = e->cpu + 1;
+        if (e->type == TRACE_DISPATCH) {
+            if (is_open[e->cpu]) {
+                open[e->cpu].end = e->ts_us;
+                slices[(*count)++] = open[e->cpu];
+            }
+            open[e->cpu] = (Slice){ e->cpu, e->pid, e->ts_us, e->ts_us };
+            is_open[e->cpu] = 1;
+        } else if (is_open[e->cpu] && open[e->cpu].pid == e->pid &&
+                   (e->type == TRACE_PREEMPT || e->type == TRACE_BLOCK || e->type == TRACE_EXIT)) {
+            open[e->cpu].end = e->ts_us;
+            slices[(*count)++] = open[e->cpu];
+            is_open[e->cpu] = 0;
+        }
+    }
+    uint64_t last = log->count ? log->events[log->count - 1].ts_us : 0;
+    for (int cpu = 0; cpu < *num_cpus; cpu++) {
+        if (!is_open[cpu]) continue;
+        open[cpu].end = last;
+        slices[(*count)++] = open[cpu];
+    }
+    return slices;
+}
+
+// Chrome trace event format, loadable in chrome://tracing and Perfetto:
+// one track per CPU with a complete event per run slice, plus instants for
+// arrivals, blocks and wakeups on a separate track
+int trace_export_chrome(const TraceLog *log, const char *path) {
+    int count, num_cpus;
+    Slice *slices = build_slices(log, &count, &num_cpus);
+    if (!slices) return -1;
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        perror("trace chrome");
+        free(slices);
+        return -1;
+    }
+    fprintf(fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    fprintf(fp, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %d, \"args\": {\"name\": \"Events\"}}",
+            TRACE_NO_CPU);
+    for (int cpu = 0; cpu < num_cpus; cpu++) {
+        fprintf(fp, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %d, \"args\": {\"name\": \"CPU %d\"}}",
+                cpu, cpu);
+    }
+    for (int i = 0; i < count; i++) {
+        fprintf(fp, ",\n{\"name\": \"PID %d\", \"cat\": \"run\", \"ph\": \"X\", \"ts\": %llu, \"dur\": %llu, "
+                "\"pid\": 0, \"tid\": %d, \"args\": {\"pid\": %d}}",
+                slices[i].pid, (unsigned long long)slices[i].start,
+                (unsigned long long)(slices[i].end - slices[i].start), slices[i].cpu, slices[i].pid);
+    }
+    for (int i = 0; i < log->count; i++) {
+        const TraceEvent *e = &log->events[i];
+        if (e->type != TRACE_ARRIVE && e->type != TRACE_BLOCK && e->type != TRACE_WAKE) continue;
+        fprintf(fp, ",\n{\"name\": \"%s PID %d\", \"cat\": \"%s\", \"ph\": \"i\", \"s\": \"t\", \"ts\": %llu, "
+                "\"pid\": 0, \"tid\": %d, \"args\": {\"pid\": %d, \"used\": %d}}",
+                type_names[e->type], e->pid, type_names[e->type], (unsigned long long)e->ts_us,
+                TRACE_NO_CPU, e->pid, e->arg);
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+    free(slices);
+    printf("[Trace] Wrote %d run slices on %d CPUs to %s\n", count, num_cpus, path);
+    return 0;
+}
+
+static char pid_char(int pid) {
+    static const char digits[] = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    return digits[pid % 62];
+}
+
+// One row per CPU, one column per equal slice of time, showing whichever
+// PID was running at the column's midpoint
+void trace_print_gantt(const TraceLog *log, int width) {
+    int count, num_cpus;
+    if (log->count == 0) {
+        printf("[Trace] No events\n");
+        return;
+    }
+    Slice *slices = build_slices(log, &count, &num_cpus);
+    if (!slices) return;
+    if (width < 10) width = 10;
+    uint64_t t0 = log->events[0].ts_us, t1 = log->events[log->count - 1].ts_us;
+    double column_us = t1 > t0 ? (double)(t1 - t0) / width : 1.0;
+    char *row = malloc(width + 1);
+    if (!row) {
+        free(slices);
+        return;
+    }
+
+    printf("[Trace] %.3f s, %.1f ms per column\n", (t1 - t0) / 1e6, column_us / 1000);
+    for (int cpu = 0; cpu < num_cpus; cpu++) {
+        memset(row, '.', width);
+        row[width] = '\0';
+        for (int i = 0; i < count; i++) {
+            if (slices[i].cpu != cpu) continue;
+            for (int c = 0; c < width; c++) {
+                double mid = t0 + (c + 0.5) * column_us;
+                if (mid >= slices[i].start && mid < slices[i].end) row[c] = pid_char(slices[i].pid);
+            }
+        }
+        printf("CPU %-2d |%s|\n", cpu, row);
+    }
+
+    printf("Legend:");
+    int shown = 0;
+    for (int i = 0; i < log->count && shown < 62; i++) {
+        if (log->events[i].type != TRACE_ARRIVE) continue;
+        printf(" %c=PID %d", pid_char(log->events[i].pid), log->events[i].pid);
+        shown++;
+    }
+    printf("%s\n", shown ? "" : " (no arrivals recorded)");
+    free(row);
+    free(slices);
+}
+
+// Replay: every recorded arrival becomes a simulated job with the same
+// arrival tick, priority and length, blocking for I/O at the same points of
+// its run for the same number of ticks. The simulation has no other
+// randomness, so a replay under a given policy is deterministic.
+typedef struct {
+    int pid;
+    int priority;
+    int time_limit;
+    long arrival;
+    uint64_t arrive_us;
+    uint64_t exit_us;
+    uint64_t block_us;
+    TraceScript script;
+} ReplayJob;
+
+static long to_ticks(uint64_t us) {
+    return (long)((us + TICK_US / 2) / TICK_US);
+}
+
+static int script_push(TraceScript *s, int at_used) {
+    int *at = realloc(s->at_used, (s->count + 1) * sizeof(int));
+    if (!at) return -1;
+    s->at_used = at;
+    long *latency = realloc(s->latency, (s->count + 1) * sizeof(long));
+    if (!latency) return -1;
+    s->latency = latency;
+    s->at_used[s->count] = at_used;
+    s->latency[s->count++] = 1;
+    return 0;
+}
+
+// Recorded pid to the index of its open job, -1 once it exits. The pids
+// are whatever the trace holds, so they are hashed rather than used as
+// indices. Buckets are never emptied, so probing needs no tombstones.
+typedef struct {
+    int *pids;          // -1 marks an empty bucket
+    int *jobs;
+    size_t mask;
+} PidIndex;
+
+static int pid_index_init(PidIndex *ix, int entries) {
+    size_t buckets = 16;
+    while (buckets < (size_t)entries * 2) buckets <<= 1;
+    ix->pids = malloc(buckets * sizeof(int));
+    ix->jobs = malloc(buckets * sizeof(int));
+    ix->mask = buckets - 1;
+    if (!ix->pids || !ix->jobs) return -1;
+    memset(ix->pids, 0xff, buckets * sizeof(int));
+    return 0;
+}
+
+static size_t pid_index_bucket(const PidIndex *ix, int pid) {
+    size_t i = ((unsigned)pid * 2654435761u) & ix->mask;
+    while (ix->pids[i] != -1 && ix->pids[i] != pid) i = (i + 1) & ix->mask;
+    return i;
+}
+
+static void pid_index_set(PidIndex *ix, int pid, int job) {
+    size_t i = pid_index_bucket(ix, pid);
+    ix->pids[i] = pid;
+    ix->jobs[i] = job;
+}
+
+static int pid_index_get(const PidIndex *ix, int pid) {
+    size_t i = pid_index_bucket(ix, pid);
+    return ix->pids[i] == pid ? ix->jobs[i] : -1;
+}
+
+static void pid_index_free(PidIndex *ix) {
+    free(ix->pids);
+    free(ix->jobs);
+}
+
+int trace_replay(const TraceLog *log, SchedPolicyType policy, int num_cpus, int slice, int gantt_width) {
+    int arrivals = 0;
+    for (int i = 0; i < log->count; i++) arrivals += log->events[i].type == TRACE_ARRIVE;
+    PidIndex current;
+    ReplayJob *jobs = calloc(log->count > 0 ? log->count : 1, sizeof(ReplayJob));
+    if (pid_index_init(&current, arrivals) < 0 || !jobs) {
+        pid_index_free(&current);
+        free(jobs);
+        perror("trace replay");
+        return -1;
+    }
+
+    int job_count = 0, finished = 0;
+    long recorded_turnaround = 0;
+    for (int i = 0; i < log->count; i++) {
+        const TraceEvent *e = &log->events[i];
+        if (e->type == TRACE_ARRIVE) {
+            ReplayJob *j = &jobs[job_count];
+            j->pid = e->pid;
+            j->priority = e->priority;
+            j->time_limit = e->arg;
+            j->arrive_us = e->ts_us;
+            j->arrival = to_ticks(e->ts_us);
+            pid_index_set(&current, e->pid, job_count++);
+            continue;
+        }
+        int open = pid_index_get(&current, e->pid);
+        if (open < 0) continue;                 // arrived before the trace started
+        ReplayJob *j = &jobs[open];
+        if (e->type == TRACE_BLOCK) {
+            if (script_push(&j->script, e->arg) == 0) j->block_us = e->ts_us;
+        } else if (e->type == TRACE_WAKE && j->script.count > 0) {
+            long latency = to_ticks(e->ts_us - j->block_us);
+            j->script.latency[j->script.count - 1] = latency > 0 ? latency : 1;
+        } else if (e->type == TRACE_EXIT) {
+            j->exit_us = e->ts_us;
+            recorded_turnaround += to_ticks(j->exit_us - j->arrive_us);
+            finished++;
+            pid_index_set(&current, e->pid, -1);
+        }
+    }
+    pid_index_free(&current);
+    if (job_count == 0) {
+        printf("[Replay] No recorded arrivals to replay\n");
+        free(jobs);
+        return -1;
+    }
+
+    SimEngine sim;
+    TraceLog replayed = { 0 };
+    sim_init(&sim, num_cpus, 0, 1000);
+    set_sched_policy(&sim.ready, policy);
+    if (slice > 0) set_policy_slice(&sim.ready, slice);
+    sim.trace = &replayed;
+    // Start the virtual clock at the first arrival
+    long base = jobs[0].arrival;
+    for (int i = 0; i < job_count; i++) {
+        PCB *p = pcb_create(jobs[i].pid, jobs[i].priority, jobs[i].time_limit);
+        p->arrival_time = jobs[i].arrival - base;
+        p->script = &jobs[i].script;
+        sim_post(&sim, p->arrival_time, EV_ARRIVAL, -1, p);
+    }
+    printf("[Replay] %d jobs (%d finished while recording) under %s on %d CPUs\n",
+           job_count, finished, sched_policies[policy].name, sim.num_cpus);
+    if (finished) {
+        printf("[Replay] Recorded avg turnaround: %.2f ticks\n", (double)recorded_turnaround / finished);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    sim_run(&sim);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    sim_report(&sim, (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+    if (gantt_width > 0) trace_print_gantt(&replayed, gantt_width);
+    sim_destroy(&sim);
+
+    trace_log_clear(&replayed);
+    for (int i = 0; i < job_count; i++) {
+        free(jobs[i].script.at_used);
+        free(jobs[i].script.latency);
+    }
+    free(jobs);
+    return 0;
+}
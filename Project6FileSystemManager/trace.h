@@ -0,0 +1,56 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "advancedScheduler.h"
+
+#define TRACE_RING_SIZE 16384       // events per thread, must be a power of two
+#define TRACE_NO_CPU 255
+#define TRACE_MAGIC "SCHTRACE"
+#define TRACE_VERSION 1
+
+typedef enum { TRACE_ARRIVE, TRACE_DISPATCH, TRACE_PREEMPT, TRACE_BLOCK, TRACE_WAKE, TRACE_EXIT } TraceType;
+
+// 24 bytes on disk and in memory
+typedef struct {
+    uint64_t ts_us;             // since the timer wheel started, or virtual
+    int32_t pid;
+    int32_t arg;                // time_limit for ARRIVE, cpu_time_used otherwise
+    int16_t priority;
+    uint8_t type;
+    uint8_t cpu;                // TRACE_NO_CPU when not on a CPU
+} TraceEvent;
+
+// A flat, time-ordered set of events: collected from the rings, loaded
+// from a file, or appended to by a simulation
+typedef struct {
+    TraceEvent *events;
+    int count;
+    int capacity;
+} TraceLog;
+
+// I/O points of one recorded job, so a replay blocks where the original did
+typedef struct TraceScript {
+    int count;
+    int next;
+    int *at_used;               // cpu_time_used when it blocked
+    long *latency;              // ticks until it woke
+} TraceScript;
+
+extern TraceLog trace_log;
+extern atomic_int trace_enabled;
+
+void trace_start();
+void trace_stop();
+void trace_record(TraceType type, int cpu, const PCB *p);
+int trace_append(TraceLog *log, TraceType type, int cpu, const PCB *p, uint64_t ts_us);
+void trace_log_clear(TraceLog *log);
+int trace_save(const TraceLog *log, const char *path);
+int trace_load(TraceLog *log, const char *path);
+int trace_export_chrome(const TraceLog *log, const char *path);
+void trace_print_gantt(const TraceLog *log, int width);
+int trace_replay(const TraceLog *log, SchedPolicyType policy, int num_cpus, int slice, int gantt_width);
+void trace_print_status();
+
+#endif
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "advancedScheduler.h"
+#include "VMmanager.h"
+#include "vmSched.h"
+
+PagingDisk paging_disk;
+
+static int pages_of(const PCB *p) {
+    return p->mem_pages < NUM_PAGES ? p->mem_pages : NUM_PAGES;
+}
+
+// Next page in the PCB's pattern. The locality window is a quarter of the
+// working set and moves on every VM_PHASE_TICKS ticks of work.
+static int next_page(PCB *p) {
+    int pages = pages_of(p);
+    switch (p->mem_pattern) {
+    case MEM_RANDOM:
+        return rand_r(&p->mem_seed) % pages;
+    case MEM_LOCALITY: {
+        int window = pages / 4 > 0 ? pages / 4 : 1;
+        if ((int)(rand_r(&p->mem_seed) % 100) >= VM_LOCALITY_PERCENT) return rand_r(&p->mem_seed) % pages;
+        int base = (p->cpu_time_used / VM_PHASE_TICKS) * window;
+        return (base + rand_r(&p->mem_seed) % window) % pages;
+    }
+    default: {
+        int page = p->mem_cursor % pages;
+        p->mem_cursor = page + 1;
+        return page;
+    }
+    }
+}
+
+// Makes one tick's worth of accesses. Returns 1 if the PCB hard-faulted
+// and has to block, with the page left in p->fault_page.
+int vm_sched_run_tick(Vmm *vm, PCB *p) {
+    if (p->mem_pages <= 0 || p->mem_pattern == MEM_NONE) return 0;
+    if (!p->vm_pid) {
+        if ((p->vm_pid = create_process(vm)) < 0) {
+            p->vm_pid = 0;
+            return 0;
+        }
+        p->vmm = vm;
+    }
+    for (int i = 0; i < VM_ACCESSES_PER_TICK; i++) {
+        int page = next_page(p);
+        VmAccessResult result = vm_touch(p->vmm, p->vm_pid, page, i & 1 ? 'w' : 'r');
+        if (result == VM_NO_PROCESS) return 0;
+        if (result == VM_HARD_FAULT) {
+            p->fault_page = page;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Queues a page read for one of the VMM's faults, under its lock. Returns
+// the ticks until the page is in.
+long paging_disk_reserve(Vmm *vm, PagingDisk *d, long now) {
+    vm_lock(vm);
+    long start = d->free_at > now ? d->free_at : now;
+    d->free_at = start + VM_FAULT_TICKS;
+    if (start - now > d->max_wait) d->max_wait = start - now;
+    long wait = d->free_at - now;
+    vm_unlock(vm);
+    return wait;
+}
+
+void vm_sched_fault_done(PCB *p) {
+    if (p->fault_page < 0) return;
+    if (p->vm_pid) vm_resolve_fault(p->vmm, p->vm_pid, p->fault_page);
+    p->fault_page = -1;
+}
+
+void vm_sched_release(PCB *p) {
+    if (!p->vm_pid) return;
+    free_process(p->vmm, p->vm_pid);
+    p->vm_pid = 0;
+    p->vmm = NULL;
+}
+
+void vm_sched_stats(Vmm *vm, VmSchedStats *out) {
+    vm_lock(vm);
+    out->accesses = vm->touches;
+    out->tlb_hits = vm->touch_hits;
+    out->hard_faults = vm->touch_faults;
+    out->switches = vm->address_space_switches;
+    out->flushes = vm->tlb_flushes;
+    vm_unlock(vm);
+}
+
+// Counts over the VMM's lifetime, with the disk that serves its faults;
+// ticks and completed give the end-to-end throughput over the same stretch
+void print_vm_sched(Vmm *vm, const PagingDisk *disk, long ticks, long completed) {
+    VmSchedStats now;
+    vm_sched_stats(vm, &now);
+    vm_lock(vm);
+    long max_wait = disk->max_wait;
+    vm_unlock(vm);
+    printf("[VM] TLB mode: %s, Frames: %d, Pages per address space: %d\n",
+           vm->tlb_mode == TLB_TAGGED ? "tagged" : "flush", NUM_FRAMES, NUM_PAGES);
+    printf("[VM] Accesses: %ld, TLB hit rate: %.1f%%, Hard faults: %ld (%.1f per 1000 accesses)\n", now.accesses,
+           now.accesses ? 100.0 * now.tlb_hits / now.accesses : 0.0, now.hard_faults,
+           now.accesses ? 1000.0 * now.hard_faults / now.accesses : 0.0);
+    printf("[VM] Address space switches: %ld, TLB flushes: %ld\n", now.switches, now.flushes);
+    printf("[VM] Longest wait for the paging disk: %ld ticks\n", max_wait);
+    if (ticks > 0) {
+        printf("[VM] Throughput: %.3f jobs/tick, %.2f faults/tick\n", (double)completed / ticks,
+               (double)now.hard_faults / ticks);
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef VMSCHED_H
+#define VMSCHED_H
+
+#include "advancedScheduler.h"
+#include "VMmanager.h"
+
+#define VM_ACCESSES_PER_TICK 8
+#define VM_FAULT_TICKS 2            // one page read by the paging disk
+#define VM_LOCALITY_PERCENT 90      // accesses inside the current window under mem=:local
+#define VM_PHASE_TICKS 4            // ticks of work before the locality window moves
+
+// A PCB with mem=<pages> gets an address space in the VMM it runs against
+// (the shell's, or a simulation's own) on its first tick and makes
+// VM_ACCESSES_PER_TICK accesses per tick of CPU time in its pattern. A hard
+// fault ends the tick: the PCB goes to WAITING and comes back once the
+// paging disk has read the page in. The CPUs on one VMM share its TLB,
+// flushed or tagged on every address space switch.
+
+// The paging disk reads one page at a time, so under thrashing the faults
+// queue up behind each other and the CPUs run out of work
+typedef struct {
+    long free_at;           // tick at which the disk is next idle
+    long max_wait;          // longest a fault has waited, in ticks
+} PagingDisk;
+
+extern PagingDisk paging_disk;
+
+typedef struct {
+    long accesses;
+    long tlb_hits;
+    long hard_faults;
+    long switches;
+    long flushes;
+} VmSchedStats;
+
+int vm_sched_run_tick(Vmm *vm, PCB *p);
+long paging_disk_reserve(Vmm *vm, PagingDisk *d, long now);
+void vm_sched_fault_done(PCB *p);
+void vm_sched_release(PCB *p);
+void vm_sched_stats(Vmm *vm, VmSchedStats *out);
+void print_vm_sched(Vmm *vm, const PagingDisk *disk, long ticks, long completed);
+
+#endif
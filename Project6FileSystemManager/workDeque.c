@@ -0,0 +1,67 @@
+#include <stddef.h>
+#include "workDeque.h"
+
+#define MASK (WORK_DEQUE_SIZE - 1)
+
+void deque_init(WorkDeque *d) {
+    atomic_init(&d->top, 0);
+    atomic_init(&d->bottom, 0);
+    for (int i = 0; i < WORK_DEQUE_SIZE; i++) atomic_init(&d->slots[i], NULL);
+}
+
+// Owner only. Returns -1 when the deque is full.
+int deque_push(WorkDeque *d, struct PCB *p) {
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    if (b - t >= WORK_DEQUE_SIZE) return -1;
+    atomic_store_explicit(&d->slots[b & MASK], p, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    return 0;
+}
+
+// Owner only. Takes the most recently pushed PCB; when one item is left the
+// owner races thieves for it through the same CAS on top.
+struct PCB *deque_pop(WorkDeque *d) {
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&d->top, memory_order_relaxed);
+    struct PCB *p = NULL;
+
+    if (t <= b) {
+        p = atomic_load_explicit(&d->slots[b & MASK], memory_order_relaxed);
+        if (t == b) {
+            if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1,
+                                                         memory_order_seq_cst, memory_order_relaxed)) {
+                p = NULL;
+            }
+            atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        }
+    } else {
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    }
+    return p;
+}
+
+// Any thread. Takes the oldest PCB, or NULL if empty or another thief won.
+struct PCB *deque_steal(WorkDeque *d) {
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+    if (t >= b) return NULL;
+
+    struct PCB *p = atomic_load_explicit(&d->slots[t & MASK], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1,
+                                                 memory_order_seq_cst, memory_order_relaxed)) {
+        return NULL;
+    }
+    return p;
+}
+
+// Approximate when read by a thread other than the owner
+long deque_size(WorkDeque *d) {
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&d->top, memory_order_relaxed);
+    return b > t ? b - t : 0;
+}
@@ -0,0 +1,25 @@
+#ifndef WORKDEQUE_H
+#define WORKDEQUE_H
+
+#include <stdatomic.h>
+
+#define WORK_DEQUE_SIZE 1024    // must be a power of two
+
+struct PCB;
+
+// Chase-Lev work-stealing deque. Only the owning CPU pushes and pops at the
+// bottom; any other CPU may steal from the top. The buffer is fixed size, so
+// a push can fail and the caller must put the PCB somewhere else.
+typedef struct {
+    atomic_long top;
+    atomic_long bottom;
+    _Atomic(struct PCB *) slots[WORK_DEQUE_SIZE];
+} WorkDeque;
+
+void deque_init(WorkDeque *d);
+int deque_push(WorkDeque *d, struct PCB *p);
+struct PCB *deque_pop(WorkDeque *d);
+struct PCB *deque_steal(WorkDeque *d);
+long deque_size(WorkDeque *d);
+
+#endif